@@ -0,0 +1,137 @@
+/**
+ * @file bench_pipeline.c
+ * @brief Host benchmark of the calibration, curve and filter pipeline
+ *
+ * Runs the on-device benchmark (data_processor_run_benchmark: lookup
+ * table against the division path, packet path self-check, LUT rebuild
+ * per curve, one euro filter and predictor per sample), then times the
+ * full packet path with a shaped curve and the filter on.
+ *
+ * Usage: bench_pipeline [budget_ns]
+ * With a budget, a shaped and filtered packet costing more fails the run,
+ * so a slowdown shows up in CI rather than on the car.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "data_processor.h"
+#include "sender_registry.h"
+#include "link_quality.h"
+#include "espnow_wire.h"
+#include "metrics.h"
+
+#define BENCH_PACKETS       20000
+#define PACKET_INTERVAL_US  1000
+
+/* Sender used by data_processor_run_benchmark */
+static const uint8_t s_bench_mac[6] = { 0x02, 0xBE, 0x4C, 0x00, 0x00, 0x01 };
+static const uint8_t s_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x01 };
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ns per packet through data_processor_process_espnow_data */
+static double time_stream(uint16_t *seq)
+{
+    uint32_t noise = 4242;
+    int64_t t_us = 1000000;
+
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < BENCH_PACKETS; i++) {
+        noise = noise * 1103515245u + 12345u;
+        uint16_t raw = (uint16_t)((i * 7) % 4096) ^ ((noise >> 16) & 7);
+        struct __attribute__((packed)) {
+            espnow_wire_header_t hdr;
+            espnow_wire_clutch_t body;
+        } frame = {
+            .hdr = {
+                .magic = ESPNOW_WIRE_MAGIC,
+                .version = ESPNOW_WIRE_VERSION,
+                .type = ESPNOW_WIRE_TYPE_CLUTCH,
+                .seq = (*seq)++,
+                .tx_delta_us = PACKET_INTERVAL_US,
+            },
+            .body = { .left_clutch = raw, .right_clutch = 4095 - raw },
+        };
+        data_processor_process_espnow_data(s_mac, (const uint8_t *)&frame, sizeof(frame),
+                                           -40, t_us += PACKET_INTERVAL_US);
+    }
+    return (double)(monotonic_ns() - start) / BENCH_PACKETS;
+}
+
+int main(int argc, char **argv)
+{
+    double budget_ns = argc > 1 ? atof(argv[1]) : 0.0;
+    int failures = 0;
+
+    sender_registry_init();
+    data_processor_init();
+
+    if (data_processor_run_benchmark() != ESP_OK) {
+        printf("FAIL: benchmark self-check reported wrong outputs\n");
+        failures++;
+    }
+    if (sender_registry_lookup(s_bench_mac) >= 0 || sender_registry_count() != 0) {
+        printf("FAIL: benchmark sender left in the registry\n");
+        failures++;
+    }
+    if (link_quality_count() != 0) {
+        printf("FAIL: benchmark sender left in the link table\n");
+        failures++;
+    }
+
+    // Every slot is still available to real senders
+    const int max_used = SENDER_REGISTRY_CAPACITY * 3 / 4;
+    uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x02, 0x00 };
+    int added = 0;
+    for (int n = 0; n < max_used; n++) {
+        mac[5] = (uint8_t)n;
+        added += sender_registry_register(mac, SENDER_FIELD_RIGHT_CLUTCH) == ESP_OK;
+    }
+    if (added != max_used) {
+        printf("FAIL: %d of %d senders fit after the benchmark\n", added, max_used);
+        failures++;
+    }
+    for (int n = 0; n < max_used; n++) {
+        mac[5] = (uint8_t)n;
+        sender_registry_unregister(mac);
+    }
+    if (metrics_get(METRIC_RX_PACKETS) != 0) {
+        printf("FAIL: benchmark left %llu packets in the counters\n",
+               (unsigned long long)metrics_get(METRIC_RX_PACKETS));
+        failures++;
+    }
+
+    static const clutch_calibration_t cal = {
+        .left_min = 310, .left_max = 3790,
+        .right_min = 205, .right_max = 3902,
+        .calibrated = true,
+    };
+    static const axis_shaping_t shaped = {
+        .deadzone = 40, .saturation = 40, .curve = AXIS_CURVE_GAMMA, .gamma_x100 = 180,
+    };
+    data_processor_set_calibration(&cal);
+    data_processor_set_axis_shaping(DATA_AXIS_RIGHT_CLUTCH, &shaped);
+    sender_registry_register(s_mac, SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH);
+
+    uint16_t seq = 0;
+    data_processor_set_filter(false, NULL);
+    double plain_ns = time_stream(&seq);
+    data_processor_set_filter(true, NULL);
+    double filtered_ns = time_stream(&seq);
+
+    printf("packet path, gamma curve         : %.0f ns/packet\n", plain_ns);
+    printf("packet path, gamma curve + filter: %.0f ns/packet\n", filtered_ns);
+    if (budget_ns > 0 && filtered_ns > budget_ns) {
+        printf("FAIL: %.0f ns/packet over the %.0f ns budget\n", filtered_ns, budget_ns);
+        failures++;
+    }
+
+    printf("%s: %d failed checks\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file capture_extract.c
+ * @brief Pull a capture dump out of a recorded telemetry stream
+ *
+ * Usage: capture_extract <stream> <dump>
+ *
+ * <stream> is the raw telemetry CDC port, saved while the receiver sent
+ * its capture (USB_HID_CMD_CAPTURE_DUMP). The CAPTURE frames (telemetry.h)
+ * are checked and written in order to <dump>, the capture_read() stream
+ * that test_packet_path replays. Fails on a gap (frames dropped) or a
+ * stream without the closing frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+#define FRAME_OVERHEAD  5       // sync, type, len, seq, checksum
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <stream> <dump>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        perror(argv[2]);
+        fclose(in);
+        return 2;
+    }
+
+    static uint8_t stream[1 << 16];
+    size_t have = 0;
+    uint32_t written = 0;
+    uint32_t chunks = 0;
+    int status = 1;
+
+    while (status == 1) {
+        size_t n = fread(stream + have, 1, sizeof(stream) - have, in);
+        have += n;
+        if (n == 0 && have < FRAME_OVERHEAD) {
+            break;
+        }
+
+        // Scan for frames; keep an incomplete one for the next read
+        size_t pos = 0;
+        while (status == 1 && pos + FRAME_OVERHEAD <= have) {
+            if (stream[pos] != TELEMETRY_SYNC) {
+                pos++;
+                continue;
+            }
+            uint8_t len = stream[pos + 2];
+            if (pos + FRAME_OVERHEAD + len > have) {
+                break;
+            }
+            uint8_t checksum = 0;
+            for (size_t i = 1; i < 4u + len; i++) {
+                checksum ^= stream[pos + i];
+            }
+            if (checksum != stream[pos + 4 + len]) {
+                pos++;
+                continue;
+            }
+
+            const uint8_t *payload = &stream[pos + 4];
+            if (stream[pos + 1] == TELEMETRY_FRAME_CAPTURE &&
+                len >= offsetof(telemetry_capture_t, data)) {
+                uint32_t offset;
+                memcpy(&offset, payload, sizeof(offset));
+                uint32_t data_len = len - (uint32_t)offsetof(telemetry_capture_t, data);
+                if (offset != written) {
+                    fprintf(stderr, "gap at byte %u (next chunk at %u): frames dropped\n",
+                            written, offset);
+                    status = 2;
+                    break;
+                }
+                fwrite(payload + offsetof(telemetry_capture_t, data), 1, data_len, out);
+                written += data_len;
+                chunks++;
+                if (data_len == 0) {
+                    status = 0;
+                }
+            }
+            pos += FRAME_OVERHEAD + len;
+        }
+
+        memmove(stream, stream + pos, have - pos);
+        have -= pos;
+        if (n == 0) {
+            break;
+        }
+    }
+
+    fclose(in);
+    fclose(out);
+
+    if (status == 1) {
+        fprintf(stderr, "no end of capture after %u bytes\n", written);
+    } else if (status == 0) {
+        printf("%u bytes in %u chunks\n", written, chunks);
+    }
+    return status;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file fakes.c
+ * @brief Stand-ins for the firmware modules the host tests do not link
+ */
+
+#include "fakes.h"
+#include <string.h>
+#include "shared_state.h"
+#include "usb_comm.h"
+#include "rate_control.h"
+#include "calib_store.h"
+#include "telemetry.h"
+#include "power.h"
+#include "deferred_log.h"
+#include "ingest.h"
+
+fake_calls_t g_fake_calls;
+
+volatile bool g_left_clutch_pressed = false;
+volatile uint16_t g_right_clutch_value = 0;
+volatile uint16_t g_virtual_clutch_value = 0;
+
+void fakes_reset(void)
+{
+    memset(&g_fake_calls, 0, sizeof(g_fake_calls));
+}
+
+void usb_comm_notify_report(void)
+{
+    g_fake_calls.reports_notified++;
+}
+
+void rate_control_note_change(int sender, int64_t rx_time_us)
+{
+    (void)sender;
+    (void)rx_time_us;
+    g_fake_calls.rate_changes++;
+}
+
+void calib_store_request_save(void)
+{
+    g_fake_calls.calib_saves++;
+}
+
+bool telemetry_is_active(void)
+{
+    return false;
+}
+
+void telemetry_emit(telemetry_frame_type_t type, const void *payload, uint8_t len)
+{
+    (void)type;
+    (void)payload;
+    (void)len;
+}
+
+uint32_t telemetry_get_dropped_count(void)
+{
+    return 0;
+}
+
+void power_note_activity(void)
+{
+    g_fake_calls.activity++;
+}
+
+void dlog_write(esp_log_level_t level, dlog_tag_t tag, const char *fmt,
+                const uint32_t args[DLOG_MAX_ARGS])
+{
+    (void)tag;
+    (void)fmt;
+    (void)args;
+    if (level <= ESP_LOG_WARN) {
+        g_fake_calls.dlog_warnings++;
+    }
+}
+
+void ingest_get_stats(ingest_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void ingest_sync(void)
+{
+}
@@ -0,0 +1,27 @@
+/**
+ * @file fakes.h
+ * @brief Stand-ins for the firmware modules the host tests do not link
+ *
+ * Each fake counts its calls so a test can check that the processor asked
+ * for a HID report, a calibration save and so on.
+ */
+
+#ifndef HOST_FAKES_H
+#define HOST_FAKES_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t reports_notified;  ///< usb_comm_notify_report()
+    uint32_t rate_changes;      ///< rate_control_note_change()
+    uint32_t calib_saves;       ///< calib_store_request_save()
+    uint32_t activity;          ///< power_note_activity()
+    uint32_t dlog_warnings;     ///< dlog_write() at ESP_LOG_WARN or worse
+} fake_calls_t;
+
+extern fake_calls_t g_fake_calls;
+
+/** Zero g_fake_calls */
+void fakes_reset(void);
+
+#endif // HOST_FAKES_H
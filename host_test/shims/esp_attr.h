@@ -0,0 +1,5 @@
+/* Host shim: no IRAM/DRAM placement */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
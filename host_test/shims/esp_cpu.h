@@ -0,0 +1,10 @@
+/* Host shim: "cycles" are monotonic nanoseconds scaled to
+ * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, so cycle-based reports read as real
+ * host time */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,7 @@
+/* Host shim */
+#pragma once
+
+#include <stdint.h>
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
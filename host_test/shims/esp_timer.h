@@ -0,0 +1,27 @@
+/* Host shim: esp_timer_get_time() is CLOCK_MONOTONIC; one-shot timers
+ * only record that they are armed, host_timer_fire() runs the callback */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+/** Run an armed timer's callback now; false if it was not armed */
+bool host_timer_fire(esp_timer_handle_t timer);
+
+/** Fire every armed timer; returns how many ran */
+int host_timer_fire_all(void);
@@ -0,0 +1,24 @@
+/* Host shim: enough of the task API for the linked modules; there is no
+ * scheduler, notifications are dropped and delays return at once */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    uint32_t ulRunTimeCounter;
+    uint32_t usStackHighWaterMark;
+} TaskStatus_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TaskHandle_t xTaskGetHandle(const char *name);
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *prev, TickType_t increment);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t max, uint32_t *total);
@@ -0,0 +1,26 @@
+/*
+ * Host build configuration: the Kconfig defaults of the modules linked
+ * into the host tests, with the optional filter, predictor and benchmark
+ * code switched on so it is compiled and run too.
+ */
+#pragma once
+
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+
+#define CONFIG_CLUTCH_INGEST_RING_SLOTS 32
+#define CONFIG_CLUTCH_SENDER_REGISTRY_CAPACITY 16
+#define CONFIG_CLUTCH_SENDER_AUTO_REGISTER 1
+#define CONFIG_CLUTCH_LEFT_PRESS_THRESHOLD 2800
+#define CONFIG_CLUTCH_LEFT_RELEASE_THRESHOLD 2700
+#define CONFIG_CLUTCH_AXIS_FILTER 1
+#define CONFIG_CLUTCH_AXIS_FILTER_MIN_CUTOFF_CHZ 100
+#define CONFIG_CLUTCH_AXIS_FILTER_BETA 20
+#define CONFIG_CLUTCH_AXIS_FILTER_D_CUTOFF_CHZ 1000
+#define CONFIG_CLUTCH_AXIS_PREDICTOR 1
+#define CONFIG_CLUTCH_PREDICT_HORIZON_MS 10
+#define CONFIG_CLUTCH_PREDICT_TIMEOUT_MS 50
+#define CONFIG_CLUTCH_AUTOCAL_DECAY_SHIFT 22
+#define CONFIG_CLUTCH_AUTOCAL_MIN_SPAN 1000
+#define CONFIG_CLUTCH_AUTOCAL_HYSTERESIS 8
+#define CONFIG_CLUTCH_METRICS_SAMPLE_MS 1000
+#define CONFIG_CLUTCH_BENCHMARKS 1
@@ -0,0 +1,10 @@
+/* Host shim: globals shared between the processor and the HID reporter,
+ * defined in fakes.c */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern volatile bool g_left_clutch_pressed;
+extern volatile uint16_t g_right_clutch_value;
+extern volatile uint16_t g_virtual_clutch_value;
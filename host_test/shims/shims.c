@@ -0,0 +1,183 @@
+/**
+ * @file shims.c
+ * @brief Host implementations of the ESP-IDF and FreeRTOS calls used by
+ *        the linked firmware modules
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define HOST_MAX_TIMERS 8
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool armed;
+};
+
+static struct esp_timer s_timers[HOST_MAX_TIMERS];
+static int s_timer_count = 0;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)(monotonic_ns() / 1000u);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (args == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_timer_count >= HOST_MAX_TIMERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    struct esp_timer *t = &s_timers[s_timer_count++];
+    t->callback = args->callback;
+    t->arg = args->arg;
+    t->armed = false;
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    (void)timeout_us;
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+bool host_timer_fire(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->armed) {
+        return false;
+    }
+    timer->armed = false;
+    timer->callback(timer->arg);
+    return true;
+}
+
+int host_timer_fire_all(void)
+{
+    int fired = 0;
+    for (int i = 0; i < s_timer_count; i++) {
+        fired += host_timer_fire(&s_timers[i]) ? 1 : 0;
+    }
+    return fired;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    return (esp_cpu_cycle_count_t)(monotonic_ns() * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / 1000u);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 0;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static int s_main_task;
+    return &s_main_task;
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+    (void)name;
+    return NULL;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    (void)clear;
+    (void)wait;
+    return 0;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(monotonic_ns() / 1000000u);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *prev, TickType_t increment)
+{
+    *prev += increment;
+    return pdTRUE;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 0;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t max, uint32_t *total)
+{
+    (void)status;
+    (void)max;
+    if (total != NULL) {
+        *total = 0;
+    }
+    return 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return malloc(1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    (void)sem;
+    (void)wait;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void)sem;
+    return pdTRUE;
+}
@@ -0,0 +1,634 @@
+/**
+ * @file test_packet_path.c
+ * @brief Host tests of data_processor_process_espnow_data
+ *
+ * Runs synthetic packet streams through the real processor, link tracking
+ * and sender registry, checks the normalized outputs and the left paddle
+ * threshold against a reference computed with divisions, and reports the
+ * cost per packet. Given a file argument, also replays a recorded stream:
+ * the bytes returned by capture_read() (capture_record_t + payload,
+ * oldest first).
+ *
+ * Exit status is the number of failed checks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "data_processor.h"
+#include "sender_registry.h"
+#include "link_quality.h"
+#include "espnow_wire.h"
+#include "capture.h"
+#include "shared_state.h"
+#include "esp_timer.h"
+#include "fakes.h"
+
+#define STREAM_PACKETS      4000
+#define PACKET_INTERVAL_US  1000
+#define OVERSHOOT           60      // ADC counts past the calibrated bounds
+
+static int s_failures = 0;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            printf("FAIL %s:%d: ", __func__, __LINE__);             \
+            printf(__VA_ARGS__);                                    \
+            printf("\n");                                           \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+static const clutch_calibration_t s_cal = {
+    .left_min = 310, .left_max = 3790,
+    .right_min = 205, .right_max = 3902,
+    .calibrated = true,
+};
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Reference path: normalize with divisions, then scale to 16 bits */
+static uint16_t reference_level(uint16_t raw, uint16_t min, uint16_t max, bool calibrated)
+{
+    uint32_t value = raw > 4095 ? 4095 : raw;
+    if (calibrated) {
+        if (value <= min) {
+            value = 0;
+        } else if (value >= max) {
+            value = 4095;
+        } else {
+            value = (value - min) * 4095u / (uint32_t)(max - min);
+        }
+    }
+    return (uint16_t)(value * 65535u / 4095u);
+}
+
+/* Left paddle with hysteresis in the 16-bit domain, as configured */
+static bool reference_pressed(uint16_t left_scaled, bool was_pressed)
+{
+    uint16_t press, release;
+    data_processor_get_left_threshold(&press, &release);
+    uint16_t threshold = reference_level(was_pressed ? release : press, 0, 4095, false);
+    return left_scaled > threshold;
+}
+
+/* Press/release triangle over the whole range past both bounds, with ADC
+ * noise */
+static uint16_t sample(int i, uint16_t lo, uint16_t hi, uint32_t *noise)
+{
+    const int period = 500;
+    int phase = i % period;
+    int32_t ramp = phase < period / 2 ? phase : period - phase;
+    int32_t span = (int32_t)hi - lo + 2 * OVERSHOOT;
+
+    *noise = *noise * 1103515245u + 12345u;
+    int32_t raw = lo - OVERSHOOT + span * ramp / (period / 2) +
+                  (int32_t)((*noise >> 16) & 15) - 8;
+    if (raw < 0) raw = 0;
+    if (raw > 4095) raw = 4095;
+    return (uint16_t)raw;
+}
+
+static esp_err_t feed_clutch(const uint8_t *mac, uint16_t seq, uint16_t left, uint16_t right,
+                             int64_t t_us)
+{
+    struct __attribute__((packed)) {
+        espnow_wire_header_t hdr;
+        espnow_wire_clutch_t body;
+    } frame = {
+        .hdr = {
+            .magic = ESPNOW_WIRE_MAGIC,
+            .version = ESPNOW_WIRE_VERSION,
+            .type = ESPNOW_WIRE_TYPE_CLUTCH,
+            .seq = seq,
+            .tx_delta_us = PACKET_INTERVAL_US,
+        },
+        .body = { .left_clutch = left, .right_clutch = right },
+    };
+    return data_processor_process_espnow_data(mac, (const uint8_t *)&frame, sizeof(frame),
+                                              -40, t_us);
+}
+
+static esp_err_t feed_simracing(const uint8_t *mac, uint16_t seq,
+                                const espnow_simracing_data_t *body, bool corrupt, int64_t t_us)
+{
+    struct __attribute__((packed)) {
+        espnow_wire_header_t hdr;
+        espnow_simracing_data_t body;
+    } frame = {
+        .hdr = {
+            .magic = ESPNOW_WIRE_MAGIC,
+            .version = ESPNOW_WIRE_VERSION,
+            .type = ESPNOW_WIRE_TYPE_SIMRACING,
+            .seq = seq,
+            .tx_delta_us = PACKET_INTERVAL_US,
+        },
+        .body = *body,
+    };
+    const uint8_t *bytes = (const uint8_t *)&frame.body;
+    frame.body.checksum = 0;
+    for (size_t i = 0; i < offsetof(espnow_simracing_data_t, checksum); i++) {
+        frame.body.checksum ^= bytes[i];
+    }
+    if (corrupt) {
+        frame.body.checksum ^= 0xFF;
+    }
+    return data_processor_process_espnow_data(mac, (const uint8_t *)&frame, sizeof(frame),
+                                              -40, t_us);
+}
+
+static const sender_state_t *register_sender(const uint8_t *mac, uint32_t fields)
+{
+    if (sender_registry_register(mac, fields) != ESP_OK) {
+        return NULL;
+    }
+    return sender_registry_state(sender_registry_lookup(mac));
+}
+
+/* Fixed bounds, identity shaping, no filter and no auto-calibration, so
+ * every output has an exact reference */
+static void reset_pipeline(void)
+{
+    static const axis_shaping_t identity = { .curve = AXIS_CURVE_LINEAR, .gamma_x100 = 100 };
+    data_processor_set_calibration(&s_cal);
+    data_processor_set_axis_shaping(DATA_AXIS_LEFT_CLUTCH, &identity);
+    data_processor_set_axis_shaping(DATA_AXIS_RIGHT_CLUTCH, &identity);
+    data_processor_set_filter(false, NULL);
+    data_processor_set_auto_calibration(false);
+    fakes_reset();
+}
+
+static void test_sequenced_stream(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    const sender_state_t *st =
+        register_sender(mac, SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+
+    uint32_t noise = 777;
+    uint32_t wrong = 0;
+    uint32_t presses = 0;
+    bool pressed = false;
+    int64_t t_us = 1000000;
+
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < STREAM_PACKETS; i++) {
+        uint16_t left = sample(i, s_cal.left_min, s_cal.left_max, &noise);
+        uint16_t right = sample(i + 125, s_cal.right_min, s_cal.right_max, &noise);
+        feed_clutch(mac, (uint16_t)i, left, right, t_us += PACKET_INTERVAL_US);
+    }
+    uint64_t elapsed = monotonic_ns() - start;
+
+    // Same stream again, checking every output
+    noise = 777;
+    for (int i = 0; i < STREAM_PACKETS; i++) {
+        uint16_t left = sample(i, s_cal.left_min, s_cal.left_max, &noise);
+        uint16_t right = sample(i + 125, s_cal.right_min, s_cal.right_max, &noise);
+        esp_err_t ret = feed_clutch(mac, (uint16_t)(STREAM_PACKETS + i), left, right,
+                                    t_us += PACKET_INTERVAL_US);
+
+        bool now_pressed = reference_pressed(
+            reference_level(left, s_cal.left_min, s_cal.left_max, true), pressed);
+        presses += (now_pressed && !pressed) ? 1 : 0;
+        pressed = now_pressed;
+
+        if (ret != ESP_OK ||
+            st->right_clutch != reference_level(right, s_cal.right_min, s_cal.right_max, true) ||
+            st->left_pressed != pressed || g_left_clutch_pressed != pressed ||
+            g_right_clutch_value != st->right_clutch) {
+            wrong++;
+        }
+    }
+
+    CHECK(wrong == 0, "%u of %d packets with wrong output", wrong, STREAM_PACKETS);
+    CHECK(presses > 0, "stream never pressed the left paddle");
+    CHECK(g_fake_calls.reports_notified > 0, "no HID report requested");
+    printf("sequenced stream: %.0f ns/packet, %u presses\n",
+           (double)elapsed / STREAM_PACKETS, presses);
+
+    CHECK(sender_registry_unregister(mac) == ESP_OK, "unregister failed");
+}
+
+static void test_legacy_stream(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    const sender_state_t *st =
+        register_sender(mac, SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+
+    uint32_t noise = 99;
+    uint32_t wrong = 0;
+    bool pressed = false;
+    int64_t t_us = 1000000;
+
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < STREAM_PACKETS; i++) {
+        uint16_t left = sample(i, s_cal.left_min, s_cal.left_max, &noise);
+        uint16_t right = sample(i, s_cal.right_min, s_cal.right_max, &noise);
+        const uint8_t frame[ESPNOW_WIRE_LEGACY_CLUTCH_LEN] = {
+            left & 0xFF, left >> 8, right & 0xFF, right >> 8,
+        };
+        esp_err_t ret = data_processor_process_espnow_data(mac, frame, sizeof(frame), -50,
+                                                           t_us += PACKET_INTERVAL_US);
+
+        pressed = reference_pressed(
+            reference_level(left, s_cal.left_min, s_cal.left_max, true), pressed);
+        if (ret != ESP_OK ||
+            st->right_clutch != reference_level(right, s_cal.right_min, s_cal.right_max, true) ||
+            st->left_pressed != pressed) {
+            wrong++;
+        }
+    }
+    uint64_t elapsed = monotonic_ns() - start;
+
+    CHECK(wrong == 0, "%u of %d packets with wrong output", wrong, STREAM_PACKETS);
+    printf("legacy stream   : %.0f ns/packet\n", (double)elapsed / STREAM_PACKETS);
+
+    // A truncated frame is not a received packet for the link statistics
+    link_quality_entry_t lq = { 0 };
+    link_quality_find(mac, &lq);
+    uint32_t packets = lq.packets;
+    static const uint8_t short_frame[2] = { 0x00, 0x08 };
+    CHECK(data_processor_process_espnow_data(mac, short_frame, sizeof(short_frame), -50,
+                                             t_us += PACKET_INTERVAL_US) == ESP_ERR_INVALID_SIZE,
+          "short frame accepted");
+    link_quality_find(mac, &lq);
+    CHECK(lq.packets == packets, "short frame counted: %u link packets, expected %u",
+          lq.packets, packets);
+
+    CHECK(sender_registry_unregister(mac) == ESP_OK, "unregister failed");
+}
+
+static void test_duplicates_and_stale(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 };
+    const sender_state_t *st = register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+
+    uint32_t discarded = data_processor_get_discarded_count();
+    feed_clutch(mac, 100, 0, 2000, 1000);
+    uint16_t out = st->right_clutch;
+
+    feed_clutch(mac, 100, 0, 3000, 2000);      // repeat
+    feed_clutch(mac, 99, 0, 3000, 3000);       // late retry
+    CHECK(st->right_clutch == out, "discarded frame changed the output");
+    CHECK(data_processor_get_discarded_count() == discarded + 2,
+          "discarded %u, expected 2", data_processor_get_discarded_count() - discarded);
+
+    link_quality_entry_t lq;
+    CHECK(link_quality_find(mac, &lq) == ESP_OK, "no link entry");
+    CHECK(lq.duplicates == 1 && lq.stale == 1, "duplicates %u stale %u", lq.duplicates,
+          lq.stale);
+
+    feed_clutch(mac, 101, 0, 3000, 4000);
+    CHECK(st->right_clutch == reference_level(3000, s_cal.right_min, s_cal.right_max, true),
+          "next frame not processed");
+
+    sender_registry_unregister(mac);
+}
+
+/* A rebooted sender restarts its count below the last one: accepted
+ * after a silence, while a late retry right behind is still stale */
+static void test_sender_restart(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x08 };
+    const sender_state_t *st = register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+
+    int64_t t_us = 1000;
+    for (uint16_t seq = 100; seq <= 110; seq++) {
+        feed_clutch(mac, seq, 0, 1000, t_us += PACKET_INTERVAL_US);
+    }
+    feed_clutch(mac, 95, 0, 3000, t_us += PACKET_INTERVAL_US);    // late retry
+    CHECK(st->right_clutch == reference_level(1000, s_cal.right_min, s_cal.right_max, true),
+          "late retry moved the axis");
+
+    feed_clutch(mac, 0, 0, 2000, t_us += 500000);                 // after a reboot
+    CHECK(st->right_clutch == reference_level(2000, s_cal.right_min, s_cal.right_max, true),
+          "restarted sender dropped");
+    feed_clutch(mac, 1, 0, 2500, t_us += PACKET_INTERVAL_US);
+    CHECK(st->right_clutch == reference_level(2500, s_cal.right_min, s_cal.right_max, true),
+          "frame after the restart dropped");
+
+    link_quality_entry_t lq;
+    CHECK(link_quality_find(mac, &lq) == ESP_OK, "no link entry");
+    CHECK(lq.stale == 1 && lq.resyncs == 1, "stale %u resyncs %u", lq.stale, lq.resyncs);
+
+    sender_registry_unregister(mac);
+}
+
+/* A corrupt frame must not advance the sequence number (it would make
+ * the good frames after it look stale) */
+static void test_corrupt_frame_keeps_sequence(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x04 };
+    const sender_state_t *st = register_sender(mac, SENDER_FIELDS_ALL);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+
+    espnow_simracing_data_t body = {
+        .buttons = 0x5, .left_clutch = 0, .right_clutch = 1000,
+        .axis_x = 4095, .axis_y = 0, .axis_z = 2048, .axis_rx = 5000,
+    };
+    CHECK(feed_simracing(mac, 10, &body, false, 1000) == ESP_OK, "good frame rejected");
+    CHECK(st->buttons == 0x5, "buttons %08x", st->buttons);
+    CHECK(st->aux[0] == 65535 && st->aux[1] == 0 && st->aux[3] == 65535,
+          "aux %u %u %u %u", st->aux[0], st->aux[1], st->aux[2], st->aux[3]);
+
+    body.buttons = 0xFF;
+    CHECK(feed_simracing(mac, 5000, &body, true, 2000) == ESP_ERR_INVALID_CRC,
+          "corrupt frame accepted");
+    CHECK(st->buttons == 0x5, "corrupt frame changed the buttons");
+
+    body.buttons = 0x3;
+    CHECK(feed_simracing(mac, 11, &body, false, 3000) == ESP_OK, "good frame rejected");
+    CHECK(st->buttons == 0x3, "frame after the corrupt one was dropped");
+
+    sender_registry_unregister(mac);
+}
+
+/* Stopping a run that saw no travel keeps the previous range; a run
+ * through the whole travel replaces it */
+static void test_calibration_run(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x05 };
+    CHECK(register_sender(mac, SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH) != NULL,
+          "register failed");
+    reset_pipeline();
+
+    clutch_calibration_t cal;
+    CHECK(data_processor_start_calibration(10000) == ESP_OK, "start failed");
+    CHECK(data_processor_stop_calibration() == ESP_OK, "stop failed");
+    data_processor_get_calibration(&cal);
+    CHECK(cal.left_min == s_cal.left_min && cal.right_max == s_cal.right_max,
+          "empty run changed the range to %u-%u / %u-%u",
+          cal.left_min, cal.left_max, cal.right_min, cal.right_max);
+
+    CHECK(data_processor_start_calibration(10000) == ESP_OK, "start failed");
+    uint32_t noise = 5;
+    int64_t t_us = 1000;
+    for (int i = 0; i < 500; i++) {
+        feed_clutch(mac, (uint16_t)i, sample(i, 400, 3600, &noise), sample(i, 300, 3700, &noise),
+                    t_us += PACKET_INTERVAL_US);
+    }
+    CHECK(data_processor_stop_calibration() == ESP_OK, "stop failed");
+    data_processor_get_calibration(&cal);
+    CHECK(cal.left_min < 400 && cal.left_max > 3600 && cal.right_min < 300 &&
+          cal.right_max > 3700 && cal.calibrated,
+          "run captured %u-%u / %u-%u", cal.left_min, cal.left_max, cal.right_min,
+          cal.right_max);
+    CHECK(!data_processor_is_calibrating(), "still calibrating");
+
+    sender_registry_unregister(mac);
+}
+
+/* With the filter on, a paddle at rest settles on the exact value */
+static void test_filter_settles(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x06 };
+    const sender_state_t *st = register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(st != NULL, "register failed");
+    if (st == NULL) return;
+    reset_pipeline();
+    data_processor_set_filter(true, NULL);
+
+    int64_t t_us = 1000;
+    for (int i = 0; i < 2000; i++) {
+        feed_clutch(mac, (uint16_t)i, 0, i < 1000 ? 300 : 2500, t_us += PACKET_INTERVAL_US);
+    }
+    uint16_t expected = reference_level(2500, s_cal.right_min, s_cal.right_max, true);
+    CHECK(abs((int)st->right_clutch - expected) <= 1, "filtered %u, expected %u",
+          st->right_clutch, expected);
+
+    data_processor_set_filter(false, NULL);
+    sender_registry_unregister(mac);
+}
+
+static void test_unregistered_sender(void)
+{
+    static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x07 };
+    reset_pipeline();
+
+    size_t before = sender_registry_count();
+    CHECK(register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH) != NULL, "register failed");
+    CHECK(sender_registry_count() == before + 1, "count %zu", sender_registry_count());
+    CHECK(sender_registry_unregister(mac) == ESP_OK, "unregister failed");
+    CHECK(sender_registry_lookup(mac) < 0, "slot still found");
+    CHECK(sender_registry_count() == before, "count %zu", sender_registry_count());
+    CHECK(sender_registry_unregister(mac) == ESP_ERR_NOT_FOUND, "second unregister succeeded");
+}
+
+/* A sender unregistered while it holds the left paddle releases it, and
+ * the other senders' packets do not bring it back */
+static void test_unregister_releases_paddle(void)
+{
+    static const uint8_t paddles[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x09 };
+    static const uint8_t other[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0A };
+    CHECK(register_sender(paddles, SENDER_FIELD_LEFT_CLUTCH) != NULL, "register failed");
+    CHECK(register_sender(other, SENDER_FIELD_RIGHT_CLUTCH) != NULL, "register failed");
+    reset_pipeline();
+
+    int64_t t_us = 1000;
+    feed_clutch(paddles, 0, s_cal.left_max, 0, t_us += PACKET_INTERVAL_US);
+    CHECK(g_left_clutch_pressed, "paddle not pressed");
+
+    CHECK(sender_registry_unregister(paddles) == ESP_OK, "unregister failed");
+    CHECK(!g_left_clutch_pressed, "paddle still pressed after unregister");
+    feed_clutch(other, 0, 0, 2000, t_us += PACKET_INTERVAL_US);
+    CHECK(!g_left_clutch_pressed, "packet of another sender pressed the paddle");
+#if !CONFIG_CLUTCH_SENDER_AUTO_REGISTER
+    CHECK(feed_clutch(paddles, 1, s_cal.left_max, 0, t_us += PACKET_INTERVAL_US) ==
+          ESP_ERR_NOT_FOUND, "unregistered sender accepted");
+    CHECK(!g_left_clutch_pressed, "unregistered sender pressed the paddle");
+#endif
+
+    // Registered again, it starts released
+    CHECK(register_sender(paddles, SENDER_FIELD_LEFT_CLUTCH) != NULL, "register failed");
+    feed_clutch(paddles, 2, 0, 0, t_us += PACKET_INTERVAL_US);
+    CHECK(!g_left_clutch_pressed, "revived sender pressed");
+    feed_clutch(paddles, 3, s_cal.left_max, 0, t_us += PACKET_INTERVAL_US);
+    CHECK(g_left_clutch_pressed, "revived sender cannot press");
+
+    sender_registry_unregister(paddles);
+    sender_registry_unregister(other);
+    CHECK(!g_left_clutch_pressed, "paddle still pressed");
+}
+
+/* Two right clutch senders: the clutch engine gets the larger value, and
+ * none of a sender that left */
+static void test_right_clutch_max(void)
+{
+    static const uint8_t high[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0B };
+    static const uint8_t low[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0C };
+    sender_info_t info;
+    while (sender_registry_get(0, &info) == ESP_OK) {
+        sender_registry_unregister(info.mac);
+    }
+    const sender_state_t *h = register_sender(high, SENDER_FIELD_RIGHT_CLUTCH);
+    const sender_state_t *l = register_sender(low, SENDER_FIELD_RIGHT_CLUTCH);
+    CHECK(h != NULL && l != NULL, "register failed");
+    if (h == NULL || l == NULL) return;
+    reset_pipeline();
+
+    int64_t t_us = 1000;
+    feed_clutch(high, 0, 0, 3000, t_us += PACKET_INTERVAL_US);
+    feed_clutch(low, 0, 0, 1000, t_us += PACKET_INTERVAL_US);
+    CHECK(h->right_clutch > l->right_clutch, "right %u / %u", h->right_clutch, l->right_clutch);
+    CHECK(g_right_clutch_value == h->right_clutch, "right clutch %u, expected %u",
+          g_right_clutch_value, h->right_clutch);
+
+    uint16_t low_value = l->right_clutch;
+    CHECK(sender_registry_unregister(high) == ESP_OK, "unregister failed");
+    CHECK(g_right_clutch_value == low_value, "right clutch %u after unregister, expected %u",
+          g_right_clutch_value, low_value);
+
+    sender_registry_unregister(low);
+    CHECK(g_right_clutch_value == 0, "right clutch %u with no sender", g_right_clutch_value);
+}
+
+/* Pair, forget, pair a new board, many times over: unregistered slots are
+ * reused, and a sender given one starts with no state or link history */
+static void test_slot_reuse(void)
+{
+    const int max_used = SENDER_REGISTRY_CAPACITY * 3 / 4;
+    uint8_t mac[6] = { 0x02, 0xC0, 0x00, 0x00, 0x00, 0x00 };
+    reset_pipeline();
+
+    size_t before = sender_registry_count();
+    int64_t t_us = 1000;
+    for (int n = 0; n < 4 * SENDER_REGISTRY_CAPACITY; n++) {
+        mac[5] = (uint8_t)n;
+        const sender_state_t *st = register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH);
+        CHECK(st != NULL, "board %d not registered", n);
+        if (st == NULL) return;
+        CHECK(st->right_clutch == 0, "board %d inherited right clutch %u", n, st->right_clutch);
+
+        link_quality_entry_t lq = { 0 };
+        CHECK(link_quality_find(mac, &lq) == ESP_ERR_NOT_FOUND,
+              "board %d inherited %u link packets", n, lq.packets);
+        feed_clutch(mac, 0, 0, 3000, t_us += PACKET_INTERVAL_US);
+        CHECK(link_quality_find(mac, &lq) == ESP_OK && lq.packets == 1,
+              "board %d: %u link packets", n, lq.packets);
+
+        CHECK(sender_registry_unregister(mac) == ESP_OK, "board %d not unregistered", n);
+    }
+    CHECK(sender_registry_count() == before, "count %zu", sender_registry_count());
+
+    // The whole table is still available
+    int added = 0;
+    for (int n = 0; n < max_used; n++) {
+        mac[4] = 0x01;
+        mac[5] = (uint8_t)n;
+        added += register_sender(mac, SENDER_FIELD_RIGHT_CLUTCH) != NULL;
+    }
+    CHECK(added == max_used - (int)before, "%d of %d senders added", added,
+          max_used - (int)before);
+    for (int n = 0; n < max_used; n++) {
+        mac[5] = (uint8_t)n;
+        sender_registry_unregister(mac);
+    }
+}
+
+/* Replay a capture_read() dump; check each accepted clutch sample of a
+ * sender mapped to the right clutch against the reference */
+static void replay_capture(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    CHECK(f != NULL, "cannot open %s", path);
+    if (f == NULL) return;
+
+    // Uncalibrated identity pipeline: output = scaled raw value
+    data_processor_reset_calibration();
+    data_processor_set_filter(false, NULL);
+    data_processor_set_auto_calibration(false);
+
+    uint32_t frames = 0, accepted = 0, errors = 0, wrong = 0;
+    uint64_t elapsed = 0;
+    int64_t t_us = 0;
+    uint32_t last_rx = 0;
+    capture_record_t rec;
+    uint8_t payload[256];
+
+    while (fread(&rec, sizeof(rec), 1, f) == 1 && fread(payload, 1, rec.len, f) == rec.len) {
+        // Unwrap the 32-bit capture time
+        t_us += frames == 0 ? rec.rx_time_us : (uint32_t)(rec.rx_time_us - last_rx);
+        last_rx = rec.rx_time_us;
+        frames++;
+
+        uint32_t discarded = data_processor_get_discarded_count();
+        uint64_t start = monotonic_ns();
+        esp_err_t ret = data_processor_process_espnow_data(rec.mac, payload, rec.len,
+                                                           rec.rssi, t_us);
+        elapsed += monotonic_ns() - start;
+        if (ret != ESP_OK) {
+            errors++;
+            continue;
+        }
+        if (data_processor_get_discarded_count() != discarded) {
+            continue;
+        }
+        accepted++;
+
+        // Clutch samples: legacy frames and CLUTCH payloads
+        const uint8_t *clutch = NULL;
+        if (rec.len == ESPNOW_WIRE_LEGACY_CLUTCH_LEN && payload[0] != ESPNOW_WIRE_MAGIC) {
+            clutch = payload;
+        } else if (rec.len >= sizeof(espnow_wire_header_t) + sizeof(espnow_wire_clutch_t) &&
+                   payload[2] == ESPNOW_WIRE_TYPE_CLUTCH) {
+            clutch = payload + sizeof(espnow_wire_header_t);
+        }
+        int slot = sender_registry_lookup(rec.mac);
+        if (clutch != NULL && slot >= 0 &&
+            (sender_registry_field_mask(slot) & SENDER_FIELD_RIGHT_CLUTCH)) {
+            uint16_t right = (uint16_t)(clutch[2] | (clutch[3] << 8));
+            if (sender_registry_state(slot)->right_clutch != reference_level(right, 0, 4095, false)) {
+                wrong++;
+            }
+        }
+    }
+    fclose(f);
+
+    CHECK(frames > 0, "%s holds no records", path);
+    CHECK(wrong == 0, "%u replayed clutch samples with wrong output", wrong);
+    printf("replay %s: %u frames, %u accepted, %u errors, %.0f ns/packet\n",
+           path, frames, accepted, errors, frames ? (double)elapsed / frames : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    sender_registry_init();
+    data_processor_init();
+
+    test_sequenced_stream();
+    test_legacy_stream();
+    test_duplicates_and_stale();
+    test_sender_restart();
+    test_corrupt_frame_keeps_sequence();
+    test_calibration_run();
+    test_filter_settles();
+    test_unregistered_sender();
+    test_unregister_releases_paddle();
+    test_right_clutch_max();
+    test_slot_reuse();
+    for (int i = 1; i < argc; i++) {
+        replay_capture(argv[i]);
+    }
+
+    printf("%s: %d failed checks\n", s_failures == 0 ? "PASS" : "FAIL", s_failures);
+    return s_failures;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file axis_filter.c
+ * @brief Fixed-point One Euro filter implementation
+ *
+ * alpha is computed in Q16 with 32-bit integer division only:
+ *   p     = cutoff_chz * dt_us                  (<= 5e8)
+ *   num   = 2*pi * p                            (<= 3.2e9, 2*pi as 411775 / 2^16)
+ *   alpha = num / ((num + 1e8) >> 16)           (Q16)
+ * since 2*pi*cutoff*dt = num / 1e8 with cutoff in 0.01 Hz and dt in us.
+ *
+ * For an exponential smoother the group delay at low frequency is
+ * dt * (1 - alpha) / alpha, which is what delay_us reports.
+ */
+
+#include "axis_filter.h"
+#include "hot_path.h"
+#include <string.h>
+
+#define Q16_ONE         65536u
+#define TWO_PI_Q16      411775u     // 2*pi * 2^16
+#define ALPHA_DEN_ONE   100000000u  // 1e8: (0.01 Hz) * us -> cycles
+#define DT_MAX_US       50000u      // longer gaps restart the filter
+
+static HOT_PATH_FN uint32_t alpha_q16(uint32_t cutoff_chz, uint32_t dt_us)
+{
+    if (cutoff_chz > AXIS_FILTER_MAX_CUTOFF_CHZ) {
+        cutoff_chz = AXIS_FILTER_MAX_CUTOFF_CHZ;
+    }
+
+    uint32_t p = cutoff_chz * dt_us;
+    uint32_t num = (uint32_t)(((uint64_t)p * TWO_PI_Q16) >> 16);
+    uint32_t den = (num + ALPHA_DEN_ONE) >> 16;
+    uint32_t alpha = num / den;
+
+    if (alpha == 0) alpha = 1;
+    return alpha > Q16_ONE ? Q16_ONE : alpha;
+}
+
+void axis_filter_reset(axis_filter_t *f)
+{
+    memset(f, 0, sizeof(*f));
+}
+
+HOT_PATH_FN uint16_t axis_filter_update(axis_filter_t *f, const axis_filter_params_t *p,
+                                        uint16_t x, int64_t t_us)
+{
+    int32_t x_q8 = (int32_t)x << 8;
+    uint32_t dt = (uint32_t)(t_us - f->last_us);
+
+    if (!f->primed || t_us <= f->last_us || dt > DT_MAX_US) {
+        f->x_q8 = x_q8;
+        f->dx = 0;
+        f->last_us = t_us;
+        f->delay_us = 0;
+        f->primed = true;
+        return x;
+    }
+    f->last_us = t_us;
+
+    // Velocity in axis units per ms, smoothed with the derivative cutoff
+    int32_t raw_dx = ((x_q8 - f->x_q8) >> 8) * 1000 / (int32_t)dt;
+    uint32_t a_d = alpha_q16(p->d_cutoff_chz, dt);
+    f->dx += (int32_t)(((int64_t)(raw_dx - f->dx) * a_d) >> 16);
+
+    // Speed-dependent cutoff
+    uint32_t speed = (uint32_t)(f->dx < 0 ? -f->dx : f->dx);
+    uint64_t cutoff = p->min_cutoff_chz + (uint64_t)p->beta * speed;
+    if (cutoff > AXIS_FILTER_MAX_CUTOFF_CHZ) {
+        cutoff = AXIS_FILTER_MAX_CUTOFF_CHZ;
+    }
+
+    uint32_t a = alpha_q16((uint32_t)cutoff, dt);
+    f->x_q8 += (int32_t)(((int64_t)(x_q8 - f->x_q8) * a) >> 16);
+    f->delay_us = (dt * (Q16_ONE - a)) / a;    // dt <= DT_MAX_US, no overflow
+
+    int32_t out = (f->x_q8 + 128) >> 8;
+    if (out < 0) out = 0;
+    if (out > 65535) out = 65535;
+    return (uint16_t)out;
+}
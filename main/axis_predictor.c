@@ -0,0 +1,61 @@
+/**
+ * @file axis_predictor.c
+ * @brief Axis dead reckoning implementation
+ *
+ * Velocity is the slope between the oldest and newest kept sample, which
+ * averages ADC noise over the history with one division per packet.
+ */
+
+#include "axis_predictor.h"
+#include "hot_path.h"
+#include <string.h>
+
+HOT_PATH_FN axis_motion_t axis_predictor_push(axis_predictor_t *p, uint16_t value,
+                                              int64_t t_us, uint32_t timeout_us)
+{
+    axis_motion_t motion = { 0 };
+
+    if (p->count > 0) {
+        uint8_t newest = (p->head + AXIS_PREDICTOR_HISTORY - 1) % AXIS_PREDICTOR_HISTORY;
+        int64_t gap = t_us - p->t_us[newest];
+        if (gap <= 0 || gap > timeout_us) {
+            p->count = 0;
+        }
+    }
+
+    p->t_us[p->head] = t_us;
+    p->value[p->head] = value;
+    p->head = (p->head + 1) % AXIS_PREDICTOR_HISTORY;
+    if (p->count < AXIS_PREDICTOR_HISTORY) {
+        p->count++;
+    }
+
+    if (p->count >= 2) {
+        uint8_t oldest = (p->head + AXIS_PREDICTOR_HISTORY - p->count) % AXIS_PREDICTOR_HISTORY;
+        int32_t span_us = (int32_t)(t_us - p->t_us[oldest]);
+        int32_t delta = (int32_t)value - (int32_t)p->value[oldest];
+
+        // (delta << 4) * 1000 stays below 2^31 for 16-bit deltas
+        motion.velocity_q4 = (delta * 16 * 1000) / span_us;
+        motion.interval_us = (uint32_t)span_us / (p->count - 1);
+    }
+    return motion;
+}
+
+uint16_t axis_predictor_extrapolate(uint16_t value, axis_motion_t motion,
+                                    uint32_t age_us, uint32_t horizon_us,
+                                    uint32_t timeout_us)
+{
+    if (motion.interval_us == 0 || age_us > timeout_us ||
+        age_us <= motion.interval_us + motion.interval_us / 2) {
+        return value;
+    }
+
+    uint32_t ahead_us = age_us < horizon_us ? age_us : horizon_us;
+    int32_t predicted = (int32_t)value +
+                        (int32_t)(((int64_t)motion.velocity_q4 * ahead_us) / (16 * 1000));
+
+    if (predicted < 0) predicted = 0;
+    if (predicted > 65535) predicted = 65535;
+    return (uint16_t)predicted;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file boot_trace.c
+ * @brief Boot-phase timing markers implementation
+ */
+
+#include "boot_trace.h"
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "BOOT";
+
+typedef struct {
+    _Atomic(const char *) phase;    // stored last, NULL until written
+    int64_t t_us;
+} boot_mark_t;
+
+static boot_mark_t s_marks[BOOT_TRACE_MAX_MARKS];
+static atomic_uint s_reserved = 0;  // slots claimed by writers
+
+void boot_trace_mark(const char *phase)
+{
+    int64_t now = esp_timer_get_time();
+    unsigned slot = atomic_fetch_add(&s_reserved, 1);
+    if (slot >= BOOT_TRACE_MAX_MARKS) {
+        return;
+    }
+
+    s_marks[slot].t_us = now;
+    atomic_store_explicit(&s_marks[slot].phase, phase, memory_order_release);
+}
+
+void boot_trace_log(void)
+{
+    unsigned reserved = atomic_load(&s_reserved);
+    unsigned count = reserved < BOOT_TRACE_MAX_MARKS ? reserved : BOOT_TRACE_MAX_MARKS;
+    int64_t prev = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        const char *phase = atomic_load_explicit(&s_marks[i].phase, memory_order_acquire);
+        if (phase == NULL) {
+            continue;   // claimed but still being written
+        }
+        // Parallel phases can log slightly out of order; deltas are to the
+        // previous line
+        ESP_LOGI(TAG, "%-16s %7lld us  (+%lld us)", phase,
+                 (long long)s_marks[i].t_us, (long long)(s_marks[i].t_us - prev));
+        prev = s_marks[i].t_us;
+    }
+    if (reserved > BOOT_TRACE_MAX_MARKS) {
+        ESP_LOGW(TAG, "%u boot markers dropped", reserved - BOOT_TRACE_MAX_MARKS);
+    }
+}
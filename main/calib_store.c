@@ -0,0 +1,272 @@
+/**
+ * @file calib_store.c
+ * @brief NVS persistence of calibration, shaping and filter settings
+ *
+ * The record has an explicit packed layout so it does not depend on the
+ * in-memory structs. A new layout gets a new CALIB_RECORD_VERSION; older
+ * versions are rejected and the defaults stay in effect until the next
+ * save.
+ */
+
+#include "calib_store.h"
+#include "data_processor.h"
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "CALIB_STORE";
+
+#define CALIB_NVS_NAMESPACE     "calib"
+#define CALIB_NVS_KEY           "record"
+#define CALIB_RECORD_MAGIC      0x4C43      // "CL"
+#define CALIB_RECORD_VERSION    1
+
+#define CALIB_FLAG_CALIBRATED   (1u << 0)
+#define CALIB_FLAG_FILTER       (1u << 1)
+#define CALIB_FLAG_AUTOCAL      (1u << 2)
+
+typedef struct __attribute__((packed)) {
+    uint16_t deadzone;
+    uint16_t saturation;
+    uint8_t  curve;
+    uint16_t gamma_x100;
+    uint16_t points[AXIS_CURVE_POINTS];
+} calib_shaping_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint16_t left_min;
+    uint16_t left_max;
+    uint16_t right_min;
+    uint16_t right_max;
+    calib_shaping_record_t shaping[DATA_AXIS_COUNT];
+    uint16_t left_press;
+    uint16_t left_release;
+    uint16_t filter_min_cutoff_chz;
+    uint16_t filter_beta;
+    uint16_t filter_d_cutoff_chz;
+    uint32_t crc;               // esp_rom_crc32_le over all preceding bytes
+} calib_record_t;
+
+static TaskHandle_t s_task = NULL;
+static volatile bool s_loading = false;
+static uint32_t s_saved_crc = 0;    // CRC of the record in flash, 0 if none
+
+static uint32_t record_crc(const calib_record_t *rec)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(calib_record_t, crc));
+}
+
+static void capture(calib_record_t *rec)
+{
+    clutch_calibration_t cal;
+    axis_filter_params_t filter;
+
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = CALIB_RECORD_MAGIC;
+    rec->version = CALIB_RECORD_VERSION;
+
+    data_processor_get_calibration(&cal);
+    rec->left_min = cal.left_min;
+    rec->left_max = cal.left_max;
+    rec->right_min = cal.right_min;
+    rec->right_max = cal.right_max;
+    if (cal.calibrated) {
+        rec->flags |= CALIB_FLAG_CALIBRATED;
+    }
+
+    for (int i = 0; i < DATA_AXIS_COUNT; i++) {
+        axis_shaping_t sh;
+        data_processor_get_axis_shaping((data_axis_t)i, &sh);
+        rec->shaping[i].deadzone = sh.deadzone;
+        rec->shaping[i].saturation = sh.saturation;
+        rec->shaping[i].curve = (uint8_t)sh.curve;
+        rec->shaping[i].gamma_x100 = sh.gamma_x100;
+        memcpy(rec->shaping[i].points, sh.points, sizeof(sh.points));
+    }
+
+    uint16_t press, release;
+    data_processor_get_left_threshold(&press, &release);
+    rec->left_press = press;
+    rec->left_release = release;
+
+    if (data_processor_get_filter(&filter)) {
+        rec->flags |= CALIB_FLAG_FILTER;
+    }
+    rec->filter_min_cutoff_chz = filter.min_cutoff_chz;
+    rec->filter_beta = filter.beta;
+    rec->filter_d_cutoff_chz = filter.d_cutoff_chz;
+
+    if (data_processor_get_auto_calibration()) {
+        rec->flags |= CALIB_FLAG_AUTOCAL;
+    }
+
+    rec->crc = record_crc(rec);
+}
+
+static void apply(const calib_record_t *rec)
+{
+    const clutch_calibration_t cal = {
+        .left_min = rec->left_min,
+        .left_max = rec->left_max,
+        .right_min = rec->right_min,
+        .right_max = rec->right_max,
+        .calibrated = (rec->flags & CALIB_FLAG_CALIBRATED) != 0,
+    };
+    data_processor_set_calibration(&cal);
+
+    for (int i = 0; i < DATA_AXIS_COUNT; i++) {
+        axis_shaping_t sh = {
+            .deadzone = rec->shaping[i].deadzone,
+            .saturation = rec->shaping[i].saturation,
+            .curve = (axis_curve_t)rec->shaping[i].curve,
+            .gamma_x100 = rec->shaping[i].gamma_x100,
+        };
+        memcpy(sh.points, rec->shaping[i].points, sizeof(sh.points));
+        if (data_processor_set_axis_shaping((data_axis_t)i, &sh) != ESP_OK) {
+            ESP_LOGW(TAG, "Stored shaping of axis %d rejected, keeping default", i);
+        }
+    }
+
+    if (data_processor_set_left_threshold(rec->left_press, rec->left_release) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored left threshold rejected, keeping default");
+    }
+
+    const axis_filter_params_t filter = {
+        .min_cutoff_chz = rec->filter_min_cutoff_chz,
+        .beta = rec->filter_beta,
+        .d_cutoff_chz = rec->filter_d_cutoff_chz,
+    };
+    data_processor_set_filter((rec->flags & CALIB_FLAG_FILTER) != 0, &filter);
+
+    data_processor_set_auto_calibration((rec->flags & CALIB_FLAG_AUTOCAL) != 0);
+}
+
+esp_err_t calib_store_load(void)
+{
+    nvs_handle_t handle;
+    calib_record_t rec;
+    size_t len = sizeof(rec);
+
+    esp_err_t ret = nvs_open(CALIB_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, CALIB_NVS_KEY, &rec, &len);
+        nvs_close(handle);
+    }
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No stored calibration, using defaults");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK) {
+        // Includes a blob larger than this version's record
+        ESP_LOGW(TAG, "Failed to read stored calibration: 0x%x", ret);
+        return ret;
+    }
+
+    if (len != sizeof(rec) || rec.magic != CALIB_RECORD_MAGIC ||
+        rec.version != CALIB_RECORD_VERSION) {
+        ESP_LOGW(TAG, "Stored calibration has unsupported layout (%u bytes), ignored",
+                 (unsigned)len);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (rec.crc != record_crc(&rec)) {
+        ESP_LOGW(TAG, "Stored calibration CRC mismatch, ignored");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    s_loading = true;
+    apply(&rec);
+    s_loading = false;
+    s_saved_crc = rec.crc;
+
+    ESP_LOGI(TAG, "Calibration restored (left %u-%u, right %u-%u%s)",
+             rec.left_min, rec.left_max, rec.right_min, rec.right_max,
+             (rec.flags & CALIB_FLAG_CALIBRATED) ? "" : ", uncalibrated");
+    return ESP_OK;
+}
+
+esp_err_t calib_store_save(void)
+{
+    calib_record_t rec;
+    capture(&rec);
+
+    if (rec.crc == s_saved_crc) {
+        return ESP_OK;  // unchanged, spare the flash
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CALIB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed: 0x%x", ret);
+        return ret;
+    }
+
+    ret = nvs_set_blob(handle, CALIB_NVS_KEY, &rec, sizeof(rec));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save calibration: 0x%x", ret);
+        return ret;
+    }
+
+    s_saved_crc = rec.crc;
+    ESP_LOGI(TAG, "Calibration saved (%u bytes)", (unsigned)sizeof(rec));
+    return ESP_OK;
+}
+
+esp_err_t calib_store_erase(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CALIB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = nvs_erase_key(handle, CALIB_NVS_KEY);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+    nvs_close(handle);
+
+    s_saved_crc = 0;
+    return ret;
+}
+
+void calib_store_request_save(void)
+{
+    TaskHandle_t task = s_task;
+    if (task != NULL && !s_loading) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void task_calib_store(void *arg)
+{
+    (void)arg;
+
+    const TickType_t quiet_ticks = pdMS_TO_TICKS(CONFIG_CLUTCH_CALIB_SAVE_DELAY_MS);
+    s_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Debounce: restart the quiet period on every further request
+        while (ulTaskNotifyTake(pdTRUE, quiet_ticks) > 0) {
+        }
+
+        calib_store_save();
+    }
+}
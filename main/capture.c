@@ -0,0 +1,410 @@
+/**
+ * @file capture.c
+ * @brief ESP-NOW capture and replay implementation
+ *
+ * The ring is a byte buffer with free-running head/tail offsets. While
+ * recording only the WiFi task touches it; while idle only readers do;
+ * while replaying only the replay timer does.
+ *
+ * Exactly one producer may feed the ingest ring: the radio path outside
+ * a replay, the replay timer during one. Both enter through s_in_rx and
+ * check the state inside it. A state change first moves to STATE_SWITCHING,
+ * where neither side pushes, and waits for s_in_rx to drain before the
+ * new owner starts. That wait, and the one for the ingest ring to drain
+ * before a replay, run in task_capture; other tasks only post requests.
+ */
+
+#include "capture.h"
+#include "hot_path.h"
+#include "ingest.h"
+#include "espnow_handler.h"
+#include "link_quality.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+#if CONFIG_CLUTCH_CAPTURE
+
+static const char *TAG = "CAPTURE";
+
+#define STATE_SWITCHING     (CAPTURE_REPLAYING + 1)
+
+// The offsets wrap at 2^32 (a flight recorder from boot gets there), which
+// only lands on a ring boundary if the ring size divides it
+_Static_assert((CONFIG_CLUTCH_CAPTURE_BUFFER_KB & (CONFIG_CLUTCH_CAPTURE_BUFFER_KB - 1)) == 0,
+               "CONFIG_CLUTCH_CAPTURE_BUFFER_KB must be a power of two");
+
+static uint8_t *s_buf = NULL;
+static uint32_t s_size = 0;
+static uint32_t s_head = 0;         // free-running byte offsets
+static uint32_t s_tail = 0;
+static uint32_t s_records = 0;
+static uint32_t s_overwritten = 0;
+
+static atomic_int s_state = CAPTURE_IDLE;
+static atomic_int s_in_rx = 0;
+
+/* Pending capture_request(), -1 = none */
+#define NO_REQUEST          (-1)
+static atomic_int s_request = NO_REQUEST;
+static TaskHandle_t s_task = NULL;
+
+/* Replay, owned by the replay timer while replaying */
+static esp_timer_handle_t s_replay_timer = NULL;
+static uint32_t s_replay_pos = 0;
+static uint32_t s_replay_t0 = 0;          // rx_time_us of the first record
+static int64_t s_replay_start_us = 0;
+static uint32_t s_replayed = 0;
+static uint32_t s_replay_late_max_us = 0;
+static uint8_t s_replay_payload[ESPNOW_MAX_DATA_LEN];
+
+static HOT_PATH_FN void ring_write(uint32_t offset, const void *src, uint32_t len)
+{
+    uint32_t at = offset % s_size;
+    uint32_t first = len < s_size - at ? len : s_size - at;
+    memcpy(s_buf + at, src, first);
+    memcpy(s_buf, (const uint8_t *)src + first, len - first);
+}
+
+static void ring_read(uint32_t offset, void *dst, uint32_t len)
+{
+    uint32_t at = offset % s_size;
+    uint32_t first = len < s_size - at ? len : s_size - at;
+    memcpy(dst, s_buf + at, first);
+    memcpy((uint8_t *)dst + first, s_buf, len - first);
+}
+
+static HOT_PATH_FN void append(const uint8_t *mac_addr, const uint8_t *data, int len,
+                               int8_t rssi, int64_t rx_time_us)
+{
+    uint32_t need = sizeof(capture_record_t) + (uint32_t)len;
+
+    // Overwrite the oldest records until the new one fits
+    while (s_size - (s_head - s_tail) < need) {
+        capture_record_t old;
+        ring_read(s_tail, &old, sizeof(old));
+        s_tail += sizeof(old) + old.len;
+        s_records--;
+        s_overwritten++;
+    }
+
+    capture_record_t rec = {
+        .rx_time_us = (uint32_t)rx_time_us,
+        .rssi = rssi,
+        .len = (uint8_t)len,
+    };
+    memcpy(rec.mac, mac_addr, sizeof(rec.mac));
+    ring_write(s_head, &rec, sizeof(rec));
+    ring_write(s_head + sizeof(rec), data, (uint32_t)len);
+    s_head += need;
+    s_records++;
+}
+
+/* Move to a new state once no producer is inside the ingest ring */
+static void switch_state(int state)
+{
+    atomic_store(&s_state, STATE_SWITCHING);
+    while (atomic_load(&s_in_rx) != 0) {
+        vTaskDelay(1);
+    }
+    atomic_store(&s_state, state);
+}
+
+HOT_PATH_FN bool capture_rx(const uint8_t *mac_addr, const uint8_t *data, int len,
+                            int8_t rssi, int64_t rx_time_us)
+{
+    bool queued = false;
+
+    atomic_fetch_add(&s_in_rx, 1);
+    int state = atomic_load(&s_state);
+    if (state == CAPTURE_RECORDING && len <= ESPNOW_MAX_DATA_LEN) {
+        append(mac_addr, data, len, rssi, rx_time_us);
+    }
+    if (state == CAPTURE_IDLE || state == CAPTURE_RECORDING) {
+        queued = ingest_push(mac_addr, data, len, rssi, rx_time_us);
+    }
+    atomic_fetch_sub(&s_in_rx, 1);
+    return queued;
+}
+
+/* Push every record that is due, then re-arm for the next one */
+static void replay_timer_cb(void *arg)
+{
+    (void)arg;
+
+    atomic_fetch_add(&s_in_rx, 1);
+    if (atomic_load(&s_state) != CAPTURE_REPLAYING) {
+        atomic_fetch_sub(&s_in_rx, 1);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t due = now;
+    while (s_replay_pos != s_head) {
+        capture_record_t rec;
+        ring_read(s_replay_pos, &rec, sizeof(rec));
+        due = s_replay_start_us + (uint32_t)(rec.rx_time_us - s_replay_t0);
+        if (due > now) {
+            break;
+        }
+
+        uint32_t late = (uint32_t)(now - due);
+        if (late > s_replay_late_max_us) {
+            s_replay_late_max_us = late;
+        }
+        ring_read(s_replay_pos + sizeof(rec), s_replay_payload, rec.len);
+        ingest_push(rec.mac, s_replay_payload, rec.len, rec.rssi, now);
+        s_replay_pos += sizeof(rec) + rec.len;
+        s_replayed++;
+    }
+
+    bool done = s_replay_pos == s_head;
+    if (done) {
+        atomic_store(&s_state, CAPTURE_IDLE);   // no more pushes from here
+    } else {
+        esp_timer_start_once(s_replay_timer, (uint64_t)(due - now));
+    }
+    atomic_fetch_sub(&s_in_rx, 1);
+
+    if (done) {
+        ESP_LOGI(TAG, "Replay done: %lu records, worst lateness %lu us",
+                 (unsigned long)s_replayed, (unsigned long)s_replay_late_max_us);
+    }
+}
+
+esp_err_t capture_init(void)
+{
+    uint32_t size = CONFIG_CLUTCH_CAPTURE_BUFFER_KB * 1024u;
+
+    s_buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_buf == NULL) {
+        s_buf = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (s_buf == NULL) {
+        ESP_LOGE(TAG, "No memory for a %lu KB capture ring",
+                 (unsigned long)CONFIG_CLUTCH_CAPTURE_BUFFER_KB);
+        return ESP_ERR_NO_MEM;
+    }
+    s_size = size;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = replay_timer_cb,
+        .name = "capture_replay",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_replay_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Capture ring ready (%lu KB, %s)",
+             (unsigned long)CONFIG_CLUTCH_CAPTURE_BUFFER_KB,
+             esp_ptr_external_ram(s_buf) ? "PSRAM" : "internal RAM");
+
+#if CONFIG_CLUTCH_CAPTURE_AT_BOOT
+    return capture_start();
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t capture_start(void)
+{
+    if (s_buf == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    capture_stop();
+    s_head = 0;
+    s_tail = 0;
+    s_records = 0;
+    s_overwritten = 0;
+    atomic_store(&s_state, CAPTURE_RECORDING);
+
+    ESP_LOGI(TAG, "Recording");
+    return ESP_OK;
+}
+
+void capture_stop(void)
+{
+    int state = atomic_load(&s_state);
+    if (state == CAPTURE_IDLE) {
+        return;
+    }
+
+    switch_state(CAPTURE_IDLE);
+    if (s_replay_timer != NULL) {
+        esp_timer_stop(s_replay_timer);
+    }
+    ESP_LOGI(TAG, "Stopped (%lu records, %lu bytes)",
+             (unsigned long)s_records, (unsigned long)(s_head - s_tail));
+}
+
+esp_err_t capture_replay(void)
+{
+    if (s_buf == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (atomic_load(&s_state) != CAPTURE_IDLE || s_records == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    capture_record_t first;
+    ring_read(s_tail, &first, sizeof(first));
+    s_replay_pos = s_tail;
+    s_replay_t0 = first.rx_time_us;
+    s_replayed = 0;
+    s_replay_late_max_us = 0;
+
+    switch_state(CAPTURE_REPLAYING);
+
+    // Let the ingest task finish the live frames (depth counts the one
+    // being handled), then restart sequence tracking so the older replayed
+    // sequence numbers are not stale. The restart itself is applied by the
+    // ingest task before the first replayed frame.
+    ingest_stats_t ring;
+    for (ingest_get_stats(&ring); ring.depth != 0; ingest_get_stats(&ring)) {
+        vTaskDelay(1);
+    }
+    link_quality_restart_sequences();
+
+    s_replay_start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Replaying %lu records", (unsigned long)s_records);
+    return esp_timer_start_once(s_replay_timer, 0);
+}
+
+esp_err_t capture_request(capture_state_t state)
+{
+    if (s_buf == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (state > CAPTURE_REPLAYING) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_store(&s_request, (int)state);
+    TaskHandle_t task = s_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+    return ESP_OK;
+}
+
+void task_capture(void *arg)
+{
+    (void)arg;
+
+    s_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int request = atomic_exchange(&s_request, NO_REQUEST);
+        if (request == CAPTURE_RECORDING) {
+            capture_start();
+        } else if (request == CAPTURE_REPLAYING) {
+            esp_err_t ret = capture_replay();
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Replay not started: 0x%x", ret);
+            }
+        } else if (request == CAPTURE_IDLE) {
+            capture_stop();
+        }
+    }
+}
+
+capture_state_t capture_get_state(void)
+{
+    int state = atomic_load(&s_state);
+    return state == STATE_SWITCHING ? CAPTURE_IDLE : (capture_state_t)state;
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->state = capture_get_state();
+    stats->records = s_records;
+    stats->bytes = s_head - s_tail;
+    stats->capacity = s_size;
+    stats->overwritten = s_overwritten;
+    stats->replayed = s_replayed;
+    stats->replay_late_max_us = s_replay_late_max_us;
+}
+
+size_t capture_read(uint32_t offset, void *buf, size_t len)
+{
+    if (s_buf == NULL || buf == NULL || atomic_load(&s_state) != CAPTURE_IDLE) {
+        return 0;
+    }
+
+    uint32_t stored = s_head - s_tail;
+    if (offset >= stored) {
+        return 0;
+    }
+    if (len > stored - offset) {
+        len = stored - offset;
+    }
+    ring_read(s_tail + offset, buf, (uint32_t)len);
+    return len;
+}
+
+#else /* !CONFIG_CLUTCH_CAPTURE */
+
+esp_err_t capture_init(void)
+{
+    return ESP_OK;
+}
+
+HOT_PATH_FN bool capture_rx(const uint8_t *mac_addr, const uint8_t *data, int len,
+                            int8_t rssi, int64_t rx_time_us)
+{
+    return ingest_push(mac_addr, data, len, rssi, rx_time_us);
+}
+
+esp_err_t capture_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void capture_stop(void)
+{
+}
+
+esp_err_t capture_replay(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t capture_request(capture_state_t state)
+{
+    (void)state;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+capture_state_t capture_get_state(void)
+{
+    return CAPTURE_IDLE;
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+size_t capture_read(uint32_t offset, void *buf, size_t len)
+{
+    (void)offset;
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+#endif /* CONFIG_CLUTCH_CAPTURE */
@@ -0,0 +1,329 @@
+/**
+ * @file channel_manager.c
+ * @brief Channel survey and coordinated hopping implementation
+ *
+ * cost = busy_permille + 10 * (noise_dbm above -95 dBm) + loss_permille
+ *
+ * Frames from registered senders are not counted as foreign airtime, so
+ * the home channel is not penalized for our own traffic. The home channel
+ * only changes when another channel is cheaper by CHANNEL_SWITCH_MARGIN.
+ */
+
+#include "channel_manager.h"
+#include "espnow_handler.h"
+#include "espnow_wire.h"
+#include "link_quality.h"
+#include "sender_registry.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "CHANNEL";
+
+#define LOOP_MS                 100
+#define CHECK_INTERVAL_MS       1000    // loss window
+#define RESURVEY_CHECKS         3       // consecutive lossy windows
+#define MIN_WINDOW_PACKETS      50      // ignore windows with less traffic
+#define HOME_GAP_MS             100     // back home between re-survey dwells
+#define ANNOUNCE_REPEATS        5
+#define ANNOUNCE_SPACING_MS     20
+#define RENDEZVOUS_VISIT_MS     10
+#define CHANNEL_SWITCH_MARGIN   100
+#define NOISE_REFERENCE_DBM     (-95)
+#define WIFI_HDR_ADDR2_OFFSET   10      // transmitter address in the 802.11 header
+
+/* Promiscuous accumulators: written by the WiFi task while a dwell runs,
+ * read by this task after promiscuous mode is switched off again */
+static volatile uint32_t s_dwell_frames = 0;
+static volatile uint32_t s_dwell_bytes = 0;
+static volatile int32_t s_dwell_noise_sum = 0;
+
+static channel_survey_entry_t s_channels[CONFIG_CLUTCH_CHANNEL_MAX];
+static TaskHandle_t s_task = NULL;
+static uint16_t s_epoch = 0;
+static bool s_hopped = false;           // surveyed or moved during the loss window
+static uint32_t s_last_packets = 0;
+static uint32_t s_last_lost = 0;
+
+#if CONFIG_CLUTCH_RENDEZVOUS_CHANNEL > CONFIG_CLUTCH_CHANNEL_MAX
+#error "CONFIG_CLUTCH_RENDEZVOUS_CHANNEL must be one of the surveyed channels"
+#endif
+
+static void promiscuous_cb(void *buf, wifi_promiscuous_pkt_type_t type)
+{
+    (void)type;
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    uint32_t len = pkt->rx_ctrl.sig_len;
+
+    if (len > WIFI_HDR_ADDR2_OFFSET + 6 &&
+        sender_registry_lookup(pkt->payload + WIFI_HDR_ADDR2_OFFSET) >= 0) {
+        return;     // our own traffic
+    }
+
+    s_dwell_frames++;
+    s_dwell_bytes += len;
+    s_dwell_noise_sum += pkt->rx_ctrl.noise_floor;
+}
+
+static void update_cost(channel_survey_entry_t *e)
+{
+    int noise_penalty = (e->noise_dbm - NOISE_REFERENCE_DBM) * 10;
+    if (noise_penalty < 0) noise_penalty = 0;
+
+    uint32_t cost = (uint32_t)e->busy_permille + (uint32_t)noise_penalty + e->loss_permille;
+    e->cost = cost > UINT16_MAX ? UINT16_MAX : (uint16_t)cost;
+}
+
+static void dwell(channel_survey_entry_t *e)
+{
+    const uint32_t dwell_ms = CONFIG_CLUTCH_CHANNEL_DWELL_MS;
+
+    s_dwell_frames = 0;
+    s_dwell_bytes = 0;
+    s_dwell_noise_sum = 0;
+
+    espnow_handler_set_channel(e->channel);
+    esp_wifi_set_promiscuous(true);
+    vTaskDelay(pdMS_TO_TICKS(dwell_ms));
+    esp_wifi_set_promiscuous(false);
+
+    // 6 bits per us: bytes * 8 / 6 us of airtime over dwell_ms * 1000 us
+    uint32_t busy = (uint32_t)(((uint64_t)s_dwell_bytes * 4) / (3 * dwell_ms));
+    e->busy_permille = busy > 1000 ? 1000 : (uint16_t)busy;
+    // Without frames there is no noise reading; assume the reference
+    e->noise_dbm = s_dwell_frames > 0 ? (int8_t)(s_dwell_noise_sum / (int32_t)s_dwell_frames)
+                                      : NOISE_REFERENCE_DBM;
+    e->surveyed = true;
+    update_cost(e);
+}
+
+/* Measure every channel; interleave returns home while senders are active */
+static void survey(bool interleave)
+{
+    uint8_t home = espnow_handler_get_channel();
+
+    ESP_LOGI(TAG, "Surveying channels 1-%d%s", CONFIG_CLUTCH_CHANNEL_MAX,
+             interleave ? " (interleaved)" : "");
+
+    esp_wifi_set_promiscuous_rx_cb(promiscuous_cb);
+    for (int i = 0; i < CONFIG_CLUTCH_CHANNEL_MAX; i++) {
+        dwell(&s_channels[i]);
+        if (interleave) {
+            espnow_handler_set_channel(home);
+            vTaskDelay(pdMS_TO_TICKS(HOME_GAP_MS));
+        }
+    }
+    espnow_handler_set_channel(home);
+    s_hopped = true;
+
+    for (int i = 0; i < CONFIG_CLUTCH_CHANNEL_MAX; i++) {
+        const channel_survey_entry_t *e = &s_channels[i];
+        ESP_LOGI(TAG, "  ch %2u: busy %3u.%u%% noise %4d dBm loss %3u.%u%% cost %u",
+                 e->channel, e->busy_permille / 10, e->busy_permille % 10, e->noise_dbm,
+                 e->loss_permille / 10, e->loss_permille % 10, e->cost);
+    }
+}
+
+static void send_channel_frame(uint8_t channel, uint16_t switch_in_ms)
+{
+    const espnow_wire_channel_t body = {
+        .channel = channel,
+        .rendezvous = CONFIG_CLUTCH_RENDEZVOUS_CHANNEL,
+        .switch_in_ms = switch_in_ms,
+        .epoch = s_epoch,
+    };
+
+    esp_err_t ret = espnow_handler_send_wire(NULL, ESPNOW_WIRE_TYPE_CHANNEL,
+                                             &body, sizeof(body));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Channel announcement failed: 0x%x", ret);
+    }
+}
+
+/* Announce the change a few times, counting down to the same instant */
+static void switch_to(uint8_t channel)
+{
+    uint8_t from = espnow_handler_get_channel();
+
+    s_epoch++;
+    for (int i = ANNOUNCE_REPEATS - 1; i >= 0; i--) {
+        send_channel_frame(channel, (uint16_t)(i * ANNOUNCE_SPACING_MS));
+        if (i > 0) {
+            vTaskDelay(pdMS_TO_TICKS(ANNOUNCE_SPACING_MS));
+        }
+    }
+
+    espnow_handler_set_channel(channel);
+    s_hopped = true;
+    ESP_LOGI(TAG, "Home channel %u -> %u (epoch %u)", from, channel, s_epoch);
+}
+
+/* Pick up senders that fell back to the rendezvous channel. The short
+ * absence stays in the loss windows, well below the re-survey threshold. */
+static void visit_rendezvous(uint8_t home)
+{
+    espnow_handler_set_channel(CONFIG_CLUTCH_RENDEZVOUS_CHANNEL);
+    send_channel_frame(home, 0);
+    vTaskDelay(pdMS_TO_TICKS(RENDEZVOUS_VISIT_MS));
+    espnow_handler_set_channel(home);
+}
+
+static void choose_channel(void)
+{
+    uint8_t home = espnow_handler_get_channel();
+    const channel_survey_entry_t *best = &s_channels[home - 1];
+    uint16_t home_cost = best->cost;
+
+    for (int i = 0; i < CONFIG_CLUTCH_CHANNEL_MAX; i++) {
+        if (s_channels[i].cost < best->cost) {
+            best = &s_channels[i];
+        }
+    }
+
+    if (best->channel != home && home_cost - best->cost >= CHANNEL_SWITCH_MARGIN) {
+        switch_to(best->channel);
+    } else {
+        ESP_LOGI(TAG, "Staying on channel %u (cost %u)", home, home_cost);
+    }
+}
+
+/* Loss over the last window from the sequence tracking, -1 if unusable */
+static int window_loss_permille(void)
+{
+    uint32_t packets = 0, lost = 0;
+    link_quality_entry_t e;
+
+    for (size_t i = 0; link_quality_get(i, &e) == ESP_OK; i++) {
+        packets += e.packets;
+        lost += e.lost;
+    }
+
+    uint32_t d_packets = packets - s_last_packets;
+    uint32_t d_lost = lost - s_last_lost;
+    s_last_packets = packets;
+    s_last_lost = lost;
+
+    bool hopped = s_hopped;
+    s_hopped = false;
+    if (hopped || d_packets + d_lost < MIN_WINDOW_PACKETS) {
+        return -1;  // a survey or move would read as loss
+    }
+    return (int)((d_lost * 1000) / (d_packets + d_lost));
+}
+
+void channel_manager_request_survey(void)
+{
+    TaskHandle_t task = s_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+esp_err_t channel_manager_get_survey(uint8_t channel, channel_survey_entry_t *entry)
+{
+    if (channel < 1 || channel > CONFIG_CLUTCH_CHANNEL_MAX || entry == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *entry = s_channels[channel - 1];
+    return ESP_OK;
+}
+
+int channel_manager_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    int n = snprintf(buf, len, "{\"channel\":%u,\"rendezvous\":%u,\"survey\":[",
+                     espnow_handler_get_channel(), CONFIG_CLUTCH_RENDEZVOUS_CHANNEL);
+    pos = (n > 0) ? (size_t)n : 0;
+
+    for (int i = 0; pos < len && i < CONFIG_CLUTCH_CHANNEL_MAX; i++) {
+        const channel_survey_entry_t *e = &s_channels[i];
+        n = snprintf(buf + pos, len - pos,
+                     "%s{\"channel\":%u,\"surveyed\":%s,\"busy_permille\":%u,"
+                     "\"noise_dbm\":%d,\"loss_permille\":%u,\"cost\":%u}",
+                     i ? "," : "", e->channel, e->surveyed ? "true" : "false",
+                     e->busy_permille, e->noise_dbm, e->loss_permille, e->cost);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "]}");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
+
+void task_channel_manager(void *arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < CONFIG_CLUTCH_CHANNEL_MAX; i++) {
+        s_channels[i] = (channel_survey_entry_t){
+            .channel = (uint8_t)(i + 1),
+            .noise_dbm = NOISE_REFERENCE_DBM,
+        };
+    }
+    s_task = xTaskGetCurrentTaskHandle();
+
+#if CONFIG_CLUTCH_CHANNEL_SURVEY_AT_BOOT
+    // No sender has been told a channel yet, so no need to interleave
+    survey(false);
+    choose_channel();
+#endif
+
+    int64_t next_check_us = esp_timer_get_time() + CHECK_INTERVAL_MS * 1000LL;
+    int64_t next_visit_us = esp_timer_get_time() + CONFIG_CLUTCH_RENDEZVOUS_INTERVAL_MS * 1000LL;
+    int64_t holdoff_until_us = esp_timer_get_time() + CONFIG_CLUTCH_CHANNEL_RESURVEY_HOLDOFF_S * 1000000LL;
+    int lossy_windows = 0;
+
+    while (1) {
+        bool requested = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_MS)) > 0;
+        int64_t now = esp_timer_get_time();
+        uint8_t home = espnow_handler_get_channel();
+
+        if (now >= next_check_us) {
+            next_check_us = now + CHECK_INTERVAL_MS * 1000LL;
+
+            int loss = window_loss_permille();
+            if (loss >= 0) {
+                channel_survey_entry_t *e = &s_channels[home - 1];
+                e->loss_permille = (uint16_t)((loss + 3 * e->loss_permille) / 4);
+                update_cost(e);
+
+                bool lossy = CONFIG_CLUTCH_CHANNEL_RESURVEY_LOSS_PERMILLE > 0 &&
+                             loss >= CONFIG_CLUTCH_CHANNEL_RESURVEY_LOSS_PERMILLE;
+                lossy_windows = lossy ? lossy_windows + 1 : 0;
+            }
+        }
+
+        if (requested || (lossy_windows >= RESURVEY_CHECKS && now >= holdoff_until_us)) {
+            if (!requested) {
+                ESP_LOGW(TAG, "Sustained loss on channel %u, re-surveying", home);
+            }
+            survey(true);
+            choose_channel();
+            lossy_windows = 0;
+            holdoff_until_us = esp_timer_get_time() + CONFIG_CLUTCH_CHANNEL_RESURVEY_HOLDOFF_S * 1000000LL;
+            continue;
+        }
+
+        if (CONFIG_CLUTCH_RENDEZVOUS_INTERVAL_MS > 0 && now >= next_visit_us) {
+            next_visit_us = now + CONFIG_CLUTCH_RENDEZVOUS_INTERVAL_MS * 1000LL;
+            if (home != CONFIG_CLUTCH_RENDEZVOUS_CHANNEL) {
+                visit_rendezvous(home);
+            }
+        }
+    }
+}
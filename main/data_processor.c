@@ -4,16 +4,51 @@
  */
 
 #include "data_processor.h"
+#include "hot_path.h"
 #include "shared_state.h"
+#include "usb_comm.h"
+#include "deferred_log.h"
+#include "link_quality.h"
+#include "sender_registry.h"
+#include "rate_control.h"
+#include "espnow_wire.h"
+#include "axis_filter.h"
+#include "axis_predictor.h"
+#include "latency_stats.h"
+#include "calib_store.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "power.h"
+#include "ingest.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#if CONFIG_CLUTCH_BENCHMARKS
+#include "esp_cpu.h"
+#endif
 
 static const char *TAG = "DATA_PROCESSOR";
 
 static bool s_is_initialized = false;
-static uint32_t s_total_packets = 0;
-static uint32_t s_total_bytes = 0;
+
+// Senders mapped to the left paddle that currently hold it past the threshold
+// (ingest task, and release_sender once the ingest task has let go)
+static atomic_uint s_left_pressed_senders = 0;
+
+// Newest packet metadata, read from other tasks
+/* Telemetry trace of the packet being processed, ingest task only */
+static telemetry_sample_t s_trace;
+
+static data_packet_info_t s_last_packet_info = {0};
+static bool s_have_last_packet = false;
+static portMUX_TYPE s_info_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Calibration state
 static clutch_calibration_t s_calibration = {
@@ -25,13 +60,388 @@ static clutch_calibration_t s_calibration = {
 };
 
 static bool s_is_calibrating = false;
-static int64_t s_calibration_start_time = 0;
-static uint32_t s_calibration_duration_ms = 0;
 static uint16_t s_calib_left_min = 4095;
 static uint16_t s_calib_left_max = 0;
 static uint16_t s_calib_right_min = 4095;
 static uint16_t s_calib_right_max = 0;
 
+// Timed calibration ends from a timer; table rebuilds requested from the
+// packet path run in task_calibration, never in the ingest task
+static esp_timer_handle_t s_calibration_timer = NULL;
+static TaskHandle_t s_calibration_task = NULL;
+static atomic_bool s_timed_calibration_done = false;
+static atomic_bool s_autocal_pending = false;
+
+// A timed run must see at least this much travel (12-bit counts) on an
+// axis; less means the paddle sent nothing or did not move
+#define CALIBRATION_MIN_SPAN    256
+
+/*
+ * Background auto-calibration: per-axis min/max envelopes in Q20. An
+ * envelope expands instantly to a new extreme and otherwise decays towards
+ * the current sample by 2^-CONFIG_CLUTCH_AUTOCAL_DECAY_SHIFT per sample,
+ * but never below CONFIG_CLUTCH_AUTOCAL_MIN_SPAN, so endstop drift from
+ * temperature or magnet wear is followed without a calibration run.
+ */
+#define ENVELOPE_FRAC_BITS      20
+#define ENVELOPE_MIN_SPAN_Q20   ((uint32_t)CONFIG_CLUTCH_AUTOCAL_MIN_SPAN << ENVELOPE_FRAC_BITS)
+#define AUTOCAL_REBUILD_GAP_MS  100     // coalesce drift-triggered rebuilds
+
+typedef struct {
+    uint32_t min_q20;
+    uint32_t max_q20;                   // < min_q20 until the first sample
+} envelope_t;
+
+static bool s_auto_calibration = false;
+static envelope_t s_envelopes[DATA_AXIS_COUNT];
+
+/*
+ * Calibration lookup tables: raw 12-bit ADC value -> calibrated, 16-bit
+ * scaled axis value. Replaces two divisions per axis and packet with one
+ * load. Double-buffered: writers build the inactive table and publish it
+ * with an atomic pointer swap. The ingest task (the only reader) announces
+ * the table it is using in s_lut_hazard, and writers never touch a table
+ * that is announced there.
+ */
+#define ADC_LEVELS              4096
+#define SCALE_12_TO_16(v)       ((uint16_t)(((uint32_t)(v) * 65535u) / 4095u))
+
+typedef struct {
+    uint16_t left[ADC_LEVELS];
+    uint16_t right[ADC_LEVELS];
+} calib_lut_t;
+
+static calib_lut_t s_luts[2];
+static _Atomic(calib_lut_t *) s_active_lut = &s_luts[0];
+static _Atomic(calib_lut_t *) s_lut_hazard = NULL;
+static SemaphoreHandle_t s_lut_mutex = NULL;
+
+/* Per-axis shaping, folded into the tables by rebuild_calibration_lut() */
+#define AXIS_SHAPING_IDENTITY { .curve = AXIS_CURVE_LINEAR, .gamma_x100 = 100 }
+static axis_shaping_t s_shaping[DATA_AXIS_COUNT] = {
+    AXIS_SHAPING_IDENTITY, AXIS_SHAPING_IDENTITY,
+};
+
+/* Left paddle thresholds in the 16-bit domain: low half = press (used
+ * while released), high half = release (used while pressed) */
+#define PACK_THRESHOLDS(press, release) \
+    ((uint32_t)SCALE_12_TO_16(press) | ((uint32_t)SCALE_12_TO_16(release) << 16))
+/* Optional adaptive filter on the right clutch, one state per sender slot.
+ * Parameters are read without a lock: a sample taken mid-update mixes old
+ * and new values, which is harmless. */
+#if CONFIG_CLUTCH_AXIS_FILTER
+static bool s_filter_enabled = true;
+#else
+static bool s_filter_enabled = false;
+#endif
+static axis_filter_params_t s_filter_params = {
+    .min_cutoff_chz = CONFIG_CLUTCH_AXIS_FILTER_MIN_CUTOFF_CHZ,
+    .beta = CONFIG_CLUTCH_AXIS_FILTER_BETA,
+    .d_cutoff_chz = CONFIG_CLUTCH_AXIS_FILTER_D_CUTOFF_CHZ,
+};
+static axis_filter_t s_right_filters[SENDER_REGISTRY_CAPACITY];
+
+#if CONFIG_CLUTCH_AXIS_PREDICTOR
+/* Right clutch sample history for dead reckoning in the HID reporter */
+static axis_predictor_t s_right_predictors[SENDER_REGISTRY_CAPACITY];
+#endif
+
+_Static_assert(CONFIG_CLUTCH_LEFT_RELEASE_THRESHOLD <= CONFIG_CLUTCH_LEFT_PRESS_THRESHOLD,
+               "left paddle release threshold must not exceed the press threshold");
+static _Atomic uint32_t s_left_thresholds =
+    PACK_THRESHOLDS(CONFIG_CLUTCH_LEFT_PRESS_THRESHOLD, CONFIG_CLUTCH_LEFT_RELEASE_THRESHOLD);
+static uint16_t s_left_press = CONFIG_CLUTCH_LEFT_PRESS_THRESHOLD;      // 12-bit, as set
+static uint16_t s_left_release = CONFIG_CLUTCH_LEFT_RELEASE_THRESHOLD;
+
+/* Map [min, max] -> [0, 4095] as the per-packet path used to */
+static uint16_t calibrate_level(uint16_t raw, uint16_t min, uint16_t max, bool calibrated)
+{
+    uint16_t value = raw;
+
+    if (calibrated) {
+        if (raw <= min) {
+            value = 0;
+        } else if (raw >= max) {
+            value = 4095;
+        } else {
+            uint32_t range = max - min;
+            if (range > 0) {
+                value = ((uint32_t)(raw - min) * 4095) / range;
+            }
+        }
+    }
+    return value;
+}
+
+/* Deadzone / saturation, then the response curve; 12-bit in and out */
+static uint16_t shape_level(uint16_t value, const axis_shaping_t *sh)
+{
+    const uint16_t low = sh->deadzone;
+    const uint16_t high = 4095 - sh->saturation;
+
+    if (value <= low) {
+        value = 0;
+    } else if (value >= high) {
+        value = 4095;
+    } else if (low > 0 || high < 4095) {
+        value = ((uint32_t)(value - low) * 4095) / (high - low);
+    }
+
+    switch (sh->curve) {
+        case AXIS_CURVE_GAMMA:
+            value = (uint16_t)lroundf(powf(value / 4095.0f, sh->gamma_x100 / 100.0f) * 4095.0f);
+            break;
+        case AXIS_CURVE_PIECEWISE: {
+            uint32_t pos = (uint32_t)value * (AXIS_CURVE_POINTS - 1);
+            uint32_t seg = pos / 4095;
+            if (seg >= AXIS_CURVE_POINTS - 1) {
+                value = sh->points[AXIS_CURVE_POINTS - 1];
+            } else {
+                int32_t y0 = sh->points[seg];
+                int32_t y1 = sh->points[seg + 1];
+                value = (uint16_t)(y0 + ((y1 - y0) * (int32_t)(pos % 4095)) / 4095);
+            }
+            break;
+        }
+        case AXIS_CURVE_LINEAR:
+        default:
+            break;
+    }
+    return value;
+}
+
+/**
+ * @brief Rebuild the inactive lookup table from s_calibration and
+ *        s_shaping and swap it in
+ *
+ * Called whenever the calibration bounds or shaping change, never per packet.
+ */
+static void rebuild_calibration_lut(void)
+{
+    if (s_lut_mutex != NULL) {
+        xSemaphoreTake(s_lut_mutex, portMAX_DELAY);
+    }
+
+    calib_lut_t *active = atomic_load(&s_active_lut);
+    calib_lut_t *next = (active == &s_luts[0]) ? &s_luts[1] : &s_luts[0];
+
+    // The reader may still be finishing a sample with the previous table
+    while (atomic_load(&s_lut_hazard) == next) {
+        vTaskDelay(1);
+    }
+
+    // Compose calibration -> shaping -> 16-bit scaling once per level
+    const clutch_calibration_t cal = s_calibration;
+    const axis_shaping_t *left = &s_shaping[DATA_AXIS_LEFT_CLUTCH];
+    const axis_shaping_t *right = &s_shaping[DATA_AXIS_RIGHT_CLUTCH];
+    for (uint32_t raw = 0; raw < ADC_LEVELS; raw++) {
+        uint16_t l = calibrate_level(raw, cal.left_min, cal.left_max, cal.calibrated);
+        uint16_t r = calibrate_level(raw, cal.right_min, cal.right_max, cal.calibrated);
+        next->left[raw] = SCALE_12_TO_16(shape_level(l, left));
+        next->right[raw] = SCALE_12_TO_16(shape_level(r, right));
+    }
+
+    atomic_store(&s_active_lut, next);
+
+    if (s_lut_mutex != NULL) {
+        xSemaphoreGive(s_lut_mutex);
+    }
+}
+
+/* Reader side: pin the active table for the duration of one sample */
+static inline const calib_lut_t *lut_acquire(void)
+{
+    calib_lut_t *lut = atomic_load(&s_active_lut);
+    atomic_store(&s_lut_hazard, lut);
+
+    // A swap between the load and the announcement: retry with the new table
+    calib_lut_t *now;
+    while ((now = atomic_load(&s_active_lut)) != lut) {
+        lut = now;
+        atomic_store(&s_lut_hazard, lut);
+    }
+    return lut;
+}
+
+static inline void lut_release(void)
+{
+    atomic_store_explicit(&s_lut_hazard, NULL, memory_order_release);
+}
+
+static void notify_calibration_task(void)
+{
+    TaskHandle_t task = s_calibration_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void calibration_timer_cb(void *arg)
+{
+    (void)arg;
+    atomic_store(&s_timed_calibration_done, true);
+    notify_calibration_task();
+}
+
+/* Q20 of 4095 is close to UINT32_MAX, so compare the span, not min + span */
+static inline bool envelope_spans(const envelope_t *e, uint32_t span_q20)
+{
+    return e->max_q20 >= e->min_q20 && e->max_q20 - e->min_q20 >= span_q20;
+}
+
+/* O(1) per sample: expand instantly, decay inwards slowly */
+static inline void envelope_update(envelope_t *e, uint16_t raw)
+{
+    uint32_t x = (uint32_t)raw << ENVELOPE_FRAC_BITS;
+    bool can_shrink = envelope_spans(e, ENVELOPE_MIN_SPAN_Q20 + 1);
+
+    if (x < e->min_q20) {
+        e->min_q20 = x;
+    } else if (can_shrink) {
+        e->min_q20 += (x - e->min_q20) >> CONFIG_CLUTCH_AUTOCAL_DECAY_SHIFT;
+    }
+
+    if (x > e->max_q20) {
+        e->max_q20 = x;
+    } else if (can_shrink) {
+        e->max_q20 -= (e->max_q20 - x) >> CONFIG_CLUTCH_AUTOCAL_DECAY_SHIFT;
+    }
+}
+
+/* True once the envelope spans enough travel and has moved away from the
+ * bounds in use by at least the hysteresis */
+static inline bool envelope_drifted(const envelope_t *e, uint16_t min, uint16_t max)
+{
+    if (!envelope_spans(e, ENVELOPE_MIN_SPAN_Q20)) {
+        return false;
+    }
+
+    int32_t lo = (int32_t)(e->min_q20 >> ENVELOPE_FRAC_BITS);
+    int32_t hi = (int32_t)(e->max_q20 >> ENVELOPE_FRAC_BITS);
+    return !s_calibration.calibrated ||
+           abs(lo - (int32_t)min) >= CONFIG_CLUTCH_AUTOCAL_HYSTERESIS ||
+           abs(hi - (int32_t)max) >= CONFIG_CLUTCH_AUTOCAL_HYSTERESIS;
+}
+
+/* Start the envelopes from the bounds in use, or empty if uncalibrated */
+static void seed_envelopes(void)
+{
+    const uint16_t mins[DATA_AXIS_COUNT] = { s_calibration.left_min, s_calibration.right_min };
+    const uint16_t maxs[DATA_AXIS_COUNT] = { s_calibration.left_max, s_calibration.right_max };
+
+    for (int i = 0; i < DATA_AXIS_COUNT; i++) {
+        if (s_calibration.calibrated) {
+            s_envelopes[i].min_q20 = (uint32_t)mins[i] << ENVELOPE_FRAC_BITS;
+            s_envelopes[i].max_q20 = (uint32_t)maxs[i] << ENVELOPE_FRAC_BITS;
+        } else {
+            s_envelopes[i].min_q20 = (uint32_t)4095 << ENVELOPE_FRAC_BITS;
+            s_envelopes[i].max_q20 = 0;
+        }
+    }
+}
+
+/* Publish the envelopes that span enough travel as the calibration */
+static void apply_envelopes(void)
+{
+    const envelope_t *left = &s_envelopes[DATA_AXIS_LEFT_CLUTCH];
+    const envelope_t *right = &s_envelopes[DATA_AXIS_RIGHT_CLUTCH];
+    clutch_calibration_t cal = s_calibration;
+
+    if (envelope_spans(left, ENVELOPE_MIN_SPAN_Q20)) {
+        cal.left_min = left->min_q20 >> ENVELOPE_FRAC_BITS;
+        cal.left_max = left->max_q20 >> ENVELOPE_FRAC_BITS;
+    }
+    if (envelope_spans(right, ENVELOPE_MIN_SPAN_Q20)) {
+        cal.right_min = right->min_q20 >> ENVELOPE_FRAC_BITS;
+        cal.right_max = right->max_q20 >> ENVELOPE_FRAC_BITS;
+    }
+    cal.calibrated = true;
+
+    s_calibration = cal;
+    rebuild_calibration_lut();
+    calib_store_request_save();
+
+    ESP_LOGD(TAG, "Auto-calibration: Left %d - %d, Right %d - %d",
+             cal.left_min, cal.left_max, cal.right_min, cal.right_max);
+}
+
+/* A captured range is usable if it spans enough travel; an axis that saw
+ * no samples has min 4095 and max 0 */
+static bool capture_spans(const char *axis, uint16_t min, uint16_t max)
+{
+    if (max >= min && max - min >= CALIBRATION_MIN_SPAN) {
+        return true;
+    }
+    ESP_LOGW(TAG, "  %s: captured %d - %d spans less than %d counts, range kept",
+             axis, min, max, CALIBRATION_MIN_SPAN);
+    return false;
+}
+
+/* Capture -> calibration at the end of a timed run; each axis keeps its
+ * previous range unless the run moved it far enough */
+static void finish_timed_calibration(const char *how)
+{
+    s_is_calibrating = false;
+    ESP_LOGI(TAG, "Calibration %s", how);
+
+    bool left_ok = capture_spans("Left", s_calib_left_min, s_calib_left_max);
+    bool right_ok = capture_spans("Right", s_calib_right_min, s_calib_right_max);
+    if (!left_ok && !right_ok) {
+        return;
+    }
+
+    if (left_ok) {
+        s_calibration.left_min = s_calib_left_min;
+        s_calibration.left_max = s_calib_left_max;
+    }
+    if (right_ok) {
+        s_calibration.right_min = s_calib_right_min;
+        s_calibration.right_max = s_calib_right_max;
+    }
+    s_calibration.calibrated = true;
+    rebuild_calibration_lut();
+    seed_envelopes();
+    calib_store_request_save();
+
+    ESP_LOGI(TAG, "  Left:  %d - %d", s_calibration.left_min, s_calibration.left_max);
+    ESP_LOGI(TAG, "  Right: %d - %d", s_calibration.right_min, s_calibration.right_max);
+}
+
+/**
+ * @brief Remove hook of the sender registry: release an unregistered
+ *        sender's left paddle and clear its per-slot state
+ *
+ * The sender's frames no longer reach process_clutch_sample(), so a paddle
+ * it held would otherwise stay pressed, and its right clutch would stay in
+ * the clutch engine's input. The slot can go to another sender
+ * next, which must not inherit the filter, predictor or link history.
+ * Runs in the unregistering task.
+ */
+static void release_sender(int sender)
+{
+    // Once the ingest task is past the frame it was handling, nothing else
+    // touches the slot's working state
+    ingest_sync();
+
+    axis_filter_reset(&s_right_filters[sender]);
+#if CONFIG_CLUTCH_AXIS_PREDICTOR
+    memset(&s_right_predictors[sender], 0, sizeof(s_right_predictors[sender]));
+#endif
+    link_quality_forget(sender);
+
+    sender_state_t *st = sender_registry_state(sender);
+    if (st->left_pressed) {
+        st->left_pressed = false;
+        atomic_fetch_sub(&s_left_pressed_senders, 1);
+    }
+
+    // A frame that read the inputs before the sender left writes the
+    // globals first, then this one settles them
+    ingest_sync();
+    g_left_clutch_pressed = (atomic_load(&s_left_pressed_senders) > 0);
+    g_right_clutch_value = sender_registry_max_right_clutch();
+}
+
 esp_err_t data_processor_init(void)
 {
     if (s_is_initialized) {
@@ -39,8 +449,30 @@ esp_err_t data_processor_init(void)
         return ESP_OK;
     }
 
-    s_total_packets = 0;
-    s_total_bytes = 0;
+    atomic_store(&s_left_pressed_senders, 0);
+    sender_registry_set_remove_hook(release_sender);
+
+    if (s_lut_mutex == NULL) {
+        s_lut_mutex = xSemaphoreCreateMutex();
+        if (s_lut_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create LUT mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    rebuild_calibration_lut();
+
+    if (s_calibration_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = calibration_timer_cb,
+            .name = "calibration",
+        };
+        esp_err_t ret = esp_timer_create(&timer_args, &s_calibration_timer);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create calibration timer: 0x%x", ret);
+            return ret;
+        }
+    }
+
     s_is_initialized = true;
 
     ESP_LOGI(TAG, "Data processor initialized successfully");
@@ -60,125 +492,390 @@ esp_err_t data_processor_deinit(void)
     return ESP_OK;
 }
 
-esp_err_t data_processor_process_espnow_data(const uint8_t *mac_addr, 
-                                             const uint8_t *data, 
-                                             int len)
+/**
+ * @brief Calibrate and normalize one clutch sample into the sender state
+ *
+ * Only the fields the sender is mapped to are captured for calibration
+ * and written to its state.
+ *
+ * @return true if a report axis changed
+ */
+static HOT_PATH_FN bool process_clutch_sample(int sender, sender_state_t *st, uint32_t fields,
+                                              uint16_t left_clutch_raw, uint16_t right_clutch_raw)
 {
-    if (!s_is_initialized) {
-        ESP_LOGE(TAG, "Data processor not initialized");
-        return ESP_ERR_INVALID_STATE;
+    bool changed = false;
+
+    // Clamp to 12-bit range (0-4095)
+    left_clutch_raw = left_clutch_raw > 4095 ? 4095 : left_clutch_raw;
+    right_clutch_raw = right_clutch_raw > 4095 ? 4095 : right_clutch_raw;
+    
+    // Debug: raw values, throttled by the processor tag's rate limit
+    DLOGD(DLOG_TAG_PROCESSOR, "Raw values - Left: %d, Right: %d",
+          left_clutch_raw, right_clutch_raw);
+
+    // If calibrating, update min/max values; the run is ended by
+    // s_calibration_timer, not by packet arrival
+    if (s_is_calibrating) {
+        if (fields & SENDER_FIELD_LEFT_CLUTCH) {
+            if (left_clutch_raw < s_calib_left_min) s_calib_left_min = left_clutch_raw;
+            if (left_clutch_raw > s_calib_left_max) s_calib_left_max = left_clutch_raw;
+        }
+        if (fields & SENDER_FIELD_RIGHT_CLUTCH) {
+            if (right_clutch_raw < s_calib_right_min) s_calib_right_min = right_clutch_raw;
+            if (right_clutch_raw > s_calib_right_max) s_calib_right_max = right_clutch_raw;
+        }
+    } else if (s_auto_calibration) {
+        envelope_t *left = &s_envelopes[DATA_AXIS_LEFT_CLUTCH];
+        envelope_t *right = &s_envelopes[DATA_AXIS_RIGHT_CLUTCH];
+        if (fields & SENDER_FIELD_LEFT_CLUTCH) envelope_update(left, left_clutch_raw);
+        if (fields & SENDER_FIELD_RIGHT_CLUTCH) envelope_update(right, right_clutch_raw);
+
+        bool drifted =
+            envelope_drifted(left, s_calibration.left_min, s_calibration.left_max) ||
+            envelope_drifted(right, s_calibration.right_min, s_calibration.right_max);
+        if (drifted && !atomic_exchange(&s_autocal_pending, true)) {
+            notify_calibration_task();
+        }
     }
+    
+    // Calibrate, shape and scale to 16-bit through the lookup tables
+    const calib_lut_t *lut = lut_acquire();
+    uint16_t left_scaled = lut->left[left_clutch_raw];
+    uint16_t right_scaled = lut->right[right_clutch_raw];
+    lut_release();
 
-    if (mac_addr == NULL || data == NULL || len <= 0) {
-        ESP_LOGE(TAG, "Invalid parameters");
-        return ESP_ERR_INVALID_ARG;
+    // Left paddle with hysteresis: press threshold while released, release
+    // threshold while pressed, compared in the 16-bit domain (the scaling
+    // is strictly increasing). A sender remapped away from the left paddle
+    // releases it. Pressed senders are counted so the global (set in
+    // publish_sender) never needs a registry scan.
+    uint32_t thresholds = atomic_load_explicit(&s_left_thresholds, memory_order_relaxed);
+    uint16_t threshold = (uint16_t)(thresholds >> (st->left_pressed ? 16 : 0));
+    bool pressed = (fields & SENDER_FIELD_LEFT_CLUTCH) && (left_scaled > threshold);
+    if (pressed != st->left_pressed) {
+        st->left_pressed = pressed;
+        if (pressed) {
+            atomic_fetch_add_explicit(&s_left_pressed_senders, 1, memory_order_relaxed);
+        } else {
+            atomic_fetch_sub_explicit(&s_left_pressed_senders, 1, memory_order_relaxed);
+        }
     }
 
-    // Update statistics
-    s_total_packets++;
-    s_total_bytes += len;
+    if (fields & SENDER_FIELD_RIGHT_CLUTCH) {
+        // Smooth ADC noise at rest; the left paddle is left unfiltered so
+        // its threshold reacts without added delay
+        if (s_filter_enabled) {
+            axis_filter_t *filter = &s_right_filters[sender];
+            right_scaled = axis_filter_update(filter, &s_filter_params,
+                                              right_scaled, st->rx_time_us);
+            latency_stats_record(LATENCY_STAGE_FILTER_DELAY, filter->delay_us);
+        }
 
-    // Expected format from ESP-NOW sender (ESP32-C3 client):
-    // Bytes 0-1: left_clutch (uint16_t, little-endian, 12-bit ADC value 0-4095)
-    // Bytes 2-3: right_clutch (uint16_t, little-endian, 12-bit ADC value 0-4095)
-    
-    if (len < 4) {
-        ESP_LOGW(TAG, "Packet too small: %d bytes (expected 4)", len);
+#if CONFIG_CLUTCH_AXIS_PREDICTOR
+        st->right_motion = axis_predictor_push(&s_right_predictors[sender], right_scaled,
+                                               st->rx_time_us,
+                                               CONFIG_CLUTCH_PREDICT_TIMEOUT_MS * 1000);
+#endif
+
+        if (right_scaled != st->right_clutch) {
+            st->right_clutch = right_scaled;
+            changed = true;
+        }
+    }
+
+    s_trace.left_raw = left_clutch_raw;
+    s_trace.right_raw = right_clutch_raw;
+    s_trace.left_out = left_scaled;
+    s_trace.right_out = right_scaled;
+    if (st->left_pressed) s_trace.flags |= TELEMETRY_SAMPLE_LEFT_PRESSED;
+
+    DLOGV(DLOG_TAG_PROCESSOR, "Sender %d - Left: %d, Right: %d",
+          sender, left_scaled, right_scaled);
+    return changed;
+}
+
+
+HOT_PATH_FN esp_err_t data_processor_parse_simracing_data(const uint8_t *raw_data,
+                                                           int len,
+                                                           const espnow_simracing_data_t **parsed_data)
+{
+    if (raw_data == NULL || parsed_data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (len < (int)sizeof(espnow_simracing_data_t)) {
         return ESP_ERR_INVALID_SIZE;
     }
 
-    // Parse data (little-endian)
-    uint16_t left_clutch_raw = (data[1] << 8) | data[0];
-    uint16_t right_clutch_raw = (data[3] << 8) | data[2];
-    
-    // Clamp to 12-bit range (0-4095)
-    left_clutch_raw = left_clutch_raw > 4095 ? 4095 : left_clutch_raw;
-    right_clutch_raw = right_clutch_raw > 4095 ? 4095 : right_clutch_raw;
-    
-    // Debug: Log raw values periodically
-    static uint32_t log_counter = 0;
-    if (log_counter++ % 100 == 0) {
-        ESP_LOGI(TAG, "Raw values - Left: %d, Right: %d", left_clutch_raw, right_clutch_raw);
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < offsetof(espnow_simracing_data_t, checksum); i++) {
+        checksum ^= raw_data[i];
     }
 
-    // If calibrating, update min/max values
-    if (s_is_calibrating) {
-        if (left_clutch_raw < s_calib_left_min) s_calib_left_min = left_clutch_raw;
-        if (left_clutch_raw > s_calib_left_max) s_calib_left_max = left_clutch_raw;
-        if (right_clutch_raw < s_calib_right_min) s_calib_right_min = right_clutch_raw;
-        if (right_clutch_raw > s_calib_right_max) s_calib_right_max = right_clutch_raw;
-        
-        // Check if calibration period has ended
-        int64_t now = esp_timer_get_time() / 1000; // Convert to ms
-        if ((now - s_calibration_start_time) >= s_calibration_duration_ms) {
-            // Save calibration values
-            s_calibration.left_min = s_calib_left_min;
-            s_calibration.left_max = s_calib_left_max;
-            s_calibration.right_min = s_calib_right_min;
-            s_calibration.right_max = s_calib_right_max;
-            s_calibration.calibrated = true;
-            s_is_calibrating = false;
-            
-            ESP_LOGI(TAG, "Calibration complete:");
-            ESP_LOGI(TAG, "  Left:  %d - %d", s_calibration.left_min, s_calibration.left_max);
-            ESP_LOGI(TAG, "  Right: %d - %d", s_calibration.right_min, s_calibration.right_max);
+    const espnow_simracing_data_t *frame = (const espnow_simracing_data_t *)raw_data;
+    if (checksum != frame->checksum) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *parsed_data = frame;
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply the auxiliary axes and buttons of a sim racing frame
+ *
+ * @return true if a report field changed
+ */
+static HOT_PATH_FN bool process_simracing_extras(sender_state_t *st, uint32_t fields,
+                                                 const espnow_simracing_data_t *frame)
+{
+    const uint16_t aux_raw[USB_HID_AUX_AXIS_COUNT] = {
+        frame->axis_x, frame->axis_y, frame->axis_z, frame->axis_rx,
+    };
+    bool changed = false;
+
+    for (int i = 0; i < USB_HID_AUX_AXIS_COUNT; i++) {
+        if (!(fields & SENDER_FIELD_AUX(i))) continue;
+        uint16_t raw = aux_raw[i] > 4095 ? 4095 : aux_raw[i];
+        uint16_t scaled = SCALE_12_TO_16(raw);
+        if (scaled != st->aux[i]) {
+            st->aux[i] = scaled;
+            changed = true;
         }
     }
-    
-    // Normalize values if calibrated
-    uint16_t left_clutch = left_clutch_raw;
-    uint16_t right_clutch = right_clutch_raw;
-    
-    if (s_calibration.calibrated) {
-        // Normalize left clutch: map [min, max] -> [0, 4095]
-        if (left_clutch_raw <= s_calibration.left_min) {
-            left_clutch = 0;
-        } else if (left_clutch_raw >= s_calibration.left_max) {
-            left_clutch = 4095;
-        } else {
-            uint32_t range = s_calibration.left_max - s_calibration.left_min;
-            if (range > 0) {
-                left_clutch = ((uint32_t)(left_clutch_raw - s_calibration.left_min) * 4095) / range;
+
+    if ((fields & SENDER_FIELD_BUTTONS) && frame->buttons != st->buttons) {
+        st->buttons = frame->buttons;
+        changed = true;
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Publish the sender's state snapshot, then the clutch engine's
+ *        inputs, then wake the HID reporter
+ *
+ * Always published: rx_time_us moves with every accepted packet. The
+ * clutch engine's globals are plain stores, so the virtual clutch it
+ * derives from them is not ordered against the snapshot.
+ * The sample is traced on the telemetry stream once it is visible.
+ */
+static HOT_PATH_FN void publish_sender(int sender, bool changed)
+{
+    sender_registry_publish(sender);
+    g_left_clutch_pressed = (atomic_load_explicit(&s_left_pressed_senders,
+                                                  memory_order_relaxed) > 0);
+    if (sender_registry_field_mask(sender) & SENDER_FIELD_RIGHT_CLUTCH) {
+        g_right_clutch_value = sender_registry_max_right_clutch();
+    }
+    if (changed) {
+        int64_t rx_time_us = sender_registry_state(sender)->rx_time_us;
+        power_note_activity();
+        usb_comm_notify_report();
+        rate_control_note_change(sender, rx_time_us);
+    }
+
+    if (telemetry_is_active()) {
+        int64_t proc_us = esp_timer_get_time() - sender_registry_state(sender)->rx_time_us;
+        s_trace.proc_us = proc_us > UINT16_MAX ? UINT16_MAX : (uint16_t)proc_us;
+        if (changed) s_trace.flags |= TELEMETRY_SAMPLE_CHANGED;
+        telemetry_emit(TELEMETRY_FRAME_SAMPLE, &s_trace, sizeof(s_trace));
+    }
+}
+
+/**
+ * @brief Parse a frame in the versioned wire format (see espnow_wire.h)
+ */
+static HOT_PATH_FN esp_err_t process_wire_frame(int sender, const uint8_t *mac_addr,
+                                                const uint8_t *data, int len,
+                                                int8_t rssi, int64_t rx_time_us)
+{
+    const espnow_wire_header_t *hdr = (const espnow_wire_header_t *)data;
+
+    if (hdr->version != ESPNOW_WIRE_VERSION) {
+        DLOGW(DLOG_TAG_PROCESSOR, "Unsupported wire version %d", hdr->version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    const uint8_t *payload = data + sizeof(espnow_wire_header_t);
+    int payload_len = len - (int)sizeof(espnow_wire_header_t);
+
+    // Validate before the sequence number is committed: a short or corrupt
+    // frame with a high seq would make the good frames after it look stale
+    const espnow_simracing_data_t *frame = NULL;
+    switch (hdr->type) {
+        case ESPNOW_WIRE_TYPE_PONG:
+            if (payload_len < (int)sizeof(espnow_wire_ping_t)) {
+                return ESP_ERR_INVALID_SIZE;
             }
-        }
-        
-        // Normalize right clutch: map [min, max] -> [0, 4095]
-        if (right_clutch_raw <= s_calibration.right_min) {
-            right_clutch = 0;
-        } else if (right_clutch_raw >= s_calibration.right_max) {
-            right_clutch = 4095;
-        } else {
-            uint32_t range = s_calibration.right_max - s_calibration.right_min;
-            if (range > 0) {
-                right_clutch = ((uint32_t)(right_clutch_raw - s_calibration.right_min) * 4095) / range;
+            break;
+        case ESPNOW_WIRE_TYPE_CLUTCH:
+            if (payload_len < (int)sizeof(espnow_wire_clutch_t)) {
+                DLOGW(DLOG_TAG_PROCESSOR, "Clutch payload too small: %d bytes", payload_len);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            break;
+        case ESPNOW_WIRE_TYPE_SIMRACING: {
+            esp_err_t ret = data_processor_parse_simracing_data(payload, payload_len, &frame);
+            if (ret != ESP_OK) {
+                DLOGW(DLOG_TAG_PROCESSOR, "Bad sim racing frame (0x%x, %d bytes)",
+                      ret, payload_len);
+                return ret;
             }
+            break;
         }
+        default:
+            DLOGW(DLOG_TAG_PROCESSOR, "Unknown wire type 0x%02x", hdr->type);
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Duplicates and late retries are dropped here, before any output
+    link_seq_verdict_t verdict = link_quality_update_seq(sender, mac_addr, rssi, rx_time_us,
+                                                         hdr->seq, hdr->tx_delta_us);
+    if (verdict != LINK_SEQ_ACCEPT) {
+        metrics_add(METRIC_RX_DISCARDED, 1);
+        return ESP_OK;
+    }
+
+    s_trace.seq = hdr->seq;
+    s_trace.flags |= TELEMETRY_SAMPLE_SEQUENCED;
+
+    // Echo of our RTT probe; carries no outputs
+    if (hdr->type == ESPNOW_WIRE_TYPE_PONG) {
+        espnow_wire_ping_t pong;
+        memcpy(&pong, payload, sizeof(pong));
+        latency_stats_record(LATENCY_STAGE_PING_RTT, (uint32_t)rx_time_us - pong.t_us);
+        return ESP_OK;
+    }
+
+    sender_state_t *st = sender_registry_state(sender);
+    uint32_t fields = sender_registry_field_mask(sender);
+    st->rx_time_us = rx_time_us;
+
+    if (hdr->type == ESPNOW_WIRE_TYPE_CLUTCH) {
+        const espnow_wire_clutch_t *clutch = (const espnow_wire_clutch_t *)payload;
+        publish_sender(sender, process_clutch_sample(sender, st, fields,
+                                                     clutch->left_clutch,
+                                                     clutch->right_clutch));
+        return ESP_OK;
+    }
+
+    bool changed = process_clutch_sample(sender, st, fields,
+                                         frame->left_clutch, frame->right_clutch);
+    changed |= process_simracing_extras(st, fields, frame);
+    publish_sender(sender, changed);
+    return ESP_OK;
+}
+
+HOT_PATH_FN esp_err_t data_processor_process_espnow_data(const uint8_t *mac_addr, 
+                                                         const uint8_t *data, 
+                                                         int len,
+                                                         int8_t rssi,
+                                                         int64_t rx_time_us)
+{
+    // Runs once per packet: log only through the deferred logger
+    if (!s_is_initialized) {
+        DLOGE(DLOG_TAG_PROCESSOR, "Data processor not initialized");
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Threshold same as before: left paddle pressed when > 2800 / 4095
-    #define BUTTON_THRESHOLD 2800
-    g_left_clutch_pressed = (left_clutch > BUTTON_THRESHOLD);
+    if (mac_addr == NULL || data == NULL || len <= 0) {
+        DLOGE(DLOG_TAG_PROCESSOR, "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    // Scale right clutch from 12-bit (0-4095) to 16-bit (0-65535)
-    g_right_clutch_value = (uint16_t)(((uint32_t)right_clutch * 65535u) / 4095u);
+    // Update statistics
+    metrics_add(METRIC_RX_PACKETS, 1);
+    metrics_add(METRIC_RX_BYTES, (uint64_t)len);
+
+    portENTER_CRITICAL(&s_info_lock);
+    memcpy(s_last_packet_info.sender_mac, mac_addr, sizeof(s_last_packet_info.sender_mac));
+    s_last_packet_info.timestamp = (uint32_t)(rx_time_us / 1000);
+    s_last_packet_info.rssi = rssi;
+    s_have_last_packet = true;
+    portEXIT_CRITICAL(&s_info_lock);
 
-    ESP_LOGD(TAG, "Packet #%lu - Left: %d, Right: %d",
-             s_total_packets, left_clutch, right_clutch);
+    // O(1) sender lookup; unknown senders are added if auto-registration is on
+    int sender = sender_registry_acquire(mac_addr);
+    if (sender < 0) {
+        metrics_add(METRIC_RX_REJECTED, 1);
+        DLOGW(DLOG_TAG_PROCESSOR, "Packet from unregistered sender ..:%02x:%02x dropped",
+              mac_addr[4], mac_addr[5]);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_trace = (telemetry_sample_t){
+        .rx_time_us = (uint32_t)rx_time_us,
+        .sender = (uint8_t)sender,
+        .rssi = rssi,
+    };
+
+    // Versioned frame: 8-byte header + typed payload (espnow_wire.h)
+    if (len >= (int)sizeof(espnow_wire_header_t) && data[0] == ESPNOW_WIRE_MAGIC) {
+        return process_wire_frame(sender, mac_addr, data, len, rssi, rx_time_us);
+    }
+
+    // Legacy format from ESP-NOW sender (ESP32-C3 client), no header:
+    // Bytes 0-1: left_clutch (uint16_t, little-endian, 12-bit ADC value 0-4095)
+    // Bytes 2-3: right_clutch (uint16_t, little-endian, 12-bit ADC value 0-4095)
+    if (len < ESPNOW_WIRE_LEGACY_CLUTCH_LEN) {
+        DLOGW(DLOG_TAG_PROCESSOR, "Packet too small: %d bytes (expected 4)", len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    link_quality_update(sender, mac_addr, rssi, rx_time_us);
+
+    // Parse data (little-endian)
+    uint16_t left_clutch_raw = (data[1] << 8) | data[0];
+    uint16_t right_clutch_raw = (data[3] << 8) | data[2];
+    sender_state_t *st = sender_registry_state(sender);
+    st->rx_time_us = rx_time_us;
+    publish_sender(sender, process_clutch_sample(sender, st, sender_registry_field_mask(sender),
+                                                 left_clutch_raw, right_clutch_raw));
 
     return ESP_OK;
 }
 
-void data_processor_get_stats(uint32_t *total_packets, uint32_t *total_bytes)
+void data_processor_get_stats(uint64_t *total_packets, uint64_t *total_bytes)
 {
     if (total_packets != NULL) {
-        *total_packets = s_total_packets;
+        *total_packets = metrics_get(METRIC_RX_PACKETS);
     }
     
     if (total_bytes != NULL) {
-        *total_bytes = s_total_bytes;
+        *total_bytes = metrics_get(METRIC_RX_BYTES);
     }
 }
 
+uint32_t data_processor_get_discarded_count(void)
+{
+    return (uint32_t)metrics_get(METRIC_RX_DISCARDED);
+}
+
+uint32_t data_processor_get_rejected_count(void)
+{
+    return (uint32_t)metrics_get(METRIC_RX_REJECTED);
+}
+
+esp_err_t data_processor_get_last_packet_info(data_packet_info_t *info)
+{
+    if (info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&s_info_lock);
+    if (s_have_last_packet) {
+        memcpy(info, &s_last_packet_info, sizeof(data_packet_info_t));
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_info_lock);
+
+    return ret;
+}
+
 esp_err_t data_processor_start_calibration(uint32_t duration_ms)
 {
     if (!s_is_initialized) {
@@ -196,9 +893,15 @@ esp_err_t data_processor_start_calibration(uint32_t duration_ms)
     s_calib_right_min = 4095;
     s_calib_right_max = 0;
     
-    s_calibration_duration_ms = duration_ms;
-    s_calibration_start_time = esp_timer_get_time() / 1000; // Convert to ms
+    // A timer that fired during the previous stop must not end this run
+    atomic_store(&s_timed_calibration_done, false);
     s_is_calibrating = true;
+    esp_err_t ret = esp_timer_start_once(s_calibration_timer, (uint64_t)duration_ms * 1000);
+    if (ret != ESP_OK) {
+        s_is_calibrating = false;
+        ESP_LOGE(TAG, "Failed to start calibration timer: 0x%x", ret);
+        return ret;
+    }
     
     ESP_LOGI(TAG, "Starting calibration for %lu ms - move clutches through full range", duration_ms);
     return ESP_OK;
@@ -211,16 +914,9 @@ esp_err_t data_processor_stop_calibration(void)
     }
     
     // Save current captured values
-    s_calibration.left_min = s_calib_left_min;
-    s_calibration.left_max = s_calib_left_max;
-    s_calibration.right_min = s_calib_right_min;
-    s_calibration.right_max = s_calib_right_max;
-    s_calibration.calibrated = true;
-    s_is_calibrating = false;
-    
-    ESP_LOGI(TAG, "Calibration stopped manually");
-    ESP_LOGI(TAG, "  Left:  %d - %d", s_calibration.left_min, s_calibration.left_max);
-    ESP_LOGI(TAG, "  Right: %d - %d", s_calibration.right_min, s_calibration.right_max);
+    esp_timer_stop(s_calibration_timer);
+    atomic_store(&s_timed_calibration_done, false);
+    finish_timed_calibration("stopped manually");
     
     return ESP_OK;
 }
@@ -247,6 +943,9 @@ esp_err_t data_processor_set_calibration(const clutch_calibration_t *calib)
     }
     
     memcpy(&s_calibration, calib, sizeof(clutch_calibration_t));
+    rebuild_calibration_lut();
+    seed_envelopes();
+    calib_store_request_save();
     ESP_LOGI(TAG, "Calibration set manually:");
     ESP_LOGI(TAG, "  Left:  %d - %d", s_calibration.left_min, s_calibration.left_max);
     ESP_LOGI(TAG, "  Right: %d - %d", s_calibration.right_min, s_calibration.right_max);
@@ -262,7 +961,412 @@ esp_err_t data_processor_reset_calibration(void)
     s_calibration.right_max = 4095;
     s_calibration.calibrated = false;
     s_is_calibrating = false;
+    if (s_calibration_timer != NULL) {
+        esp_timer_stop(s_calibration_timer);
+    }
+    rebuild_calibration_lut();
+    seed_envelopes();
+    calib_store_request_save();
     
     ESP_LOGI(TAG, "Calibration reset to defaults (no normalization)");
     return ESP_OK;
 }
+
+esp_err_t data_processor_set_axis_shaping(data_axis_t axis, const axis_shaping_t *shaping)
+{
+    if (axis >= DATA_AXIS_COUNT || shaping == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((uint32_t)shaping->deadzone + shaping->saturation >= 4095) {
+        ESP_LOGE(TAG, "Deadzone %u + saturation %u leave no travel",
+                 shaping->deadzone, shaping->saturation);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (shaping->curve == AXIS_CURVE_GAMMA && shaping->gamma_x100 == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    axis_shaping_t sh = *shaping;
+    for (int i = 0; i < AXIS_CURVE_POINTS; i++) {
+        if (sh.points[i] > 4095) sh.points[i] = 4095;
+    }
+
+    s_shaping[axis] = sh;
+    rebuild_calibration_lut();
+    calib_store_request_save();
+
+    ESP_LOGI(TAG, "Axis %d shaping: deadzone %u, saturation %u, curve %d",
+             axis, sh.deadzone, sh.saturation, sh.curve);
+    return ESP_OK;
+}
+
+esp_err_t data_processor_get_axis_shaping(data_axis_t axis, axis_shaping_t *shaping)
+{
+    if (axis >= DATA_AXIS_COUNT || shaping == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *shaping = s_shaping[axis];
+    return ESP_OK;
+}
+
+esp_err_t data_processor_set_left_threshold(uint16_t press, uint16_t release)
+{
+    if (press > 4095 || release > press) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_left_press = press;
+    s_left_release = release;
+    atomic_store(&s_left_thresholds, PACK_THRESHOLDS(press, release));
+    calib_store_request_save();
+    ESP_LOGI(TAG, "Left paddle threshold: press > %u, release <= %u", press, release);
+    return ESP_OK;
+}
+
+void data_processor_get_left_threshold(uint16_t *press, uint16_t *release)
+{
+    if (press != NULL) {
+        *press = s_left_press;
+    }
+    if (release != NULL) {
+        *release = s_left_release;
+    }
+}
+
+esp_err_t data_processor_set_auto_calibration(bool enabled)
+{
+    if (enabled && !s_auto_calibration) {
+        seed_envelopes();
+    }
+    s_auto_calibration = enabled;
+    calib_store_request_save();
+
+    ESP_LOGI(TAG, "Background auto-calibration %s", enabled ? "on" : "off");
+    return ESP_OK;
+}
+
+bool data_processor_get_auto_calibration(void)
+{
+    return s_auto_calibration;
+}
+
+void task_calibration(void *arg)
+{
+    (void)arg;
+
+    s_calibration_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (atomic_exchange(&s_timed_calibration_done, false) && s_is_calibrating) {
+            finish_timed_calibration("complete");
+        }
+
+        if (atomic_load(&s_autocal_pending)) {
+            // Clear first so drift seen while rebuilding triggers again
+            atomic_store(&s_autocal_pending, false);
+            if (s_auto_calibration && !s_is_calibrating) {
+                apply_envelopes();
+            }
+            vTaskDelay(pdMS_TO_TICKS(AUTOCAL_REBUILD_GAP_MS));
+        }
+    }
+}
+
+esp_err_t data_processor_set_filter(bool enabled, const axis_filter_params_t *params)
+{
+    if (params != NULL) {
+        s_filter_params = *params;
+    }
+    s_filter_enabled = enabled;
+    calib_store_request_save();
+
+    ESP_LOGI(TAG, "Right clutch filter %s (min cutoff %u.%02u Hz, beta %u, d cutoff %u.%02u Hz)",
+             enabled ? "on" : "off",
+             s_filter_params.min_cutoff_chz / 100, s_filter_params.min_cutoff_chz % 100,
+             s_filter_params.beta,
+             s_filter_params.d_cutoff_chz / 100, s_filter_params.d_cutoff_chz % 100);
+    return ESP_OK;
+}
+
+bool data_processor_get_filter(axis_filter_params_t *params)
+{
+    if (params != NULL) {
+        *params = s_filter_params;
+    }
+    return s_filter_enabled;
+}
+
+#if CONFIG_CLUTCH_BENCHMARKS
+
+#define BENCH_ITERATIONS (ADC_LEVELS * 8)
+#define BENCH_STREAM_PACKETS        2000
+#define BENCH_PACKET_INTERVAL_US    1000
+#define BENCH_OVERSHOOT             60      // ADC counts past the bounds
+
+/* Locally administered MAC of the synthetic sender */
+static const uint8_t s_bench_mac[6] = { 0x02, 0xBE, 0x4C, 0x00, 0x00, 0x01 };
+
+/* Pre-LUT per-packet path (no shaping): normalize with two divisions, then scale */
+static uint16_t normalize_per_packet(uint16_t raw, uint16_t min, uint16_t max)
+{
+    uint16_t value;
+    if (raw <= min) {
+        value = 0;
+    } else if (raw >= max) {
+        value = 4095;
+    } else {
+        value = ((uint32_t)(raw - min) * 4095) / (uint32_t)(max - min);
+    }
+    return (uint16_t)(((uint32_t)value * 65535u) / 4095u);
+}
+
+static uint32_t cycles_to_ns(uint32_t cycles)
+{
+    return cycles * 1000u / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+}
+
+/* Division path against the lookup tables; returns the mismatching levels */
+static uint32_t bench_calibration_lut(const clutch_calibration_t *cal)
+{
+    volatile uint32_t sink = 0;
+    uint32_t mismatches = 0;
+
+    // Same pseudo-random sample sequence for both paths
+    uint32_t x = 12345;
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        x = x * 1103515245u + 12345u;
+        uint16_t raw = (x >> 16) & 0x0FFF;
+        sink += normalize_per_packet(raw, cal->left_min, cal->left_max);
+        sink += normalize_per_packet(raw ^ 0x0A5A, cal->right_min, cal->right_max);
+    }
+    uint32_t div_cycles = esp_cpu_get_cycle_count() - start;
+
+    x = 12345;
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        x = x * 1103515245u + 12345u;
+        uint16_t raw = (x >> 16) & 0x0FFF;
+        const calib_lut_t *lut = lut_acquire();
+        sink += lut->left[raw];
+        sink += lut->right[raw ^ 0x0A5A];
+        lut_release();
+    }
+    uint32_t lut_cycles = esp_cpu_get_cycle_count() - start;
+
+    const calib_lut_t *lut = atomic_load(&s_active_lut);
+    for (uint32_t raw = 0; raw < ADC_LEVELS; raw++) {
+        if (lut->left[raw] != normalize_per_packet(raw, cal->left_min, cal->left_max) ||
+            lut->right[raw] != normalize_per_packet(raw, cal->right_min, cal->right_max)) {
+            mismatches++;
+        }
+    }
+    (void)sink;
+
+    ESP_LOGI(TAG, "Benchmark calibration (2 axes per packet, %d packets):", BENCH_ITERATIONS);
+    ESP_LOGI(TAG, "  division path: %lu cycles/packet", div_cycles / BENCH_ITERATIONS);
+    ESP_LOGI(TAG, "  lookup table : %lu cycles/packet", lut_cycles / BENCH_ITERATIONS);
+    ESP_LOGI(TAG, "  mismatches   : %lu of %d levels", mismatches, ADC_LEVELS);
+    return mismatches;
+}
+
+/* Synthetic paddle stream: slow press/release triangle over the whole
+ * range plus ADC noise, 1 ms apart, ending released */
+static uint16_t bench_sample(int i, uint16_t lo, uint16_t hi, uint32_t *noise)
+{
+    int period = BENCH_STREAM_PACKETS / 4;
+    int phase = i % period;
+    int32_t ramp = phase < period / 2 ? phase : period - phase;
+    int32_t span = (int32_t)hi - lo + 2 * BENCH_OVERSHOOT;
+
+    *noise = *noise * 1103515245u + 12345u;
+    int32_t raw = lo - BENCH_OVERSHOOT + span * ramp / (period / 2) +
+                  (int32_t)((*noise >> 16) & 15) - 8;
+    if (i >= BENCH_STREAM_PACKETS - 8) raw = 0;
+    if (raw < 0) raw = 0;
+    if (raw > 4095) raw = 4095;
+    return (uint16_t)raw;
+}
+
+static void bench_feed(uint16_t seq, uint16_t left, uint16_t right, int64_t t_us)
+{
+    struct __attribute__((packed)) {
+        espnow_wire_header_t hdr;
+        espnow_wire_clutch_t body;
+    } frame = {
+        .hdr = {
+            .magic = ESPNOW_WIRE_MAGIC,
+            .version = ESPNOW_WIRE_VERSION,
+            .type = ESPNOW_WIRE_TYPE_CLUTCH,
+            .seq = seq,
+            .tx_delta_us = BENCH_PACKET_INTERVAL_US,
+        },
+        .body = { .left_clutch = left, .right_clutch = right },
+    };
+    data_processor_process_espnow_data(s_bench_mac, (const uint8_t *)&frame, sizeof(frame),
+                                       -40, t_us);
+}
+
+/* Whole packet path (parse, link tracking, calibration, threshold,
+ * publish) through data_processor_process_espnow_data, then the same
+ * stream again checking the outputs against the reference path.
+ * Returns the packets with a wrong output. */
+static uint32_t bench_packet_path(const clutch_calibration_t *cal)
+{
+    if (sender_registry_register(s_bench_mac,
+                                 SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH) != ESP_OK) {
+        ESP_LOGW(TAG, "Benchmark packet path skipped: sender table full");
+        return 0;
+    }
+    int slot = sender_registry_lookup(s_bench_mac);
+    const sender_state_t *st = sender_registry_state(slot);
+
+    const uint64_t saved_packets = metrics_get(METRIC_RX_PACKETS);
+    const uint64_t saved_bytes = metrics_get(METRIC_RX_BYTES);
+    uint32_t noise = 777;
+    uint16_t seq = 0;
+    int64_t t_us = esp_timer_get_time();
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_STREAM_PACKETS; i++) {
+        uint16_t left = bench_sample(i, cal->left_min, cal->left_max, &noise);
+        uint16_t right = bench_sample(i, cal->right_min, cal->right_max, &noise);
+        bench_feed(seq++, left, right, t_us += BENCH_PACKET_INTERVAL_US);
+    }
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    uint32_t thresholds = atomic_load(&s_left_thresholds);
+    uint16_t press = (uint16_t)thresholds;
+    uint16_t release = (uint16_t)(thresholds >> 16);
+    uint32_t wrong = 0;
+    uint32_t presses = 0;
+    bool pressed = false;
+    noise = 777;
+
+    for (int i = 0; i < BENCH_STREAM_PACKETS; i++) {
+        uint16_t left = bench_sample(i, cal->left_min, cal->left_max, &noise);
+        uint16_t right = bench_sample(i, cal->right_min, cal->right_max, &noise);
+        bench_feed(seq++, left, right, t_us += BENCH_PACKET_INTERVAL_US);
+
+        uint16_t left_scaled = normalize_per_packet(left, cal->left_min, cal->left_max);
+        bool now_pressed = left_scaled > (pressed ? release : press);
+        presses += (now_pressed && !pressed) ? 1 : 0;
+        pressed = now_pressed;
+
+        if (st->right_clutch != normalize_per_packet(right, cal->right_min, cal->right_max) ||
+            st->left_pressed != pressed) {
+            wrong++;
+        }
+    }
+
+    // Leave no bench sender behind and the counters untouched: unregister
+    // frees the registry slot, and its remove hook (release_sender) the
+    // link entry, filter and predictor
+    sender_registry_unregister(s_bench_mac);
+    metrics_set(METRIC_RX_PACKETS, saved_packets);
+    metrics_set(METRIC_RX_BYTES, saved_bytes);
+    g_right_clutch_value = 0;
+
+    ESP_LOGI(TAG, "Benchmark packet path (%d packets):", BENCH_STREAM_PACKETS);
+    ESP_LOGI(TAG, "  process_espnow_data: %lu cycles/packet (%lu ns)",
+             cycles / BENCH_STREAM_PACKETS, cycles_to_ns(cycles / BENCH_STREAM_PACKETS));
+    ESP_LOGI(TAG, "  wrong outputs      : %lu (left presses %lu)", wrong, presses);
+    return wrong;
+}
+
+/* Lookup table rebuild per curve, filter and predictor per sample */
+static void bench_pipeline(void)
+{
+    static const axis_shaping_t curves[] = {
+        AXIS_SHAPING_IDENTITY,
+        { .curve = AXIS_CURVE_GAMMA, .gamma_x100 = 220 },
+        { .curve = AXIS_CURVE_PIECEWISE, .gamma_x100 = 100,
+          .points = { 0, 200, 600, 1300, 2048, 2800, 3500, 3900, 4095 } },
+    };
+    static const char *const names[] = { "linear", "gamma", "piecewise" };
+
+    ESP_LOGI(TAG, "Benchmark pipeline:");
+    for (size_t c = 0; c < sizeof(curves) / sizeof(curves[0]); c++) {
+        for (int i = 0; i < DATA_AXIS_COUNT; i++) {
+            s_shaping[i] = curves[c];
+        }
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        rebuild_calibration_lut();
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        ESP_LOGI(TAG, "  LUT rebuild %-9s: %lu us", names[c],
+                 cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    }
+
+    volatile uint32_t sink = 0;
+    uint32_t noise = 4242;
+    axis_filter_t filter;
+    axis_filter_reset(&filter);
+    int64_t t_us = 0;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint16_t x = (uint16_t)(bench_sample(i, 0, 4095, &noise) << 4);
+        sink += axis_filter_update(&filter, &s_filter_params, x, t_us += BENCH_PACKET_INTERVAL_US);
+    }
+    uint32_t filter_cycles = esp_cpu_get_cycle_count() - start;
+
+    axis_predictor_t predictor;
+    memset(&predictor, 0, sizeof(predictor));
+    t_us = 0;
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint16_t x = (uint16_t)(bench_sample(i, 0, 4095, &noise) << 4);
+        axis_motion_t motion = axis_predictor_push(&predictor, x, t_us += BENCH_PACKET_INTERVAL_US,
+                                                   50000);
+        sink += axis_predictor_extrapolate(x, motion, 2 * BENCH_PACKET_INTERVAL_US,
+                                           10000, 50000);
+    }
+    uint32_t predictor_cycles = esp_cpu_get_cycle_count() - start;
+    (void)sink;
+
+    ESP_LOGI(TAG, "  one euro filter      : %lu cycles/sample (%lu ns)",
+             filter_cycles / BENCH_ITERATIONS, cycles_to_ns(filter_cycles / BENCH_ITERATIONS));
+    ESP_LOGI(TAG, "  predictor push+extrap: %lu cycles/sample (%lu ns)",
+             predictor_cycles / BENCH_ITERATIONS,
+             cycles_to_ns(predictor_cycles / BENCH_ITERATIONS));
+}
+
+esp_err_t data_processor_run_benchmark(void)
+{
+    const clutch_calibration_t saved = s_calibration;
+    axis_shaping_t saved_shaping[DATA_AXIS_COUNT];
+    memcpy(saved_shaping, s_shaping, sizeof(s_shaping));
+    const bool saved_filter = s_filter_enabled;
+    const bool saved_autocal = s_auto_calibration;
+    const clutch_calibration_t cal = {
+        .left_min = 310, .left_max = 3790,
+        .right_min = 205, .right_max = 3902,
+        .calibrated = true,
+    };
+
+    // Reference outputs assume identity shaping, no filter, fixed bounds
+    s_calibration = cal;
+    for (int i = 0; i < DATA_AXIS_COUNT; i++) {
+        s_shaping[i] = (axis_shaping_t)AXIS_SHAPING_IDENTITY;
+    }
+    s_filter_enabled = false;
+    s_auto_calibration = false;
+    rebuild_calibration_lut();
+
+    uint32_t mismatches = bench_calibration_lut(&cal);
+    uint32_t wrong = bench_packet_path(&cal);
+    bench_pipeline();
+
+    s_calibration = saved;
+    memcpy(s_shaping, saved_shaping, sizeof(s_shaping));
+    s_filter_enabled = saved_filter;
+    s_auto_calibration = saved_autocal;
+    rebuild_calibration_lut();
+
+    return (mismatches == 0 && wrong == 0) ? ESP_OK : ESP_FAIL;
+}
+
+#endif // CONFIG_CLUTCH_BENCHMARKS
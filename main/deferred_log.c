@@ -0,0 +1,221 @@
+/**
+ * @file deferred_log.c
+ * @brief Deferred, rate-limited logging implementation
+ *
+ * Producers: any task (WiFi, ingest, HID, ...) — serialized by a spinlock
+ * held only for the rate-limit check and a ~30-byte copy.
+ * Consumer: task_dlog, which owns all UART output.
+ */
+
+#include "deferred_log.h"
+#include "hot_path.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#define DLOG_RING_ENTRIES CONFIG_CLUTCH_DLOG_RING_ENTRIES
+#define DLOG_RING_MASK    (DLOG_RING_ENTRIES - 1)
+#define DLOG_LINE_LEN     160
+
+_Static_assert((DLOG_RING_ENTRIES & (DLOG_RING_ENTRIES - 1)) == 0,
+               "CONFIG_CLUTCH_DLOG_RING_ENTRIES must be a power of two");
+
+/* Token buckets are kept in micro-tokens so refill needs no division */
+#define DLOG_TOKEN_SCALE 1000000ULL
+
+typedef struct {
+    const char *fmt;
+    uint32_t args[DLOG_MAX_ARGS];
+    uint32_t time_ms;
+    uint8_t level;
+    uint8_t tag;
+} dlog_entry_t;
+
+typedef struct {
+    uint32_t per_second;
+    uint64_t burst_utokens;
+    uint64_t utokens;
+    int64_t last_refill_us;
+    esp_log_level_t level;
+    dlog_tag_stats_t stats;
+    uint32_t reported_drops;    // consumer-owned: drops already announced
+} dlog_tag_state_t;
+
+static const char *s_tag_names[DLOG_TAG_COUNT] = {
+    [DLOG_TAG_ESPNOW]    = "ESPNOW_HANDLER",
+    [DLOG_TAG_INGEST]    = "INGEST",
+    [DLOG_TAG_PROCESSOR] = "DATA_PROCESSOR",
+    [DLOG_TAG_HID]       = "USB_HID",
+};
+
+static dlog_entry_t s_ring[DLOG_RING_ENTRIES];
+static uint32_t s_head = 0;     // guarded by s_lock
+static uint32_t s_tail = 0;     // consumer only (read under s_lock by producers)
+static dlog_tag_state_t s_tags[DLOG_TAG_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = NULL;
+
+esp_err_t dlog_init(void)
+{
+    memset(s_tags, 0, sizeof(s_tags));
+    s_head = 0;
+    s_tail = 0;
+
+    for (int i = 0; i < DLOG_TAG_COUNT; i++) {
+        dlog_set_rate_limit((dlog_tag_t)i, CONFIG_CLUTCH_DLOG_RATE_PER_SEC,
+                            CONFIG_CLUTCH_DLOG_RATE_BURST);
+        s_tags[i].level = ESP_LOG_INFO;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dlog_set_rate_limit(dlog_tag_t tag, uint32_t per_second, uint32_t burst)
+{
+    if (tag >= DLOG_TAG_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    dlog_tag_state_t *t = &s_tags[tag];
+    t->per_second = per_second;
+    t->burst_utokens = (uint64_t)burst * DLOG_TOKEN_SCALE;
+    t->utokens = t->burst_utokens;
+    t->last_refill_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t dlog_set_level(dlog_tag_t tag, esp_log_level_t level)
+{
+    if (tag >= DLOG_TAG_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_tags[tag].level = level;
+    return ESP_OK;
+}
+
+esp_err_t dlog_get_stats(dlog_tag_t tag, dlog_tag_stats_t *stats)
+{
+    if (tag >= DLOG_TAG_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_tags[tag].stats;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+HOT_PATH_FN void dlog_write(esp_log_level_t level, dlog_tag_t tag, const char *fmt,
+                            const uint32_t args[DLOG_MAX_ARGS])
+{
+    if (tag >= DLOG_TAG_COUNT || level > s_tags[tag].level) {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    uint32_t time_ms = (uint32_t)(now_us / 1000);
+    bool queued = false;
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    dlog_tag_state_t *t = &s_tags[tag];
+
+    uint64_t elapsed_us = (uint64_t)(now_us - t->last_refill_us);
+    t->last_refill_us = now_us;
+    t->utokens += elapsed_us * t->per_second;
+    if (t->utokens > t->burst_utokens) {
+        t->utokens = t->burst_utokens;
+    }
+
+    if (t->utokens < DLOG_TOKEN_SCALE) {
+        t->stats.rate_limited++;
+    } else if (s_head - s_tail >= DLOG_RING_ENTRIES) {
+        t->stats.ring_full++;
+    } else {
+        t->utokens -= DLOG_TOKEN_SCALE;
+        dlog_entry_t *e = &s_ring[s_head & DLOG_RING_MASK];
+        e->fmt = fmt;
+        memcpy(e->args, args, sizeof(e->args));
+        e->time_ms = time_ms;
+        e->level = (uint8_t)level;
+        e->tag = (uint8_t)tag;
+        s_head++;
+        t->stats.logged++;
+        queued = true;
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+
+    if (queued && s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+static char level_letter(esp_log_level_t level)
+{
+    switch (level) {
+        case ESP_LOG_ERROR:   return 'E';
+        case ESP_LOG_WARN:    return 'W';
+        case ESP_LOG_INFO:    return 'I';
+        case ESP_LOG_DEBUG:   return 'D';
+        default:              return 'V';
+    }
+}
+
+static void report_drops(void)
+{
+    for (int i = 0; i < DLOG_TAG_COUNT; i++) {
+        portENTER_CRITICAL(&s_lock);
+        dlog_tag_stats_t stats = s_tags[i].stats;
+        portEXIT_CRITICAL(&s_lock);
+
+        uint32_t drops = stats.rate_limited + stats.ring_full;
+        if (drops != s_tags[i].reported_drops) {
+            esp_log_write(ESP_LOG_WARN, s_tag_names[i],
+                          "W (%lu) %s: %lu log messages dropped (rate limit %lu, ring full %lu)\n",
+                          (unsigned long)esp_log_timestamp(), s_tag_names[i],
+                          (unsigned long)(drops - s_tags[i].reported_drops),
+                          (unsigned long)stats.rate_limited,
+                          (unsigned long)stats.ring_full);
+            s_tags[i].reported_drops = drops;
+        }
+    }
+}
+
+void task_dlog(void *arg)
+{
+    (void)arg;
+    char line[DLOG_LINE_LEN];
+
+    s_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        /* Wake on new messages, or once a second to announce drops */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+        while (1) {
+            dlog_entry_t e;
+
+            portENTER_CRITICAL(&s_lock);
+            bool empty = (s_tail == s_head);
+            if (!empty) {
+                e = s_ring[s_tail & DLOG_RING_MASK];
+                s_tail++;
+            }
+            portEXIT_CRITICAL(&s_lock);
+
+            if (empty) {
+                break;
+            }
+
+            snprintf(line, sizeof(line), e.fmt,
+                     e.args[0], e.args[1], e.args[2], e.args[3]);
+            esp_log_write((esp_log_level_t)e.level, s_tag_names[e.tag],
+                          "%c (%lu) %s: %s\n", level_letter((esp_log_level_t)e.level),
+                          (unsigned long)e.time_ms, s_tag_names[e.tag], line);
+        }
+
+        report_drops();
+    }
+}
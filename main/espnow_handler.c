@@ -4,34 +4,116 @@
  */
 
 #include "espnow_handler.h"
+#include "hot_path.h"
+#include "deferred_log.h"
+#include "espnow_wire.h"
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_mac.h"
-#include "nvs_flash.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "ESPNOW_HANDLER";
 
 static bool s_is_initialized = false;
 static espnow_recv_callback_t s_recv_callback = NULL;
+static uint8_t s_channel = CONFIG_CLUTCH_RENDEZVOUS_CHANNEL;
+static _Atomic uint16_t s_tx_seq = 0;   // wire header seq of frames we send
+
+static const uint8_t s_broadcast_mac[ESP_NOW_ETH_ALEN] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+/*
+ * Radio profiles (CONFIG_CLUTCH_RADIO_PROFILE_*). The rate applies to
+ * frames this receiver transmits (control frames, MAC ACKs are sent at
+ * the matching basic rate); senders pick their own TX rate and retry
+ * count and should be built with the same profile. Zero buffer counts and
+ * protocols keep the sdkconfig / driver defaults.
+ */
+typedef struct {
+    const char     *name;
+    uint8_t         protocols;      ///< STA protocol bitmap
+    bool            set_rate;       ///< Apply phymode/rate to every peer
+    wifi_phy_mode_t phymode;
+    wifi_phy_rate_t rate;
+    wifi_ps_type_t  power_save;
+    int8_t          max_tx_power;   ///< 0.25 dBm units, 0 = default
+    uint8_t         static_rx_buf;
+    uint8_t         dynamic_rx_buf;
+    uint8_t         dynamic_tx_buf;
+} radio_profile_t;
+
+static const radio_profile_t s_profile = {
+#if CONFIG_CLUTCH_RADIO_PROFILE_LOW_LATENCY
+    /* 24 Mbit/s OFDM: a clutch frame is on air ~40 us instead of ~600 us
+     * at 1 Mbit/s, and modem sleep is off so no beacon-interval wakeups */
+    .name = "low latency",
+    .protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N,
+    .set_rate = true,
+    .phymode = WIFI_PHY_MODE_11G,
+    .rate = WIFI_PHY_RATE_24M,
+    .power_save = WIFI_PS_NONE,
+    .static_rx_buf = 8,
+    .dynamic_rx_buf = 16,
+    .dynamic_tx_buf = 8,
+#elif CONFIG_CLUTCH_RADIO_PROFILE_LONG_RANGE
+    /* Espressif LR at 250 kbit/s for a receiver behind a metal rig; plain
+     * 802.11b/g/n senders are still received */
+    .name = "long range",
+    .protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N |
+                 WIFI_PROTOCOL_LR,
+    .set_rate = true,
+    .phymode = WIFI_PHY_MODE_LR,
+    .rate = WIFI_PHY_RATE_LORA_250K,
+    .power_save = WIFI_PS_NONE,
+    .max_tx_power = 84,             // 21 dBm
+    .static_rx_buf = 10,
+    .dynamic_rx_buf = 24,           // longer frames, more retries in flight
+    .dynamic_tx_buf = 8,
+#else
+    .name = "default",
+    .power_save = WIFI_PS_NONE,
+#endif
+};
+
+static void apply_peer_rate(const uint8_t *peer_mac)
+{
+    if (!s_profile.set_rate) {
+        return;
+    }
+
+    esp_now_rate_config_t rate = {
+        .phymode = s_profile.phymode,
+        .rate = s_profile.rate,
+    };
+    esp_err_t ret = esp_now_set_peer_rate_config(peer_mac, &rate);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Peer rate config failed: %s", esp_err_to_name(ret));
+    }
+}
 
 /**
  * @brief ESP-NOW receive callback (internal)
  * 
  * This function is called by ESP-NOW when data is received
  */
-static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len)
+static HOT_PATH_FN void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len)
 {
+    int64_t rx_time_us = esp_timer_get_time();
+
     if (recv_info == NULL || data == NULL || len <= 0) {
-        ESP_LOGE(TAG, "Invalid receive parameters");
+        DLOGE(DLOG_TAG_ESPNOW, "Invalid receive parameters (len %d)", len);
         return;
     }
 
-    ESP_LOGI(TAG, "Received %d bytes from " MACSTR, len, MAC2STR(recv_info->src_addr));
+    int8_t rssi = (recv_info->rx_ctrl != NULL) ? (int8_t)recv_info->rx_ctrl->rssi : 0;
 
-    // Call user callback if registered
+    // WiFi task context: no UART output here. Call user callback if registered
     if (s_recv_callback != NULL) {
-        s_recv_callback(recv_info->src_addr, data, len);
+        s_recv_callback(recv_info->src_addr, data, len, rssi, rx_time_us);
     }
 }
 
@@ -43,18 +125,18 @@ static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *
 static void espnow_send_cb(const esp_now_send_info_t *tx_info, esp_now_send_status_t status)
 {
     if (tx_info == NULL) {
-        ESP_LOGE(TAG, "Invalid send callback parameters");
+        DLOGE(DLOG_TAG_ESPNOW, "Invalid send callback parameters");
         return;
     }
 
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        ESP_LOGD(TAG, "Send success to " MACSTR, MAC2STR(tx_info->des_addr));
-    } else {
-        ESP_LOGW(TAG, "Send failed to " MACSTR, MAC2STR(tx_info->des_addr));
+    if (status != ESP_NOW_SEND_SUCCESS) {
+        const uint8_t *mac = tx_info->des_addr;
+        DLOGW(DLOG_TAG_ESPNOW, "Send failed to ..:%02x:%02x:%02x",
+              mac[3], mac[4], mac[5]);
     }
 }
 
-esp_err_t espnow_handler_init(void)
+esp_err_t espnow_handler_init(bool softap)
 {
     esp_err_t ret;
 
@@ -63,33 +145,37 @@ esp_err_t espnow_handler_init(void)
         return ESP_OK;
     }
 
-    // Initialize NVS
-    ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-
-    // Initialize WiFi
+    // Initialize WiFi (NVS is initialized by app_main)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    /* Create lwIP network interfaces — required for DHCP server (AP) and
-     * HTTP server.  Must be done before esp_wifi_start(). */
-    esp_netif_create_default_wifi_sta();
-    esp_netif_create_default_wifi_ap();
+    /* Create the lwIP AP interface — required for the DHCP server and HTTP
+     * server. Must be done before esp_wifi_start(). ESP-NOW rides on the
+     * STA interface without IP, so no STA netif is created. */
+    if (softap) {
+        esp_netif_create_default_wifi_ap();
+    }
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    if (s_profile.static_rx_buf) cfg.static_rx_buf_num = s_profile.static_rx_buf;
+    if (s_profile.dynamic_rx_buf) cfg.dynamic_rx_buf_num = s_profile.dynamic_rx_buf;
+    if (s_profile.dynamic_tx_buf) cfg.dynamic_tx_buf_num = s_profile.dynamic_tx_buf;
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
     /* WIFI_AP_STA is required so ESP-NOW and the web AP coexist.
      * The AP interface is configured later by web_config_init(). */
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(softap ? WIFI_MODE_APSTA : WIFI_MODE_STA));
+    if (s_profile.protocols) {
+        ESP_ERROR_CHECK(esp_wifi_set_protocol(WIFI_IF_STA, s_profile.protocols));
+    }
     ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_set_ps(s_profile.power_save));
+    if (s_profile.max_tx_power) {
+        ESP_ERROR_CHECK(esp_wifi_set_max_tx_power(s_profile.max_tx_power));
+    }
 
-    // Set WiFi channel (optional, can be configured)
-    ESP_ERROR_CHECK(esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE));
+    // Start on the rendezvous channel; channel_manager moves on from there
+    ESP_ERROR_CHECK(esp_wifi_set_channel(s_channel, WIFI_SECOND_CHAN_NONE));
 
     // Initialize ESP-NOW
     ret = esp_now_init();
@@ -102,8 +188,18 @@ esp_err_t espnow_handler_init(void)
     ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
 
+    // Broadcast peer for control frames to every sender
+    esp_now_peer_info_t broadcast = {};
+    memcpy(broadcast.peer_addr, s_broadcast_mac, ESP_NOW_ETH_ALEN);
+    broadcast.channel = 0;  // current channel
+    broadcast.ifidx = WIFI_IF_STA;
+    broadcast.encrypt = false;
+    ESP_ERROR_CHECK(esp_now_add_peer(&broadcast));
+    apply_peer_rate(s_broadcast_mac);
+
     s_is_initialized = true;
-    ESP_LOGI(TAG, "ESP-NOW initialized successfully");
+    ESP_LOGI(TAG, "ESP-NOW initialized successfully (%s, %s profile)",
+             softap ? "APSTA" : "STA only", s_profile.name);
 
     return ESP_OK;
 }
@@ -136,7 +232,8 @@ esp_err_t espnow_handler_register_recv_callback(espnow_recv_callback_t callback)
     return ESP_OK;
 }
 
-esp_err_t espnow_handler_add_peer(const uint8_t *peer_mac)
+/* Add or update a peer; lmk == NULL adds it unencrypted */
+static esp_err_t add_peer(const uint8_t *peer_mac, const uint8_t *lmk)
 {
     if (!s_is_initialized) {
         ESP_LOGE(TAG, "ESP-NOW not initialized");
@@ -148,22 +245,56 @@ esp_err_t espnow_handler_add_peer(const uint8_t *peer_mac)
         return ESP_ERR_INVALID_ARG;
     }
 
+    bool exists = esp_now_is_peer_exist(peer_mac);
+    if (exists && lmk == NULL) {
+        return ESP_OK;  // never downgrade an encrypted peer
+    }
+
     esp_now_peer_info_t peer_info = {};
     memcpy(peer_info.peer_addr, peer_mac, ESP_NOW_ETH_ALEN);
-    peer_info.channel = 1;  // Same as WiFi channel
+    peer_info.channel = 0;  // 0 = follow the current WiFi channel
     peer_info.ifidx = WIFI_IF_STA;
-    peer_info.encrypt = false;  // No encryption for simplicity
+    peer_info.encrypt = lmk != NULL;
+    if (lmk != NULL) {
+        memcpy(peer_info.lmk, lmk, ESP_NOW_KEY_LEN);
+    }
 
-    esp_err_t ret = esp_now_add_peer(&peer_info);
+    esp_err_t ret = exists ? esp_now_mod_peer(&peer_info) : esp_now_add_peer(&peer_info);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add peer: %s", esp_err_to_name(ret));
         return ret;
     }
+    apply_peer_rate(peer_mac);
 
-    ESP_LOGI(TAG, "Peer added: " MACSTR, MAC2STR(peer_mac));
+    ESP_LOGI(TAG, "Peer added: " MACSTR "%s", MAC2STR(peer_mac),
+             lmk != NULL ? " (encrypted)" : "");
     return ESP_OK;
 }
 
+esp_err_t espnow_handler_add_peer(const uint8_t *peer_mac)
+{
+    return add_peer(peer_mac, NULL);
+}
+
+esp_err_t espnow_handler_add_encrypted_peer(const uint8_t *peer_mac, const uint8_t *lmk)
+{
+    if (lmk == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return add_peer(peer_mac, lmk);
+}
+
+esp_err_t espnow_handler_set_pmk(const uint8_t *pmk)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (pmk == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_now_set_pmk(pmk);
+}
+
 esp_err_t espnow_handler_remove_peer(const uint8_t *peer_mac)
 {
     if (!s_is_initialized) {
@@ -186,6 +317,61 @@ esp_err_t espnow_handler_remove_peer(const uint8_t *peer_mac)
     return ESP_OK;
 }
 
+esp_err_t espnow_handler_send(const uint8_t *peer_mac, const void *data, size_t len)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (data == NULL || len == 0 || len > ESPNOW_MAX_DATA_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return esp_now_send(peer_mac != NULL ? peer_mac : s_broadcast_mac, data, len);
+}
+
+esp_err_t espnow_handler_send_wire(const uint8_t *peer_mac, uint8_t type,
+                                   const void *payload, size_t len)
+{
+    uint8_t frame[ESPNOW_MAX_DATA_LEN];
+
+    if (payload == NULL || len > sizeof(frame) - sizeof(espnow_wire_header_t)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const espnow_wire_header_t hdr = {
+        .magic = ESPNOW_WIRE_MAGIC,
+        .version = ESPNOW_WIRE_VERSION,
+        .type = type,
+        .seq = atomic_fetch_add_explicit(&s_tx_seq, 1, memory_order_relaxed),
+    };
+    memcpy(frame, &hdr, sizeof(hdr));
+    memcpy(frame + sizeof(hdr), payload, len);
+
+    return espnow_handler_send(peer_mac, frame, sizeof(hdr) + len);
+}
+
+esp_err_t espnow_handler_set_channel(uint8_t channel)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (channel < 1 || channel > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_channel = channel;
+    return ESP_OK;
+}
+
+uint8_t espnow_handler_get_channel(void)
+{
+    return s_channel;
+}
+
 bool espnow_handler_is_initialized(void)
 {
     return s_is_initialized;
@@ -0,0 +1,71 @@
+/**
+ * @file axis_filter.h
+ * @brief Fixed-point One Euro filter for noisy ADC axes
+ *
+ * The One Euro filter is a low-pass whose cutoff rises with the speed of
+ * the input: at rest it smooths ADC noise hard, during fast paddle moves
+ * the cutoff opens up and the added lag drops towards zero.
+ *
+ *   cutoff = min_cutoff + beta * |filtered velocity|
+ *   alpha  = 2*pi*cutoff*dt / (2*pi*cutoff*dt + 1)
+ *   x_hat += alpha * (x - x_hat)
+ *
+ * All arithmetic is integer; axis values are 16-bit (0-65535).
+ * See Casiez et al., "1 Euro Filter", CHI 2012.
+ */
+
+#ifndef AXIS_FILTER_H
+#define AXIS_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest cutoff the filter opens up to, in 0.01 Hz */
+#define AXIS_FILTER_MAX_CUTOFF_CHZ  10000
+
+/**
+ * @brief Filter parameters
+ */
+typedef struct {
+    uint16_t min_cutoff_chz;    ///< Cutoff at rest, 0.01 Hz (100 = 1 Hz)
+    uint16_t beta;              ///< Cutoff increase in 0.01 Hz per axis unit/ms of velocity
+    uint16_t d_cutoff_chz;      ///< Cutoff of the velocity estimate, 0.01 Hz
+} axis_filter_params_t;
+
+/**
+ * @brief Filter state of one axis
+ */
+typedef struct {
+    int32_t  x_q8;              ///< Filtered value, Q8
+    int32_t  dx;                ///< Filtered velocity, axis units per ms
+    int64_t  last_us;           ///< Timestamp of the previous sample
+    uint32_t delay_us;          ///< Group delay added by the last update
+    bool     primed;            ///< A sample has been seen
+} axis_filter_t;
+
+/**
+ * @brief Reset a filter so the next sample passes through unchanged
+ */
+void axis_filter_reset(axis_filter_t *f);
+
+/**
+ * @brief Filter one sample
+ *
+ * @param f Filter state
+ * @param p Parameters
+ * @param x New axis value (0-65535)
+ * @param t_us Sample timestamp (esp_timer time)
+ * @return Filtered axis value
+ */
+uint16_t axis_filter_update(axis_filter_t *f, const axis_filter_params_t *p,
+                            uint16_t x, int64_t t_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AXIS_FILTER_H
@@ -0,0 +1,78 @@
+/**
+ * @file axis_predictor.h
+ * @brief Dead reckoning of an axis between late ESP-NOW packets
+ *
+ * The ingest task pushes each timestamped sample; the predictor keeps the
+ * last AXIS_PREDICTOR_HISTORY samples and publishes the average velocity
+ * and sample interval over them. When the next packet is late the HID
+ * reporter extrapolates from the newest sample with that velocity, for at
+ * most a horizon, and gives up after a timeout. A fresh packet replaces
+ * the prediction immediately.
+ */
+
+#ifndef AXIS_PREDICTOR_H
+#define AXIS_PREDICTOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Samples kept per axis */
+#define AXIS_PREDICTOR_HISTORY 4
+
+/**
+ * @brief Motion estimate published to the reporter
+ */
+typedef struct {
+    int32_t  velocity_q4;   ///< Axis units per ms, Q4
+    uint32_t interval_us;   ///< Average sample interval, 0 until known
+} axis_motion_t;
+
+/**
+ * @brief Sample history of one axis (ingest task only)
+ */
+typedef struct {
+    int64_t  t_us[AXIS_PREDICTOR_HISTORY];
+    uint16_t value[AXIS_PREDICTOR_HISTORY];
+    uint8_t  head;          ///< Next slot to write
+    uint8_t  count;         ///< Valid samples
+} axis_predictor_t;
+
+/**
+ * @brief Add a sample and compute the motion estimate
+ *
+ * Samples more than timeout_us apart restart the history.
+ *
+ * @param p Predictor state
+ * @param value Axis value (0-65535)
+ * @param t_us Sample timestamp (esp_timer time)
+ * @param timeout_us Gap after which older samples are discarded
+ * @return Motion estimate over the kept samples
+ */
+axis_motion_t axis_predictor_push(axis_predictor_t *p, uint16_t value,
+                                  int64_t t_us, uint32_t timeout_us);
+
+/**
+ * @brief Extrapolate an axis value (HID reporter)
+ *
+ * Returns value unchanged while the next sample is not yet late (age up
+ * to 1.5 sample intervals) and once age exceeds timeout_us.
+ *
+ * @param value Newest sample
+ * @param motion Motion estimate pushed with that sample
+ * @param age_us Time since the newest sample
+ * @param horizon_us Longest extrapolation
+ * @param timeout_us Age after which prediction stops
+ * @return Predicted axis value (0-65535)
+ */
+uint16_t axis_predictor_extrapolate(uint16_t value, axis_motion_t motion,
+                                    uint32_t age_us, uint32_t horizon_us,
+                                    uint32_t timeout_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AXIS_PREDICTOR_H
@@ -0,0 +1,41 @@
+/**
+ * @file boot_trace.h
+ * @brief Boot-phase timing markers
+ *
+ * Each marker records esp_timer_get_time() (time since the timer started
+ * in early startup, a few ms after reset) under a phase name. Markers can
+ * be set from any task; the table is printed once startup has settled so
+ * logging does not slow the phases it measures.
+ */
+
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Markers kept; further marks are dropped */
+#define BOOT_TRACE_MAX_MARKS 16
+
+/**
+ * @brief Record the end of a boot phase
+ *
+ * Lock-free, safe from any task (not from ISRs).
+ *
+ * @param phase Phase name, must be a string literal or otherwise static
+ */
+void boot_trace_mark(const char *phase);
+
+/**
+ * @brief Log all markers with the time since the previous one
+ */
+void boot_trace_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_TRACE_H
@@ -0,0 +1,63 @@
+/**
+ * @file calib_store.h
+ * @brief Persist calibration, axis shaping and filter settings in NVS
+ *
+ * Everything the data processor needs to normalize the first packet after
+ * boot is stored as one versioned, CRC-protected blob. Changes made at
+ * runtime only request a save; a low-priority task writes the blob once
+ * the settings have been stable for CONFIG_CLUTCH_CALIB_SAVE_DELAY_MS, so
+ * dragging a slider in the web UI does not hammer the flash.
+ *
+ * NVS must be initialized before calib_store_load().
+ */
+
+#ifndef CALIB_STORE_H
+#define CALIB_STORE_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Load the stored record and apply it to the data processor
+ *
+ * Call after data_processor_init() and before the ESP-NOW receive
+ * callback is registered.
+ *
+ * @return ESP_OK if a record was applied, ESP_ERR_NOT_FOUND if none is
+ *         stored, ESP_ERR_INVALID_VERSION / ESP_ERR_INVALID_CRC if the
+ *         stored record was rejected (defaults stay in effect)
+ */
+esp_err_t calib_store_load(void);
+
+/**
+ * @brief Request a debounced save of the current settings
+ *
+ * Cheap and non-blocking; safe to call from any task. Ignored while
+ * calib_store_load() is applying a record.
+ */
+void calib_store_request_save(void);
+
+/**
+ * @brief Write the current settings now (blocking, flash write)
+ */
+esp_err_t calib_store_save(void);
+
+/**
+ * @brief Erase the stored record
+ */
+esp_err_t calib_store_erase(void);
+
+/**
+ * FreeRTOS task: performs debounced saves. Lowest useful priority,
+ * stack 3072.
+ */
+void task_calib_store(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CALIB_STORE_H
@@ -0,0 +1,144 @@
+/**
+ * @file capture.h
+ * @brief On-device ESP-NOW capture and timed replay
+ *
+ * While recording, every admitted frame is appended to a byte ring
+ * (PSRAM when available) as a capture_record_t followed by the payload,
+ * in the WiFi task with one memcpy and no formatting. When the ring is
+ * full the oldest records are overwritten, so it always holds the most
+ * recent stretch: stop it right after an incident to keep it.
+ *
+ * Replay feeds the stored stream back into the ingest ring with the
+ * original inter-frame timing, from an esp_timer, while frames from the
+ * radio are dropped. The processor, reporter and latency stages see the
+ * same traffic on every run.
+ *
+ * Reading (capture_read) and replay need a stopped capture. The control
+ * calls (start, stop, replay) may block for a few ticks while the radio
+ * path leaves the ingest ring; call them from one task at a time, or post
+ * capture_request() from contexts that must not block (the HID Feature
+ * handlers) and let task_capture carry it out.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stored record header, followed by len payload bytes
+ */
+typedef struct {
+    uint32_t rx_time_us;    ///< esp_timer time of the frame, low 32 bits
+    uint8_t  mac[6];        ///< Sender MAC address
+    int8_t   rssi;          ///< RSSI (dBm)
+    uint8_t  len;           ///< Payload length
+} __attribute__((packed)) capture_record_t;
+
+/**
+ * @brief Capture state
+ */
+typedef enum {
+    CAPTURE_IDLE = 0,       ///< Stopped; the ring keeps the last capture
+    CAPTURE_RECORDING,      ///< Appending radio frames
+    CAPTURE_REPLAYING,      ///< Feeding the ring to the ingest path
+} capture_state_t;
+
+/**
+ * @brief Capture statistics
+ */
+typedef struct {
+    capture_state_t state;
+    uint32_t records;       ///< Records in the ring
+    uint32_t bytes;         ///< Bytes in the ring
+    uint32_t capacity;      ///< Ring size in bytes, 0 if not allocated
+    uint32_t overwritten;   ///< Oldest records dropped to make room
+    uint32_t replayed;      ///< Records fed by the last replay
+    uint32_t replay_late_max_us; ///< Worst lateness against the original timing
+} capture_stats_t;
+
+/**
+ * @brief Allocate the ring; starts recording with CONFIG_CLUTCH_CAPTURE_AT_BOOT
+ *
+ * Call before the ESP-NOW receive callback is registered.
+ */
+esp_err_t capture_init(void);
+
+/**
+ * @brief Radio path into the ingest ring (WiFi task)
+ *
+ * Records the frame while recording and queues it with ingest_push();
+ * drops it while a replay owns the ingest ring.
+ *
+ * @return true if queued
+ */
+bool capture_rx(const uint8_t *mac_addr, const uint8_t *data, int len,
+                int8_t rssi, int64_t rx_time_us);
+
+/**
+ * @brief Clear the ring and start recording
+ */
+esp_err_t capture_start(void);
+
+/**
+ * @brief Stop recording or replay; the ring keeps its contents
+ */
+void capture_stop(void);
+
+/**
+ * @brief Replay the ring into the ingest path with the original timing
+ *
+ * @return ESP_OK if started, ESP_ERR_INVALID_STATE unless idle with
+ *         records, ESP_ERR_NOT_SUPPORTED without a ring
+ */
+esp_err_t capture_replay(void);
+
+/**
+ * @brief Ask task_capture to start (CAPTURE_RECORDING), replay
+ *        (CAPTURE_REPLAYING) or stop (CAPTURE_IDLE)
+ *
+ * Non-blocking, safe from any task; a newer request replaces one not yet
+ * carried out.
+ *
+ * @return ESP_OK if posted, ESP_ERR_NOT_SUPPORTED without a ring
+ */
+esp_err_t capture_request(capture_state_t state);
+
+/**
+ * FreeRTOS task: carries out capture_request(). Only with
+ * CONFIG_CLUTCH_CAPTURE; priority 2, stack 3072.
+ */
+void task_capture(void *arg);
+
+/**
+ * @brief Current state
+ */
+capture_state_t capture_get_state(void);
+
+/**
+ * @brief Get capture statistics
+ */
+void capture_get_stats(capture_stats_t *stats);
+
+/**
+ * @brief Copy stored bytes (records in order, oldest first) while idle
+ *
+ * @param offset Byte offset into the stored stream
+ * @param buf Destination
+ * @param len Bytes wanted
+ * @return Bytes copied, 0 past the end or while not idle
+ */
+size_t capture_read(uint32_t offset, void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_H
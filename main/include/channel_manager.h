@@ -0,0 +1,79 @@
+/**
+ * @file channel_manager.h
+ * @brief ESP-NOW channel survey, selection and coordinated hopping
+ *
+ * At startup the radio dwells on every channel up to
+ * CONFIG_CLUTCH_CHANNEL_MAX in promiscuous mode and scores it by foreign
+ * airtime and noise floor, plus the ESP-NOW loss last seen while it was
+ * the home channel. The best channel is announced to the senders with
+ * ESPNOW_WIRE_TYPE_CHANNEL broadcasts (espnow_wire.h) and both sides move
+ * together.
+ *
+ * Senders that lose contact fall back to CONFIG_CLUTCH_RENDEZVOUS_CHANNEL;
+ * the receiver visits it every CONFIG_CLUTCH_RENDEZVOUS_INTERVAL_MS and
+ * sends them home. Sustained loss from the sequence-number tracking
+ * (link_quality.h) above CONFIG_CLUTCH_CHANNEL_RESURVEY_LOSS_PERMILLE
+ * triggers a re-survey, interleaved with returns to the home channel so
+ * reception is interrupted for one dwell at a time.
+ *
+ * In config mode the SoftAP moves with the channel, so web clients
+ * reconnect after a change.
+ */
+
+#ifndef CHANNEL_MANAGER_H
+#define CHANNEL_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Survey result of one channel
+ */
+typedef struct {
+    uint8_t  channel;           ///< WiFi channel
+    bool     surveyed;          ///< Measured at least once
+    uint16_t busy_permille;     ///< Foreign airtime during the dwell (estimated at 6 Mbit/s)
+    int8_t   noise_dbm;         ///< Average noise floor
+    uint16_t loss_permille;     ///< ESP-NOW loss while home channel (moving average)
+    uint16_t cost;              ///< Score, lower is better
+} channel_survey_entry_t;
+
+/**
+ * @brief Request a survey now (e.g. from the web UI)
+ *
+ * Non-blocking; the survey runs in task_channel_manager.
+ */
+void channel_manager_request_survey(void);
+
+/**
+ * @brief Copy the survey result of a channel
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG outside 1..CONFIG_CLUTCH_CHANNEL_MAX
+ */
+esp_err_t channel_manager_get_survey(uint8_t channel, channel_survey_entry_t *entry);
+
+/**
+ * @brief Format the survey table as JSON (for the web endpoint)
+ *
+ * @return Number of characters written (excluding the terminator)
+ */
+int channel_manager_format_json(char *buf, size_t len);
+
+/**
+ * FreeRTOS task: boot survey, rendezvous visits, loss monitoring and
+ * channel changes. Create after espnow_handler_init(); core 0,
+ * priority 4, stack 3072.
+ */
+void task_channel_manager(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHANNEL_MANAGER_H
@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "sdkconfig.h"
+#include "axis_filter.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,7 +27,10 @@ extern "C" {
 /**
  * @brief ESP-NOW data packet structure for sim racing controls
  * 
- * This structure defines the expected format from the ESP-NOW sender
+ * This structure defines the expected format from the ESP-NOW sender.
+ * Sent as the ESPNOW_WIRE_TYPE_SIMRACING payload of a versioned frame
+ * (espnow_wire.h). All axes are 12-bit (0-4095), little-endian.
+ * checksum is the XOR of all preceding bytes of the structure.
  */
 typedef struct {
     uint32_t buttons;           ///< Button states (32 buttons, 1 bit each)
@@ -35,7 +40,7 @@ typedef struct {
     uint16_t axis_y;            ///< Additional axis (optional)
     uint16_t axis_z;            ///< Additional axis (optional)
     uint16_t axis_rx;           ///< Additional axis (optional)
-    uint8_t checksum;           ///< Optional checksum for validation
+    uint8_t checksum;           ///< XOR of all preceding bytes
 } __attribute__((packed)) espnow_simracing_data_t;
 
 /**
@@ -64,42 +69,67 @@ esp_err_t data_processor_deinit(void);
 /**
  * @brief Process received ESP-NOW data and convert to HID report
  * 
- * This function processes raw ESP-NOW data and forwards it as HID gamepad input
+ * This function processes raw ESP-NOW data and forwards it as HID gamepad input.
+ * Accepts the versioned wire format (espnow_wire.h) and legacy 4-byte frames.
+ * Duplicate and stale sequenced frames are discarded and return ESP_OK.
  * 
  * @param mac_addr MAC address of sender
  * @param data Pointer to received data
  * @param len Length of received data
+ * @param rssi Signal strength of the packet (dBm)
+ * @param rx_time_us esp_timer timestamp taken at reception
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t data_processor_process_espnow_data(const uint8_t *mac_addr, 
                                              const uint8_t *data, 
-                                             int len);
+                                             int len,
+                                             int8_t rssi,
+                                             int64_t rx_time_us);
 
 /**
- * @brief Parse raw ESP-NOW data into sim racing structure
+ * @brief Validate raw ESP-NOW data as a sim racing structure, in place
  * 
- * @param raw_data Raw received data
+ * Checks length and checksum without copying; on success parsed_data
+ * points into raw_data and is valid as long as raw_data is.
+ * 
+ * @param raw_data Raw received data (payload after the wire header)
  * @param len Length of raw data
- * @param parsed_data Output parsed structure
- * @return ESP_OK on success, error code otherwise
+ * @param parsed_data Output pointer to the validated structure
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_CRC otherwise
  */
 esp_err_t data_processor_parse_simracing_data(const uint8_t *raw_data,
                                                int len,
-                                               espnow_simracing_data_t *parsed_data);
+                                               const espnow_simracing_data_t **parsed_data);
 
 /**
- * @brief Get statistics about processed data
+ * @brief Get statistics about processed data (METRIC_RX_* in metrics.h)
  * 
  * @param total_packets Pointer to store total packets processed
  * @param total_bytes Pointer to store total bytes processed
  */
-void data_processor_get_stats(uint32_t *total_packets, uint32_t *total_bytes);
+void data_processor_get_stats(uint64_t *total_packets, uint64_t *total_bytes);
+
+/**
+ * @brief Number of sequenced frames discarded as duplicate or stale
+ *        (METRIC_RX_DISCARDED in metrics.h)
+ * 
+ * Per-sender breakdown is in link_quality.h.
+ */
+uint32_t data_processor_get_discarded_count(void);
+
+/**
+ * @brief Get the number of packets dropped because the sender is not registered
+ *        (METRIC_RX_REJECTED in metrics.h)
+ */
+uint32_t data_processor_get_rejected_count(void);
 
 /**
  * @brief Get last packet info
  * 
+ * Per-sender history (RSSI average, jitter, loss) is in link_quality.h.
+ * 
  * @param info Pointer to store last packet info
- * @return ESP_OK on success, error code otherwise
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no packet was received yet
  */
 esp_err_t data_processor_get_last_packet_info(data_packet_info_t *info);
 
@@ -161,6 +191,133 @@ esp_err_t data_processor_set_calibration(const clutch_calibration_t *calib);
  */
 esp_err_t data_processor_reset_calibration(void);
 
+/**
+ * @brief Calibrated clutch axes that can be shaped
+ */
+typedef enum {
+    DATA_AXIS_LEFT_CLUTCH = 0,  ///< Left paddle (digital, see data_processor_set_left_threshold)
+    DATA_AXIS_RIGHT_CLUTCH,     ///< Right paddle (X axis)
+    DATA_AXIS_COUNT
+} data_axis_t;
+
+/**
+ * @brief Response curve applied after the deadzones
+ */
+typedef enum {
+    AXIS_CURVE_LINEAR = 0,      ///< Output = input
+    AXIS_CURVE_GAMMA,           ///< Output = input ^ (gamma_x100 / 100)
+    AXIS_CURVE_PIECEWISE,       ///< Linear interpolation through points[]
+} axis_curve_t;
+
+/** Number of piecewise curve points, evenly spaced over the input range */
+#define AXIS_CURVE_POINTS 9
+
+/**
+ * @brief Per-axis shaping, applied in order after calibration:
+ *        deadzone / saturation -> curve. Values are 12-bit (0-4095).
+ *
+ * The whole pipeline is folded into the calibration lookup table when it
+ * is set, so it costs nothing per packet.
+ */
+typedef struct {
+    uint16_t deadzone;          ///< Inputs at or below this read as 0
+    uint16_t saturation;        ///< Inputs at or above 4095 - saturation read as 4095
+    axis_curve_t curve;         ///< Response curve
+    uint16_t gamma_x100;        ///< AXIS_CURVE_GAMMA exponent x100 (100 = linear)
+    uint16_t points[AXIS_CURVE_POINTS]; ///< AXIS_CURVE_PIECEWISE outputs at inputs i * 4095 / 8
+} axis_shaping_t;
+
+/**
+ * @brief Set the shaping of an axis and rebuild its lookup table
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown axis, a
+ *         zero gamma or deadzone + saturation leaving no travel
+ */
+esp_err_t data_processor_set_axis_shaping(data_axis_t axis, const axis_shaping_t *shaping);
+
+/**
+ * @brief Get the shaping of an axis
+ */
+esp_err_t data_processor_get_axis_shaping(data_axis_t axis, axis_shaping_t *shaping);
+
+/**
+ * @brief Set the left paddle press/release thresholds (hysteresis)
+ *
+ * The paddle reads pressed once the shaped value exceeds press and stays
+ * pressed until it drops to release or below, so noise around a single
+ * threshold cannot make it chatter.
+ *
+ * @param press 12-bit threshold to become pressed
+ * @param release 12-bit threshold to become released (<= press)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if release > press
+ */
+esp_err_t data_processor_set_left_threshold(uint16_t press, uint16_t release);
+
+/**
+ * @brief Get the left paddle press/release thresholds (12-bit)
+ */
+void data_processor_get_left_threshold(uint16_t *press, uint16_t *release);
+
+/**
+ * @brief Enable or disable the adaptive right clutch filter (axis_filter.h)
+ *
+ * Its estimated group delay is recorded in LATENCY_STAGE_FILTER_DELAY.
+ *
+ * @param enabled Filter on or off
+ * @param params New parameters, or NULL to keep the current ones
+ */
+esp_err_t data_processor_set_filter(bool enabled, const axis_filter_params_t *params);
+
+/**
+ * @brief Get the filter parameters
+ *
+ * @param params Pointer to store the parameters, may be NULL
+ * @return true if the filter is enabled
+ */
+bool data_processor_get_filter(axis_filter_params_t *params);
+
+/**
+ * @brief Enable or disable background auto-calibration
+ *
+ * While enabled, per-axis min/max envelopes track endstop drift outside
+ * of timed calibration runs and replace the bounds once they have moved
+ * by CONFIG_CLUTCH_AUTOCAL_HYSTERESIS counts. Enabling starts the
+ * envelopes from the current calibration.
+ */
+esp_err_t data_processor_set_auto_calibration(bool enabled);
+
+/**
+ * @brief Check if background auto-calibration is enabled
+ */
+bool data_processor_get_auto_calibration(void);
+
+/**
+ * FreeRTOS task: ends timed calibration runs and rebuilds the lookup
+ * tables when auto-calibration publishes new bounds, so the ingest task
+ * never does. Low priority, stack 3072.
+ */
+void task_calibration(void *arg);
+
+#if CONFIG_CLUTCH_BENCHMARKS
+/**
+ * @brief Benchmark and self-check the processing hot path
+ *
+ * - division vs lookup-table calibration, checked for identical values
+ * - the whole packet path: a synthetic press/release stream with ADC
+ *   noise through data_processor_process_espnow_data(), in cycles and ns
+ *   per packet, checking the normalized right clutch and the left paddle
+ *   hysteresis against the reference path
+ * - lookup table rebuild per curve, filter and predictor per sample
+ *
+ * Temporarily replaces the calibration, shaping, filter and
+ * auto-calibration settings; run before packets arrive. The synthetic
+ * sender (02:BE:4C:00:00:01) keeps a registry slot, mapped to no field.
+ *
+ * @return ESP_OK if every output matched its reference
+ */
+esp_err_t data_processor_run_benchmark(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,110 @@
+/**
+ * @file deferred_log.h
+ * @brief Deferred, rate-limited logging for the RX and HID hot paths
+ *
+ * ESP_LOGx formats and writes to the 115200-baud UART in the caller's
+ * context, which can block the WiFi task for milliseconds per line. DLOGx
+ * instead stores the format pointer and up to DLOG_MAX_ARGS integer
+ * arguments in a binary ring; a low-priority task formats and prints them.
+ *
+ * Rules for DLOGx:
+ *  - fmt must be a string literal (only the pointer is stored)
+ *  - arguments must fit in 32 bits: %d %u %x %c %ld %lu %p (no %s, no %f)
+ *
+ * Each tag has its own token-bucket rate limit. Messages over the limit or
+ * arriving while the ring is full are counted and never block the caller.
+ */
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of integer arguments per message
+ */
+#define DLOG_MAX_ARGS 4
+
+/**
+ * @brief Deferred log tags (each has its own rate limit and drop counters)
+ */
+typedef enum {
+    DLOG_TAG_ESPNOW = 0,    ///< ESP-NOW receive/send callbacks
+    DLOG_TAG_INGEST,        ///< Ingest task
+    DLOG_TAG_PROCESSOR,     ///< Data processor
+    DLOG_TAG_HID,           ///< HID reporter
+    DLOG_TAG_COUNT
+} dlog_tag_t;
+
+/**
+ * @brief Per-tag counters
+ */
+typedef struct {
+    uint32_t logged;        ///< Messages queued
+    uint32_t rate_limited;  ///< Messages dropped by the rate limit
+    uint32_t ring_full;     ///< Messages dropped because the ring was full
+} dlog_tag_stats_t;
+
+/**
+ * @brief Initialize the deferred logger (call before any DLOGx user starts)
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * @brief Queue a message. Use the DLOGx macros instead of calling directly.
+ *
+ * Never blocks; safe from any task.
+ */
+void dlog_write(esp_log_level_t level, dlog_tag_t tag, const char *fmt,
+                const uint32_t args[DLOG_MAX_ARGS]);
+
+/**
+ * @brief Set the rate limit of a tag
+ *
+ * @param tag Tag to configure
+ * @param per_second Sustained messages per second (0 = drop everything)
+ * @param burst Messages allowed back to back
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t dlog_set_rate_limit(dlog_tag_t tag, uint32_t per_second, uint32_t burst);
+
+/**
+ * @brief Set the most verbose level queued for a tag (default ESP_LOG_INFO)
+ */
+esp_err_t dlog_set_level(dlog_tag_t tag, esp_log_level_t level);
+
+/**
+ * @brief Get the counters of a tag
+ */
+esp_err_t dlog_get_stats(dlog_tag_t tag, dlog_tag_stats_t *stats);
+
+/**
+ * FreeRTOS task: formats queued messages and writes them to the console.
+ * Low priority (2), unpinned, stack 3072.
+ */
+void task_dlog(void *arg);
+
+#define DLOG_(level, tag, fmt, ...) \
+    dlog_write(level, tag, fmt, (const uint32_t[DLOG_MAX_ARGS]){ __VA_ARGS__ })
+
+#define DLOGE(tag, fmt, ...) DLOG_(ESP_LOG_ERROR,   tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_(ESP_LOG_WARN,    tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_(ESP_LOG_INFO,    tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_(ESP_LOG_DEBUG,   tag, fmt, ##__VA_ARGS__)
+#define DLOGV(tag, fmt, ...) DLOG_(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEFERRED_LOG_H
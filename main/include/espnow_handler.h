@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_now.h"
 
 #ifdef __cplusplus
@@ -25,20 +26,28 @@ extern "C" {
 /**
  * @brief Callback function type for received ESP-NOW data
  * 
+ * Called from the WiFi task; must not block.
+ * 
  * @param mac_addr MAC address of the sender
  * @param data Pointer to received data
  * @param len Length of received data
+ * @param rssi Signal strength of the packet (dBm)
+ * @param rx_time_us esp_timer timestamp taken on entry to the receive callback
  */
-typedef void (*espnow_recv_callback_t)(const uint8_t *mac_addr, const uint8_t *data, int len);
+typedef void (*espnow_recv_callback_t)(const uint8_t *mac_addr, const uint8_t *data, int len,
+                                       int8_t rssi, int64_t rx_time_us);
 
 /**
  * @brief Initialize ESP-NOW
  * 
- * Initializes WiFi and ESP-NOW protocol
+ * Initializes WiFi and ESP-NOW protocol. NVS must already be initialized
+ * (nvs_flash_init), as the WiFi driver reads its PHY calibration from it.
  * 
+ * @param softap true for APSTA with the AP netif (web configuration),
+ *               false for STA only (race mode, see radio_mode.h)
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t espnow_handler_init(void);
+esp_err_t espnow_handler_init(bool softap);
 
 /**
  * @brief Deinitialize ESP-NOW
@@ -60,11 +69,34 @@ esp_err_t espnow_handler_register_recv_callback(espnow_recv_callback_t callback)
 /**
  * @brief Add a peer device
  * 
+ * Does nothing if the peer already exists, so an encrypted peer stays
+ * encrypted.
+ *
  * @param peer_mac MAC address of the peer device
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t espnow_handler_add_peer(const uint8_t *peer_mac);
 
+/**
+ * @brief Add a peer, or re-key an existing one, with CCMP encryption
+ *
+ * Frames to and from the peer are encrypted and authenticated by the
+ * WiFi hardware with the PMK set by espnow_handler_set_pmk() and this
+ * local key. At most CONFIG_ESP_WIFI_ESPNOW_MAX_ENCRYPT_NUM peers.
+ *
+ * @param peer_mac MAC address of the peer device
+ * @param lmk Local master key (ESP_NOW_KEY_LEN bytes)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t espnow_handler_add_encrypted_peer(const uint8_t *peer_mac, const uint8_t *lmk);
+
+/**
+ * @brief Set the primary master key (ESP_NOW_KEY_LEN bytes)
+ *
+ * Call before adding encrypted peers.
+ */
+esp_err_t espnow_handler_set_pmk(const uint8_t *pmk);
+
 /**
  * @brief Remove a peer device
  * 
@@ -73,6 +105,50 @@ esp_err_t espnow_handler_add_peer(const uint8_t *peer_mac);
  */
 esp_err_t espnow_handler_remove_peer(const uint8_t *peer_mac);
 
+/**
+ * @brief Send a frame to a peer, or broadcast it
+ *
+ * Unicast peers must have been added with espnow_handler_add_peer().
+ * Completion is reported to the internal send callback.
+ *
+ * @param peer_mac Peer MAC address, or NULL to broadcast
+ * @param data Frame (at most ESPNOW_MAX_DATA_LEN bytes)
+ * @param len Frame length
+ * @return ESP_OK if queued, error code otherwise
+ */
+esp_err_t espnow_handler_send(const uint8_t *peer_mac, const void *data, size_t len);
+
+/**
+ * @brief Send a typed frame in the versioned wire format (espnow_wire.h)
+ *
+ * Prepends the wire header with the receiver's own sequence number, which
+ * is shared by every frame type the receiver sends. Safe to call from any
+ * task.
+ *
+ * @param peer_mac Peer MAC address, or NULL to broadcast
+ * @param type espnow_wire_type_t of the payload
+ * @param payload Payload
+ * @param len Payload length
+ * @return ESP_OK if queued, error code otherwise
+ */
+esp_err_t espnow_handler_send_wire(const uint8_t *peer_mac, uint8_t type,
+                                   const void *payload, size_t len);
+
+/**
+ * @brief Move the radio to another channel
+ *
+ * Peers follow the current channel. In APSTA mode the SoftAP moves too.
+ *
+ * @param channel WiFi channel 1-14
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t espnow_handler_set_channel(uint8_t channel);
+
+/**
+ * @brief Current radio channel
+ */
+uint8_t espnow_handler_get_channel(void);
+
 /**
  * @brief Check if ESP-NOW is initialized
  * 
@@ -0,0 +1,149 @@
+/**
+ * @file espnow_wire.h
+ * @brief ESP-NOW wire format shared with the transmitters
+ *
+ * Versioned frames start with an 8-byte header followed by a typed
+ * payload. All multi-byte fields are little-endian.
+ *
+ *   byte 0    magic        ESPNOW_WIRE_MAGIC
+ *   byte 1    version      ESPNOW_WIRE_VERSION
+ *   byte 2    type         espnow_wire_type_t
+ *   byte 3    flags        reserved, send 0
+ *   byte 4-5  seq          per-sender sequence number, wraps at 65535
+ *   byte 6-7  tx_delta_us  sender time since its previous frame (saturating)
+ *
+ * Frames sent by the receiver use the same header with the receiver's
+ * own sequence number; senders must ignore types they do not know.
+ *
+ * Legacy frames have no header: exactly ESPNOW_WIRE_LEGACY_CLUTCH_LEN bytes
+ * (left/right clutch, uint16 LE). They are still accepted but cannot be
+ * checked for duplicates or reordering.
+ */
+
+#ifndef ESPNOW_WIRE_H
+#define ESPNOW_WIRE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESPNOW_WIRE_MAGIC               0xC1
+#define ESPNOW_WIRE_VERSION             1
+#define ESPNOW_WIRE_LEGACY_CLUTCH_LEN   4
+
+/**
+ * @brief Payload types
+ */
+typedef enum {
+    ESPNOW_WIRE_TYPE_CLUTCH = 0x01,     ///< espnow_wire_clutch_t
+    ESPNOW_WIRE_TYPE_SIMRACING = 0x02,  ///< espnow_simracing_data_t (data_processor.h)
+    ESPNOW_WIRE_TYPE_PONG = 0x03,       ///< espnow_wire_ping_t, echo of a PING
+    ESPNOW_WIRE_TYPE_CHANNEL = 0x10,    ///< espnow_wire_channel_t, receiver -> senders
+    ESPNOW_WIRE_TYPE_RATE = 0x11,       ///< espnow_wire_rate_t, receiver -> one sender
+    ESPNOW_WIRE_TYPE_PING = 0x12,       ///< espnow_wire_ping_t, receiver -> one sender
+    ESPNOW_WIRE_TYPE_PAIR_REQUEST = 0x20, ///< espnow_wire_pair_request_t, sender broadcast
+    ESPNOW_WIRE_TYPE_PAIR_ACCEPT = 0x21,  ///< espnow_wire_pair_accept_t, receiver -> one sender
+} espnow_wire_type_t;
+
+/**
+ * @brief Versioned frame header
+ */
+typedef struct {
+    uint8_t  magic;         ///< ESPNOW_WIRE_MAGIC
+    uint8_t  version;       ///< ESPNOW_WIRE_VERSION
+    uint8_t  type;          ///< espnow_wire_type_t
+    uint8_t  flags;         ///< Reserved, 0
+    uint16_t seq;           ///< Per-sender sequence number
+    uint16_t tx_delta_us;   ///< Sender time since previous frame, saturates at 0xFFFF
+} __attribute__((packed)) espnow_wire_header_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_CLUTCH payload (same layout as the legacy frame)
+ */
+typedef struct {
+    uint16_t left_clutch;   ///< 12-bit ADC value 0-4095
+    uint16_t right_clutch;  ///< 12-bit ADC value 0-4095
+} __attribute__((packed)) espnow_wire_clutch_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_CHANNEL payload: move to another channel
+ *
+ * Broadcast by the receiver, repeated a few times with switch_in_ms
+ * counting down to the same instant. A sender moves to `channel` when
+ * switch_in_ms expires (immediately if 0) and ignores repeats with an
+ * epoch it has already applied. A sender whose frames have not been
+ * acknowledged for a while returns to `rendezvous`, where the receiver
+ * visits periodically and announces its channel again with
+ * switch_in_ms = 0.
+ */
+typedef struct {
+    uint8_t  channel;       ///< Channel to move to (1-14)
+    uint8_t  rendezvous;    ///< Fallback channel after loss of contact
+    uint16_t switch_in_ms;  ///< Delay before moving
+    uint16_t epoch;         ///< Incremented on every channel change
+} __attribute__((packed)) espnow_wire_channel_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_RATE payload: transmit rate feedback
+ *
+ * Unicast to each sequenced sender when its wanted rate changes and at
+ * least every CONFIG_CLUTCH_RATE_REFRESH_MS. The sender transmits at
+ * rate_hz. When its value changes while it runs slower than burst_hz it
+ * sends at once and uses burst_hz until the next feedback, so leaving
+ * idle costs no round trip. Without feedback for three refresh periods
+ * it returns to its built-in rate.
+ */
+typedef struct {
+    uint16_t rate_hz;       ///< Wanted transmit rate
+    uint16_t burst_hz;      ///< Rate to use at once on a local change
+    uint16_t loss_permille; ///< Loss seen by the receiver over the last window
+    int8_t   rssi_dbm;      ///< RSSI average seen by the receiver
+    uint8_t  reserved;      ///< 0
+} __attribute__((packed)) espnow_wire_rate_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_PING / ESPNOW_WIRE_TYPE_PONG payload
+ *
+ * A sender answers every PING at once with a PONG carrying the same
+ * payload, over the same (encrypted or plain) link, so the receiver can
+ * measure the round trip.
+ */
+typedef struct {
+    uint32_t t_us;          ///< Receiver esp_timer time of the PING, low 32 bits
+} __attribute__((packed)) espnow_wire_ping_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_PAIR_REQUEST payload
+ *
+ * Pairing (see pairing.h): while the receiver's pairing window is open, a
+ * sender close to it broadcasts this request unencrypted. Both sides then
+ * derive the peer's local master key as the first 16 bytes of
+ *   HMAC-SHA256(key = PMK, msg = sender MAC || receiver STA MAC)
+ * with the PMK both were built with, and the receiver answers with an
+ * encrypted PAIR_ACCEPT. A sender that can decrypt it is paired; every
+ * later frame in both directions is encrypted.
+ */
+typedef struct {
+    uint32_t field_mask;    ///< SENDER_FIELD_* bits the sender wants to feed
+} __attribute__((packed)) espnow_wire_pair_request_t;
+
+/**
+ * @brief ESPNOW_WIRE_TYPE_PAIR_ACCEPT payload
+ */
+typedef struct {
+    uint32_t field_mask;    ///< Fields the receiver mapped the sender to
+    uint8_t  channel;       ///< Current home channel
+    uint8_t  rendezvous;    ///< Fallback channel after loss of contact
+} __attribute__((packed)) espnow_wire_pair_accept_t;
+
+_Static_assert(sizeof(espnow_wire_header_t) == 8, "wire header must be 8 bytes");
+_Static_assert(sizeof(espnow_wire_clutch_t) == ESPNOW_WIRE_LEGACY_CLUTCH_LEN,
+               "clutch payload must match the legacy frame");
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESPNOW_WIRE_H
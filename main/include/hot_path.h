@@ -0,0 +1,32 @@
+/**
+ * @file hot_path.h
+ * @brief Memory placement of the receive-to-report hot path
+ *
+ * With CONFIG_CLUTCH_LOW_JITTER, the application's functions on the path
+ * from espnow_recv_cb to tud_hid_report (and dlog_write, which they call)
+ * are marked HOT_PATH_FN and linked into IRAM, and the constant tables they
+ * read are marked HOT_PATH_DATA and kept in DRAM. linker.lf does the same
+ * for the TinyUSB device core and HID class. A flash cache miss (NVS
+ * writes, the web server) then stalls only the parts of the path left in
+ * flash: the WiFi/ESP-NOW driver beyond CONFIG_ESP_WIFI_RX_IRAM_OPT.
+ * Writable statics such as the calibration LUTs and the rings are in
+ * internal DRAM already.
+ *
+ * Without the profile both expand to nothing and the linker decides.
+ */
+
+#ifndef HOT_PATH_H
+#define HOT_PATH_H
+
+#include "esp_attr.h"
+#include "sdkconfig.h"
+
+#if CONFIG_CLUTCH_LOW_JITTER
+#define HOT_PATH_FN     IRAM_ATTR
+#define HOT_PATH_DATA   DRAM_ATTR
+#else
+#define HOT_PATH_FN
+#define HOT_PATH_DATA
+#endif
+
+#endif // HOT_PATH_H
@@ -0,0 +1,104 @@
+/**
+ * @file ingest.h
+ * @brief Lock-free ESP-NOW ingest ring and packet processing task
+ *
+ * The ESP-NOW receive callback runs in the WiFi driver task. To keep the
+ * radio's time budget free, the callback only copies the frame into a
+ * preallocated single-producer/single-consumer ring; a dedicated ingest
+ * task drains the ring and runs the data processor.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of slots in the ingest ring (power of two)
+ */
+#define INGEST_RING_SLOTS CONFIG_CLUTCH_INGEST_RING_SLOTS
+
+/**
+ * @brief Handler invoked from the ingest task for every queued frame
+ *
+ * @param mac_addr MAC address of the sender
+ * @param data Pointer to the frame payload (valid only during the call)
+ * @param len Length of the payload
+ * @param rssi Signal strength of the frame (dBm)
+ * @param rx_time_us esp_timer timestamp taken in espnow_recv_cb
+ */
+typedef void (*ingest_handler_t)(const uint8_t *mac_addr, const uint8_t *data,
+                                 int len, int8_t rssi, int64_t rx_time_us);
+
+/**
+ * @brief Ingest ring statistics
+ */
+typedef struct {
+    uint32_t queued;        ///< Frames accepted into the ring
+    uint32_t overflows;     ///< Frames dropped because the ring was full
+    uint32_t oversize;      ///< Frames dropped because they exceed a slot
+    uint32_t depth;         ///< Frames not yet handled, including the one in the handler
+    uint32_t high_water;    ///< Highest ring depth observed since boot
+    uint32_t capacity;      ///< Number of slots in the ring
+} ingest_stats_t;
+
+/**
+ * @brief Initialize the ingest ring
+ *
+ * @param handler Function run by the ingest task for each frame
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ingest_init(ingest_handler_t handler);
+
+/**
+ * @brief Queue a received frame (producer side, WiFi task context)
+ *
+ * Copies MAC, length, RSSI, timestamp and payload into the next free slot
+ * and wakes the ingest task. Never blocks.
+ *
+ * @param mac_addr MAC address of the sender
+ * @param data Pointer to received data
+ * @param len Length of received data
+ * @param rssi Signal strength of the frame (dBm)
+ * @param rx_time_us esp_timer timestamp taken in espnow_recv_cb
+ * @return true if queued, false if the frame was dropped
+ */
+bool ingest_push(const uint8_t *mac_addr, const uint8_t *data, int len,
+                 int8_t rssi, int64_t rx_time_us);
+
+/**
+ * @brief Get ingest ring statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void ingest_get_stats(ingest_stats_t *stats);
+
+/**
+ * @brief Wait until the frame the ingest task is handling, if any, is done
+ *
+ * Frames handled after the return look their sender up again, so state a
+ * caller has just unpublished (e.g. an unregistered sender) is no longer
+ * in use by the ingest task. Returns at once before task_ingest runs.
+ * Not from the ingest task itself.
+ */
+void ingest_sync(void);
+
+/**
+ * FreeRTOS task: drains the ingest ring and runs the registered handler.
+ * Pin to CONFIG_CLUTCH_INGEST_TASK_CORE (the non-WiFi core with
+ * CONFIG_CLUTCH_LOW_JITTER), priority CONFIG_CLUTCH_INGEST_TASK_PRIORITY.
+ */
+void task_ingest(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INGEST_H
@@ -0,0 +1,126 @@
+/**
+ * @file latency_stats.h
+ * @brief Per-stage RX-to-report latency histograms
+ *
+ * Timestamps are taken with esp_timer_get_time() at three points:
+ *   rx        — espnow_recv_cb (when the frame is queued in the ingest ring)
+ *   processed — after data_processor_process_espnow_data returns
+ *   reported  — when task_hid_reporter hands the report to tud_hid_report
+ *
+ * The axis filter adds its estimated group delay as a further stage, so
+ * it can be weighed against the transport stages. sample_age is the age
+ * of the newest sample merged into a report when that report is handed to
+ * USB, once per new snapshot; it is what report scheduling tunes against.
+ * ping_rtt is the radio round trip to a sender (pairing.h). clock_wake is
+ * what frequency scaling costs a packet arriving at the idle clock (power.h).
+ * report_jitter is how far consecutive changed reports drift from the
+ * bInterval grid; compare its p99 between builds with and without
+ * CONFIG_CLUTCH_LOW_JITTER (hot_path.h).
+ *
+ * Each stage feeds a fixed-bucket histogram. Every histogram has a single
+ * writer task, so recording is lock-free.
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Latency stages
+ */
+typedef enum {
+    LATENCY_STAGE_RX_TO_PROCESSED = 0,  ///< espnow_recv_cb -> processor done
+    LATENCY_STAGE_PROCESSED_TO_REPORT,  ///< processor done -> tud_hid_report
+    LATENCY_STAGE_RX_TO_REPORT,         ///< espnow_recv_cb -> tud_hid_report
+    LATENCY_STAGE_FILTER_DELAY,         ///< Group delay added by the axis filter (estimated)
+    LATENCY_STAGE_SAMPLE_AGE,           ///< Newest sample to report handed to USB
+    LATENCY_STAGE_PING_RTT,             ///< Receiver PING -> sender PONG round trip
+    LATENCY_STAGE_CLOCK_WAKE,           ///< Oldest packet of a batch at idle clock -> max clock held
+    LATENCY_STAGE_REPORT_JITTER,        ///< Changed-report spacing off the bInterval grid
+    LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+/**
+ * @brief Summary of one stage histogram
+ *
+ * Percentiles are reported as the upper bound of the bucket they fall in.
+ */
+typedef struct {
+    uint32_t count;     ///< Samples recorded
+    uint32_t p50_us;    ///< Median latency
+    uint32_t p99_us;    ///< 99th percentile latency
+    uint32_t max_us;    ///< Largest latency seen
+} latency_summary_t;
+
+/**
+ * @brief Record a sample directly into a stage histogram
+ *
+ * @param stage Stage to record into
+ * @param latency_us Latency in microseconds
+ */
+void latency_stats_record(latency_stage_t stage, uint32_t latency_us);
+
+/**
+ * @brief Mark a packet as processed (ingest task)
+ *
+ * Records RX_TO_PROCESSED and remembers the timestamps until the next
+ * HID report is sent.
+ *
+ * @param rx_time_us esp_timer timestamp taken at reception
+ */
+void latency_stats_mark_processed(int64_t rx_time_us);
+
+/**
+ * @brief Mark a HID report as queued (HID reporter task)
+ *
+ * Records PROCESSED_TO_REPORT and RX_TO_REPORT for the newest processed
+ * packet, if any. Packets that did not change the report are discarded so
+ * keep-alives do not inflate the numbers.
+ *
+ * @param new_data True if the report content differs from the previous one
+ */
+void latency_stats_mark_reported(bool new_data);
+
+/**
+ * @brief Get the summary of a stage
+ *
+ * @param stage Stage to summarize
+ * @param summary Pointer to store the summary
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t latency_stats_get(latency_stage_t stage, latency_summary_t *summary);
+
+/**
+ * @brief Human-readable stage name
+ */
+const char *latency_stats_stage_name(latency_stage_t stage);
+
+/**
+ * @brief Format all stage summaries as a JSON object (for the web endpoint)
+ *
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @return Number of characters written (excluding the terminator)
+ */
+int latency_stats_format_json(char *buf, size_t len);
+
+/**
+ * @brief Clear all histograms
+ *
+ * A sample recorded concurrently with the reset may be lost.
+ */
+void latency_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_STATS_H
@@ -0,0 +1,130 @@
+/**
+ * @file link_quality.h
+ * @brief Per-sender ESP-NOW link quality tracking
+ *
+ * Keeps one entry per sender registry slot with last RX time, an RSSI
+ * moving average, jitter and loss. Senders using the versioned wire format
+ * get exact loss, duplicate and reorder counts from sequence numbers;
+ * legacy senders get a packet-gap based loss estimate. Updated from the
+ * ingest task once per packet; read from any task (status, web config).
+ */
+
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Link quality of one sender
+ */
+typedef struct {
+    uint8_t  mac[6];            ///< Sender MAC address
+    int8_t   rssi_last;         ///< RSSI of the newest packet (dBm)
+    int8_t   rssi_avg;          ///< RSSI moving average (dBm)
+    int64_t  last_rx_us;        ///< esp_timer time of the newest packet
+    uint32_t packets;           ///< Packets accepted
+    uint32_t lost;              ///< Packets lost (sequence gaps, or estimated from arrival gaps)
+    uint32_t duplicates;        ///< Frames discarded as repeats of the last sequence number
+    uint32_t stale;             ///< Frames discarded as older than the last sequence number
+    uint32_t resyncs;           ///< Sequence jumps treated as a sender restart
+    uint32_t interval_us;       ///< Average inter-arrival time
+    uint32_t jitter_us;         ///< Jitter (RFC 3550 style; transit jitter when sequenced)
+    uint16_t loss_permille;     ///< lost / (packets + lost), in 1/1000
+    uint16_t last_seq;          ///< Newest accepted sequence number
+    bool     sequenced;         ///< Sender uses the versioned wire format
+} link_quality_entry_t;
+
+/**
+ * @brief Verdict for a sequenced frame
+ */
+typedef enum {
+    LINK_SEQ_ACCEPT = 0,        ///< Newer than anything seen, process it
+    LINK_SEQ_DUPLICATE,         ///< Same sequence number as the last frame
+    LINK_SEQ_STALE,             ///< Older than the last frame (late retry, reorder)
+} link_seq_verdict_t;
+
+/**
+ * @brief Update the table with a received legacy packet (ingest task)
+ *
+ * @param sender Sender registry slot (sender_registry_acquire)
+ * @param mac MAC address of the sender
+ * @param rssi RSSI of the packet in dBm
+ * @param rx_time_us esp_timer timestamp of the packet
+ */
+void link_quality_update(int sender, const uint8_t *mac, int8_t rssi, int64_t rx_time_us);
+
+/**
+ * @brief Update the table with a sequenced packet and classify it (ingest task)
+ *
+ * Only LINK_SEQ_ACCEPT frames may reach the axis outputs. Call it once the
+ * frame's type and payload are validated: an accepted seq becomes the
+ * reference for the next frames.
+ *
+ * @param sender Sender registry slot (sender_registry_acquire)
+ * @param mac MAC address of the sender
+ * @param rssi RSSI of the packet in dBm
+ * @param rx_time_us esp_timer timestamp of the packet
+ * @param seq Sequence number from the wire header
+ * @param tx_delta_us Sender time since its previous frame
+ * @return Verdict for the frame
+ */
+link_seq_verdict_t link_quality_update_seq(int sender, const uint8_t *mac, int8_t rssi,
+                                           int64_t rx_time_us, uint16_t seq,
+                                           uint16_t tx_delta_us);
+
+/**
+ * @brief Number of senders currently in the table
+ */
+size_t link_quality_count(void);
+
+/**
+ * @brief Copy a table entry by index (0 .. link_quality_count() - 1)
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the index is unused
+ */
+esp_err_t link_quality_get(size_t index, link_quality_entry_t *entry);
+
+/**
+ * @brief Copy the entry of a sender by MAC
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the sender is unknown
+ */
+esp_err_t link_quality_find(const uint8_t *mac, link_quality_entry_t *entry);
+
+/**
+ * @brief Accept the next sequenced frame of every sender as its first
+ *
+ * For a replayed capture (capture.h), whose sequence numbers are older
+ * than the last live frame. Counters are kept. Safe from any task: the
+ * restart is applied by the ingest task at its next sequenced frame, so
+ * call it once the live frames before the replay are processed.
+ */
+void link_quality_restart_sequences(void);
+
+/**
+ * @brief Drop the entry of an unregistered sender's slot
+ *
+ * Call once the ingest task no longer updates the slot (the sender
+ * registry's remove hook); a sender given the slot later starts afresh.
+ */
+void link_quality_forget(int sender);
+
+/**
+ * @brief Format the table as a JSON array (for the web endpoint)
+ *
+ * @return Number of characters written (excluding the terminator)
+ */
+int link_quality_format_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINK_QUALITY_H
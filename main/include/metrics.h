@@ -0,0 +1,131 @@
+/**
+ * @file metrics.h
+ * @brief Runtime health: 64-bit event counters and task/heap/ring gauges
+ *
+ * Counters are 64-bit atomics, so they are safe to bump from any task and
+ * do not wrap in the lifetime of the device (the 32-bit packet counters
+ * they replace wrapped after ~50 days at 1 kHz, bytes much sooner).
+ *
+ * Gauges are sampled by task_metrics once per CONFIG_CLUTCH_METRICS_SAMPLE_MS:
+ * stack high-water mark and CPU share of a fixed set of tasks (the data
+ * path, the WiFi task and both idle tasks, so a starved core shows up as
+ * an idle share near zero), heap free and minimum-ever, and ingest ring
+ * occupancy. CPU share needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS;
+ * without it the share reads as METRICS_CPU_UNKNOWN.
+ *
+ * The last sample is streamed as a TELEMETRY_FRAME_HEALTH frame
+ * (telemetry.h). metrics_format_json() formats counters and sample as
+ * JSON for the web endpoint; web_config.c does not serve it yet.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Event counters
+ */
+typedef enum {
+    METRIC_RX_PACKETS = 0,  ///< Packets handed to the data processor
+    METRIC_RX_BYTES,        ///< Bytes handed to the data processor
+    METRIC_RX_DISCARDED,    ///< Sequenced frames dropped as duplicate or stale
+    METRIC_RX_REJECTED,     ///< Packets from senders not admitted to the registry
+    METRIC_HID_REPORTS,     ///< Reports accepted by tud_hid_report()
+    METRIC_HID_BUSY,        ///< Report due while tud_hid_ready() was false
+    METRIC_COUNT
+} metric_id_t;
+
+/**
+ * @brief Tasks whose stack and CPU share are sampled
+ */
+typedef enum {
+    METRICS_TASK_INGEST = 0,
+    METRICS_TASK_CLUTCH,
+    METRICS_TASK_HID,
+    METRICS_TASK_WIFI,
+    METRICS_TASK_IDLE0,
+    METRICS_TASK_IDLE1,
+    METRICS_TASK_COUNT
+} metrics_task_id_t;
+
+#define METRICS_CPU_UNKNOWN     0xFFFF
+
+/**
+ * @brief Sampled state of one task
+ */
+typedef struct {
+    bool     found;             ///< Task exists
+    uint32_t stack_free_min;    ///< Stack high-water mark: least free, bytes
+    uint16_t cpu_permille;      ///< Share of one core over the last sample window
+} metrics_task_t;
+
+/**
+ * @brief Last health sample
+ */
+typedef struct {
+    int64_t  sampled_us;        ///< esp_timer time of the sample, 0 = none yet
+    metrics_task_t tasks[METRICS_TASK_COUNT];
+    uint32_t heap_free;         ///< Free heap bytes
+    uint32_t heap_min;          ///< Minimum free heap since boot
+    uint32_t ingest_depth;      ///< Frames waiting in the ingest ring
+    uint32_t ingest_high_water; ///< Highest ingest ring depth since boot
+    uint32_t ingest_capacity;   ///< Ingest ring slots
+} metrics_health_t;
+
+/**
+ * @brief Add to a counter; safe from any task, never blocks
+ */
+void metrics_add(metric_id_t id, uint64_t n);
+
+/**
+ * @brief Read a counter
+ */
+uint64_t metrics_get(metric_id_t id);
+
+/**
+ * @brief Overwrite a counter (for benchmarks that must leave it untouched)
+ */
+void metrics_set(metric_id_t id, uint64_t value);
+
+/**
+ * @brief Name of a counter, as used in the JSON output
+ */
+const char *metrics_name(metric_id_t id);
+
+/**
+ * @brief Name of a sampled task (its FreeRTOS task name)
+ */
+const char *metrics_task_name(metrics_task_id_t id);
+
+/**
+ * @brief Copy the last health sample
+ */
+void metrics_get_health(metrics_health_t *health);
+
+/**
+ * @brief Format counters and the last health sample as a JSON object
+ *        (for the web endpoint; not registered with the HTTP server yet)
+ *
+ * @return Number of characters written (excluding the terminator)
+ */
+int metrics_format_json(char *buf, size_t len);
+
+/**
+ * FreeRTOS task: samples the gauges and emits the telemetry frame.
+ * Priority 1 (it measures the others), stack 3072.
+ */
+void task_metrics(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
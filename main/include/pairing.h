@@ -0,0 +1,126 @@
+/**
+ * @file pairing.h
+ * @brief Sender pairing, per-peer ESP-NOW encryption and RTT probes
+ *
+ * Paired senders are stored in NVS with their local master key and field
+ * mapping, and re-added as encrypted ESP-NOW peers at boot, so frames
+ * to and from them are encrypted and authenticated by the WiFi hardware
+ * (CCMP) with CONFIG_CLUTCH_ESPNOW_PMK. The key derivation and the
+ * PAIR_REQUEST / PAIR_ACCEPT exchange are described in espnow_wire.h.
+ *
+ * New senders pair while the pairing window is open: at boot while
+ * nothing is paired (CONFIG_CLUTCH_PAIRING_OPEN_AT_BOOT), or on request
+ * over the HID Feature report. Only requests received above
+ * CONFIG_CLUTCH_PAIRING_MIN_RSSI are accepted, so the sender has to be
+ * next to the receiver.
+ *
+ * Without CONFIG_CLUTCH_SENDER_AUTO_REGISTER, frames from senders that
+ * are neither paired nor registered are refused in the receive callback,
+ * before they reach the ingest ring.
+ *
+ * With CONFIG_CLUTCH_PING_INTERVAL_MS every sequenced sender is pinged
+ * and the round trip is recorded as the ping_rtt latency stage; compare
+ * builds with and without CONFIG_CLUTCH_ESPNOW_ENCRYPT to see what the
+ * hardware encryption costs.
+ */
+
+#ifndef PAIRING_H
+#define PAIRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Paired senders (limited by the hardware key slots) */
+#define PAIRING_MAX_PEERS CONFIG_ESP_WIFI_ESPNOW_MAX_ENCRYPT_NUM
+
+/**
+ * @brief Load the paired senders and add them as peers
+ *
+ * Call after espnow_handler_init() and sender_registry_init(), before the
+ * ESP-NOW receive callback is registered.
+ */
+esp_err_t pairing_init(void);
+
+/**
+ * @brief Decide whether a received frame may enter the ingest ring
+ *
+ * Called from the WiFi task for every frame; lock-free. Counts refusals.
+ *
+ * @return true for registered senders and for pairing requests while the
+ *         window is open (always true with auto-registration)
+ */
+bool pairing_admit(const uint8_t *mac_addr, const uint8_t *data, int len);
+
+/**
+ * @brief Whether a frame is a pairing request
+ */
+bool pairing_is_request(const uint8_t *data, int len);
+
+/**
+ * @brief Handle a pairing request (ingest task)
+ *
+ * Validates it and hands it to the pairing task; never blocks.
+ */
+void pairing_handle_request(const uint8_t *mac_addr, const uint8_t *data, int len,
+                            int8_t rssi);
+
+/**
+ * @brief Open the pairing window
+ *
+ * @param window_s Seconds to stay open, 0 for CONFIG_CLUTCH_PAIRING_WINDOW_S
+ */
+void pairing_open(uint32_t window_s);
+
+/**
+ * @brief Close the pairing window
+ */
+void pairing_close(void);
+
+/**
+ * @brief Whether the pairing window is open
+ */
+bool pairing_is_open(void);
+
+/**
+ * @brief Request that every pairing is forgotten (done by the pairing task)
+ *
+ * Safe to call from any task. The peers lose their keys and are removed
+ * from the sender registry, so their frames are refused again.
+ */
+void pairing_request_forget(void);
+
+/**
+ * @brief Number of paired senders
+ */
+size_t pairing_count(void);
+
+/**
+ * @brief Frames refused by pairing_admit() since boot
+ */
+uint32_t pairing_get_refused_count(void);
+
+/**
+ * @brief Format the pairing state as a JSON object (for the web endpoint)
+ *
+ * @return Number of characters written (excluding the terminator)
+ */
+int pairing_format_json(char *buf, size_t len);
+
+/**
+ * FreeRTOS task: stores new pairings, closes the window, sends RTT pings.
+ * Start with pairing_init(); priority 2, stack 3072.
+ */
+void task_pairing(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAIRING_H
@@ -0,0 +1,90 @@
+/**
+ * @file power.h
+ * @brief Power/latency governor: CPU frequency scaling driven by activity
+ *
+ * With CONFIG_CLUTCH_POWER_MANAGEMENT (needs CONFIG_PM_ENABLE) the CPU
+ * runs at CONFIG_CLUTCH_POWER_IDLE_FREQ_MHZ while the rig is idle and only
+ * heartbeats arrive. The data path and the HID reporter call
+ * power_note_activity() when an axis moves or a changed report goes out;
+ * that takes an ESP_PM_CPU_FREQ_MAX lock, which the governor task drops
+ * again CONFIG_CLUTCH_POWER_ACTIVE_HOLD_MS after the last activity.
+ *
+ * Whether a packet moves an axis is only known once it is processed, so
+ * the ingest task also holds the lock around every batch it drains while
+ * the clock is down (power_ingest_begin/end): no packet is processed at
+ * the idle clock, and a batch of heartbeats lets it drop again at once.
+ *
+ * The cost of being idle-clocked is the time from the reception of the
+ * oldest packet in such a batch to the lock being held: it is recorded as
+ * the clock_wake latency stage. If a wake exceeds
+ * CONFIG_CLUTCH_POWER_WAKE_BUDGET_US CONFIG_CLUTCH_POWER_WAKE_STRIKES
+ * times, the governor pins the maximum frequency until restart, so
+ * scaling can never keep costing the first report after a paddle moves.
+ *
+ * Light sleep is not used: ESP-NOW reception with WIFI_PS_NONE and the
+ * USB-OTG device both keep the chip awake, and modem sleep would delay
+ * frames by a beacon interval.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Configure frequency scaling and hold the maximum clock
+ *
+ * The boot work (benchmarks, first enumeration) runs at full speed; the
+ * governor task releases the clock once the rig is idle.
+ */
+esp_err_t power_init(void);
+
+/**
+ * @brief Note activity: hold the maximum CPU clock for the hold time
+ *        (any task, never blocks)
+ */
+void power_note_activity(void);
+
+/**
+ * @brief Hold the maximum CPU clock while the ingest task drains a batch
+ *        (ingest task only, before the first frame is processed)
+ *
+ * Does nothing while the clock is already held for activity.
+ *
+ * @param rx_time_us Reception time of the oldest frame, to measure the wake
+ */
+void power_ingest_begin(int64_t rx_time_us);
+
+/**
+ * @brief Release the hold taken by power_ingest_begin() (ingest task only)
+ */
+void power_ingest_end(void);
+
+/**
+ * @brief Whether the maximum clock is currently held (always true without
+ *        CONFIG_CLUTCH_POWER_MANAGEMENT)
+ */
+bool power_is_active(void);
+
+/**
+ * @brief Whether scaling was given up because wakes exceeded the budget
+ */
+bool power_is_pinned(void);
+
+/**
+ * FreeRTOS task: releases the clock after the idle hold time.
+ * Priority 1, stack 2048. Only with CONFIG_CLUTCH_POWER_MANAGEMENT.
+ */
+void task_power(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_H
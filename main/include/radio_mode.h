@@ -0,0 +1,68 @@
+/**
+ * @file radio_mode.h
+ * @brief Config mode (SoftAP + HTTP server) versus radio-only race mode
+ *
+ * In config mode WiFi runs APSTA so the web configuration AP coexists
+ * with ESP-NOW. In race mode only the STA interface is started: no AP
+ * beacons compete with ESP-NOW for airtime, and neither the AP netif,
+ * DHCP server nor HTTP server are created, which leaves their heap free.
+ *
+ * The mode is stored in NVS and applied at boot. Switching saves the new
+ * mode and restarts the receiver — with CONFIG_CLUTCH_BOOT_USB_FIRST the
+ * gamepad re-enumerates within tens of ms. Switch with a long press of
+ * CONFIG_CLUTCH_MODE_BUTTON_GPIO, the USB_HID_CMD_RADIO_MODE Feature
+ * report, or radio_mode_request() (e.g. from the web UI).
+ */
+
+#ifndef RADIO_MODE_H
+#define RADIO_MODE_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    RADIO_MODE_CONFIG = 0,  ///< APSTA, web configuration available
+    RADIO_MODE_RACE,        ///< STA only, ESP-NOW only
+    RADIO_MODE_COUNT
+} radio_mode_t;
+
+/**
+ * @brief Load the stored mode; call after NVS is initialized
+ *
+ * @return ESP_OK (a missing or invalid record selects config mode)
+ */
+esp_err_t radio_mode_init(void);
+
+/**
+ * @brief Mode the receiver booted in
+ */
+radio_mode_t radio_mode_get(void);
+
+/**
+ * @brief Human-readable mode name
+ */
+const char *radio_mode_name(radio_mode_t mode);
+
+/**
+ * @brief Switch mode: save it and restart
+ *
+ * Non-blocking, safe from any task; the switch is carried out by
+ * task_radio_mode. Requesting the current mode does nothing.
+ */
+esp_err_t radio_mode_request(radio_mode_t mode);
+
+/**
+ * FreeRTOS task: watches the mode button and carries out switch
+ * requests. Low priority, stack 3072.
+ */
+void task_radio_mode(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RADIO_MODE_H
@@ -0,0 +1,53 @@
+/**
+ * @file rate_control.h
+ * @brief Adaptive transmit rate feedback to the senders
+ *
+ * The receiver tells every sequenced sender how fast to transmit with
+ * ESPNOW_WIRE_TYPE_RATE frames (espnow_wire.h). A sender whose outputs
+ * changed within CONFIG_CLUTCH_RATE_IDLE_AFTER_MS is asked for its
+ * congestion cap, up to CONFIG_CLUTCH_RATE_ACTIVE_HZ; an idle sender only
+ * for CONFIG_CLUTCH_RATE_IDLE_HZ heartbeats. The cap is halved after a
+ * window with loss above CONFIG_CLUTCH_RATE_BACKOFF_LOSS_PERMILLE and
+ * grows back by a quarter per clean window, so senders sharing a busy
+ * channel back off together.
+ *
+ * Legacy senders cannot parse receiver frames and get no feedback.
+ */
+
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Record that a sender's outputs changed (ingest task)
+ *
+ * @param sender Sender registry slot
+ * @param rx_time_us RX time of the packet that changed them
+ */
+void rate_control_note_change(int sender, int64_t rx_time_us);
+
+/**
+ * @brief Format the per-sender rates as a JSON array (for the web endpoint)
+ *
+ * @return Number of characters written (excluding the terminator)
+ */
+int rate_control_format_json(char *buf, size_t len);
+
+/**
+ * FreeRTOS task: evaluates every sender each window and sends the rate
+ * feedback. Start after espnow_handler_init(); pin to core 0, priority 3,
+ * stack 3072.
+ */
+void task_rate_control(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_CONTROL_H
@@ -0,0 +1,191 @@
+/**
+ * @file sender_registry.h
+ * @brief Registry of ESP-NOW senders merged into one HID report
+ *
+ * Each transmitter (paddles, handbrake, button box, ...) is identified by
+ * its MAC and mapped to the report fields it feeds. The table is a
+ * fixed-capacity open-addressed hash (no heap), so the receive path stays
+ * O(1) per packet as senders are added. The HID reporter merges the latest
+ * state of every sender once per report.
+ *
+ * Concurrency: inserts and removals are serialized and published with
+ * release ordering, so lookups are lock-free. A removed entry stays in
+ * the table as a tombstone until a sender, the same or a new one, is
+ * registered into it. Sender state
+ * is written by the ingest task only and handed to the HID reporter as
+ * whole snapshots (sender_registry_publish), wait-free on both sides.
+ */
+
+#ifndef SENDER_REGISTRY_H
+#define SENDER_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "usb_comm.h"
+#include "axis_predictor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Table capacity (power of two); at most 3/4 of it holds senders
+ */
+#define SENDER_REGISTRY_CAPACITY CONFIG_CLUTCH_SENDER_REGISTRY_CAPACITY
+
+/**
+ * @brief Report fields a sender can feed (bitmask)
+ *
+ * Typical mappings:
+ *   paddles    : SENDER_FIELD_LEFT_CLUTCH | SENDER_FIELD_RIGHT_CLUTCH
+ *   handbrake  : SENDER_FIELD_AUX(0)
+ *   button box : SENDER_FIELD_BUTTONS
+ */
+#define SENDER_FIELD_LEFT_CLUTCH    (1u << 0)   ///< Left paddle -> g_left_clutch_pressed
+#define SENDER_FIELD_RIGHT_CLUTCH   (1u << 1)   ///< Right paddle -> X axis
+#define SENDER_FIELD_AUX(n)         (1u << (2 + (n)))   ///< Z, Rx, Ry, Rz
+#define SENDER_FIELD_BUTTONS        (1u << (2 + USB_HID_AUX_AXIS_COUNT))
+#define SENDER_FIELDS_ALL           ((SENDER_FIELD_BUTTONS << 1) - 1)
+
+/**
+ * @brief Latest processed state of one sender (16-bit scaled axes)
+ */
+typedef struct {
+    uint16_t right_clutch;                  ///< X axis
+    axis_motion_t right_motion;             ///< Right clutch motion for dead reckoning
+    uint16_t aux[USB_HID_AUX_AXIS_COUNT];   ///< Z, Rx, Ry, Rz
+    uint32_t buttons;                       ///< Buttons 1-32
+    bool     left_pressed;                  ///< Left paddle past the threshold
+    int64_t  rx_time_us;                    ///< RX time of the newest accepted packet
+    uint32_t version;                       ///< Snapshots published (sum over senders when merged)
+} sender_state_t;
+
+/**
+ * @brief Public view of a registry entry
+ */
+typedef struct {
+    uint8_t  mac[6];        ///< Sender MAC address
+    uint32_t field_mask;    ///< SENDER_FIELD_* bits this sender feeds
+    bool     auto_added;    ///< Added on first packet rather than configured
+} sender_info_t;
+
+/**
+ * @brief Initialize the registry (empty table)
+ */
+esp_err_t sender_registry_init(void);
+
+/**
+ * @brief Register a sender or change its field mapping
+ *
+ * @param mac MAC address of the sender
+ * @param field_mask SENDER_FIELD_* bits the sender feeds
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the table is full or the
+ *         sender is still being removed
+ */
+esp_err_t sender_registry_register(const uint8_t *mac, uint32_t field_mask);
+
+/**
+ * @brief Remove a sender: it is no longer found, merged or listed
+ *
+ * Runs the remove hook, then publishes an empty state for the slot, which
+ * the next sender registered along the slot's probe chain reuses. May
+ * block while the hook runs. Not from the ingest task.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if not registered
+ */
+esp_err_t sender_registry_unregister(const uint8_t *mac);
+
+/**
+ * @brief Called by sender_registry_unregister() with the removed slot
+ *
+ * Lookups no longer return the slot when it runs, and the slot cannot be
+ * registered again until it returns. Clears state kept per slot elsewhere
+ * and returns once the ingest task no longer uses the slot (the registry
+ * then resets the slot's working state).
+ */
+typedef void (*sender_registry_remove_hook_t)(int slot);
+
+/**
+ * @brief Set the remove hook (one; the data processor's)
+ */
+void sender_registry_set_remove_hook(sender_registry_remove_hook_t hook);
+
+/**
+ * @brief Find a sender
+ *
+ * @return Slot index, or -1 if unknown or unregistered
+ */
+int sender_registry_lookup(const uint8_t *mac);
+
+/**
+ * @brief Find a sender, adding it with the default mapping if allowed
+ *        (CONFIG_CLUTCH_SENDER_AUTO_REGISTER). Called from the ingest task.
+ *
+ * @return Slot index, or -1 if unknown and not added
+ */
+int sender_registry_acquire(const uint8_t *mac);
+
+/**
+ * @brief Field mask of a slot
+ */
+uint32_t sender_registry_field_mask(int slot);
+
+/**
+ * @brief Working state of a slot (ingest task only)
+ *
+ * Changes are invisible to the HID reporter until sender_registry_publish().
+ */
+sender_state_t *sender_registry_state(int slot);
+
+/**
+ * @brief Publish the working state of a slot as one snapshot
+ *
+ * Ingest task only, once per processed packet. Wait-free.
+ */
+void sender_registry_publish(int slot);
+
+/**
+ * @brief Merge the latest snapshot of every sender into one state
+ *
+ * Single reader: call from the HID reporter only (it owns the front
+ * buffer of every slot). Wait-free.
+ *
+ * For each field only senders mapped to it contribute: axes take the
+ * largest value, buttons and the left paddle are OR-ed, rx_time_us is
+ * the newest. With CONFIG_CLUTCH_AXIS_PREDICTOR the right clutch of a
+ * sender whose next packet is late is extrapolated to now_us.
+ *
+ * @param merged Output state
+ * @param now_us Report time (esp_timer time)
+ */
+void sender_registry_merge(sender_state_t *merged, int64_t now_us);
+
+/**
+ * @brief Largest working right clutch of the senders mapped to it
+ *
+ * The clutch engine's input, merged like sender_registry_merge() but from
+ * the working state, without prediction. Ingest task only, or after
+ * ingest_sync().
+ */
+uint16_t sender_registry_max_right_clutch(void);
+
+/**
+ * @brief Number of registered senders
+ */
+size_t sender_registry_count(void);
+
+/**
+ * @brief Get a registered sender by position (0 .. count - 1)
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if out of range
+ */
+esp_err_t sender_registry_get(size_t index, sender_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENDER_REGISTRY_H
@@ -0,0 +1,204 @@
+/**
+ * @file telemetry.h
+ * @brief Binary telemetry stream over a USB CDC interface
+ *
+ * With CONFIG_CLUTCH_USB_TELEMETRY the device is composite: the gamepad
+ * HID interface plus a CDC-ACM interface that streams compact binary
+ * frames while a host has the port open (DTR set). The baud rate is
+ * ignored. Nothing is formatted on the device; decode on the PC.
+ *
+ * Every frame is
+ *
+ *   byte 0      TELEMETRY_SYNC
+ *   byte 1      type         telemetry_frame_type_t
+ *   byte 2      len          payload length
+ *   byte 3      seq          frame counter, wraps at 255 (gaps = drops)
+ *   byte 4..    payload      len bytes, little-endian fields
+ *   last byte   checksum     XOR of bytes 1 .. 3+len
+ *
+ * A decoder resynchronizes by scanning for TELEMETRY_SYNC and checking
+ * the checksum. Payload structs may grow at the end; decoders use len.
+ * Times are esp_timer microseconds, low 32 bits.
+ *
+ * Frames are queued into a RAM ring by the packet path (no blocking, no
+ * formatting) and drained to the CDC endpoint by task_telemetry. When
+ * the ring is full new frames are dropped and counted; the STATUS frame
+ * reports the count.
+ *
+ * telemetry_request_capture_dump() sends the stopped capture (capture.h)
+ * as CAPTURE frames, in the free half of the ring so the live frames keep
+ * flowing. A frame without data ends the dump.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_SYNC          0xA7
+
+/**
+ * @brief Frame types
+ */
+typedef enum {
+    TELEMETRY_FRAME_SAMPLE = 0x01,  ///< telemetry_sample_t, every processed clutch sample
+    TELEMETRY_FRAME_REPORT = 0x02,  ///< telemetry_report_t, every HID report with new data
+    TELEMETRY_FRAME_LINK   = 0x03,  ///< telemetry_link_t, per sender once a second
+    TELEMETRY_FRAME_STATUS = 0x04,  ///< telemetry_status_t, once a second
+    TELEMETRY_FRAME_HEALTH = 0x05,  ///< telemetry_health_t, every metrics sample (metrics.h)
+    TELEMETRY_FRAME_CAPTURE = 0x06, ///< telemetry_capture_t, while a capture dump runs
+} telemetry_frame_type_t;
+
+/** telemetry_sample_t.flags */
+#define TELEMETRY_SAMPLE_SEQUENCED      (1u << 0)   ///< seq is valid (versioned wire format)
+#define TELEMETRY_SAMPLE_LEFT_PRESSED   (1u << 1)   ///< Left paddle past its threshold
+#define TELEMETRY_SAMPLE_CHANGED        (1u << 2)   ///< A report axis changed
+
+/**
+ * @brief TELEMETRY_FRAME_SAMPLE payload
+ */
+typedef struct {
+    uint32_t rx_time_us;    ///< ESP-NOW receive callback time
+    uint16_t proc_us;       ///< Receive callback -> processed (saturating)
+    uint16_t seq;           ///< Sender sequence number
+    uint16_t left_raw;      ///< 12-bit left clutch as received
+    uint16_t right_raw;     ///< 12-bit right clutch as received
+    uint16_t left_out;      ///< Left clutch after calibration and shaping (16-bit)
+    uint16_t right_out;     ///< Right clutch axis value, after the filter (16-bit)
+    uint8_t  sender;        ///< Sender registry slot
+    int8_t   rssi;          ///< RSSI (dBm)
+    uint8_t  flags;         ///< TELEMETRY_SAMPLE_*
+} __attribute__((packed)) telemetry_sample_t;
+
+/**
+ * @brief TELEMETRY_FRAME_REPORT payload
+ */
+typedef struct {
+    uint32_t t_us;          ///< Handed to tud_hid_report()
+    uint32_t sample_rx_us;  ///< rx_time_us of the newest sample in the report
+    uint16_t right_clutch;  ///< X axis
+    uint16_t virtual_clutch;///< Y axis
+    uint32_t buttons;       ///< Buttons 1-32
+} __attribute__((packed)) telemetry_report_t;
+
+/**
+ * @brief TELEMETRY_FRAME_LINK payload
+ */
+typedef struct {
+    uint8_t  mac[6];        ///< Sender MAC address
+    int8_t   rssi_avg;      ///< RSSI moving average (dBm)
+    uint8_t  reserved;
+    uint32_t packets;       ///< Packets accepted
+    uint32_t lost;          ///< Packets lost
+    uint32_t interval_us;   ///< Average inter-arrival time
+    uint32_t jitter_us;     ///< Jitter
+    uint16_t loss_permille; ///< Loss, in 1/1000
+} __attribute__((packed)) telemetry_link_t;
+
+/**
+ * @brief TELEMETRY_FRAME_STATUS payload
+ */
+typedef struct {
+    uint32_t t_us;          ///< Time of the status
+    uint32_t dropped;       ///< Telemetry frames dropped because the ring was full
+    uint32_t ingest_overflows; ///< ESP-NOW frames dropped by the ingest ring
+    uint32_t discarded;     ///< Duplicate/stale frames discarded by the processor
+    uint32_t free_heap;     ///< Free heap bytes
+} __attribute__((packed)) telemetry_status_t;
+
+/** Tasks in telemetry_health_t, in metrics_task_id_t order:
+ *  ingest, clutch, hid, wifi, IDLE0, IDLE1 */
+#define TELEMETRY_HEALTH_TASKS  6
+
+/**
+ * @brief TELEMETRY_FRAME_HEALTH payload
+ */
+typedef struct {
+    uint32_t t_us;          ///< Time of the sample
+    uint32_t heap_free;     ///< Free heap bytes
+    uint32_t heap_min;      ///< Minimum free heap since boot
+    uint16_t ingest_depth;  ///< Frames waiting in the ingest ring
+    uint16_t ingest_high_water; ///< Highest ingest ring depth since boot
+    uint64_t hid_reports;   ///< Reports accepted by tud_hid_report()
+    uint64_t hid_busy;      ///< Reports due while the IN endpoint was busy
+    struct {
+        uint16_t stack_free_min;    ///< Stack high-water mark, bytes (saturating)
+        uint16_t cpu_permille;      ///< Share of one core, 0xFFFF = unknown
+    } __attribute__((packed)) tasks[TELEMETRY_HEALTH_TASKS];
+} __attribute__((packed)) telemetry_health_t;
+
+/** Capture bytes per TELEMETRY_FRAME_CAPTURE */
+#define TELEMETRY_CAPTURE_CHUNK 240
+
+/**
+ * @brief TELEMETRY_FRAME_CAPTURE payload
+ *
+ * Written in order, the chunks are the capture_read() stream: records
+ * oldest first, each a capture_record_t and its payload.
+ */
+typedef struct {
+    uint32_t offset;        ///< Offset of data in the stream; the total in the last frame
+    uint8_t  data[TELEMETRY_CAPTURE_CHUNK]; ///< len - 4 bytes, none in the last frame
+} __attribute__((packed)) telemetry_capture_t;
+
+/**
+ * @brief Set up the telemetry ring
+ *
+ * Call before usb_comm_init(); the CDC interface is part of its
+ * configuration descriptor.
+ */
+esp_err_t telemetry_init(void);
+
+/**
+ * @brief Whether a host has the telemetry port open
+ *
+ * Producers may skip building frames while this is false.
+ */
+bool telemetry_is_active(void);
+
+/**
+ * @brief Queue one frame; never blocks
+ *
+ * Safe from any task. Dropped (and counted) while the ring is full, and
+ * dropped silently while no host has the port open.
+ */
+void telemetry_emit(telemetry_frame_type_t type, const void *payload, uint8_t len);
+
+/**
+ * @brief Frames dropped since boot because the ring was full
+ */
+uint32_t telemetry_get_dropped_count(void);
+
+/**
+ * @brief Ask task_telemetry to send the stopped capture as CAPTURE frames
+ *
+ * Non-blocking, safe from any task. The dump starts once a host has the
+ * port open, and ends early (short total) if the capture starts again.
+ *
+ * @return ESP_OK if posted, ESP_ERR_NOT_SUPPORTED without telemetry or a
+ *         capture ring
+ */
+esp_err_t telemetry_request_capture_dump(void);
+
+/**
+ * @brief Whether a capture dump is requested or running
+ */
+bool telemetry_capture_dump_active(void);
+
+/**
+ * FreeRTOS task: drains the ring to the CDC endpoint and adds the
+ * periodic LINK/STATUS frames. Core 0, priority 2, stack 3072.
+ */
+void task_telemetry(void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_H
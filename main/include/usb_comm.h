@@ -9,25 +9,139 @@
 extern "C" {
 #endif
 
+/*
+ * Report layout table — the single source for both the packed report
+ * struct below and the HID report descriptor in usb_comm.c, so the two
+ * cannot drift apart. All axes are 16-bit (0-65535), in report order.
+ *
+ *   X(field, ID, HID usage)
+ */
+#define USB_HID_AXES(X)                                                   \
+    X(right_clutch,   RIGHT_CLUTCH,   0x30)   /* X  — right clutch paddle */ \
+    X(virtual_clutch, VIRTUAL_CLUTCH, 0x31)   /* Y  — virtual clutch engine */ \
+    X(aux_z,          AUX_Z,          0x32)   /* Z  — sim racing axis_x */   \
+    X(aux_rx,         AUX_RX,         0x33)   /* Rx — sim racing axis_y */   \
+    X(aux_ry,         AUX_RY,         0x34)   /* Ry — sim racing axis_z */   \
+    X(aux_rz,         AUX_RZ,         0x35)   /* Rz — sim racing axis_rx */
+
+/** Number of buttons (bits, button 1 = bit 0), padded to the field size */
+#define USB_HID_BUTTON_COUNT 32
+
+#define USB_HID_AXIS_ENUM(field, id, usage) USB_HID_AXIS_##id,
+typedef enum {
+    USB_HID_AXES(USB_HID_AXIS_ENUM)
+    USB_HID_AXIS_COUNT
+} usb_hid_axis_t;
+#undef USB_HID_AXIS_ENUM
+
+/** Auxiliary axes (Z, Rx, Ry, Rz) fed by sim racing frames — contiguous */
+#define USB_HID_AUX_AXIS_FIRST USB_HID_AXIS_AUX_Z
+#define USB_HID_AUX_AXIS_COUNT (USB_HID_AXIS_AUX_RZ - USB_HID_AXIS_AUX_Z + 1)
+
+/* Width of the buttons field in bits, visible to the preprocessor so the
+ * report descriptor can tell whether it needs padding */
+#if USB_HID_BUTTON_COUNT <= 8
+typedef uint8_t usb_hid_buttons_t;
+#define USB_HID_BUTTON_BITS 8
+#elif USB_HID_BUTTON_COUNT <= 16
+typedef uint16_t usb_hid_buttons_t;
+#define USB_HID_BUTTON_BITS 16
+#elif USB_HID_BUTTON_COUNT <= 32
+typedef uint32_t usb_hid_buttons_t;
+#define USB_HID_BUTTON_BITS 32
+#else
+#error "USB_HID_BUTTON_COUNT above 32 needs a wider buttons field"
+#endif
+_Static_assert(sizeof(usb_hid_buttons_t) * 8 == USB_HID_BUTTON_BITS,
+               "USB_HID_BUTTON_BITS must match usb_hid_buttons_t");
+
 /**
- * HID gamepad report — 2 analog axes (4 bytes):
- *   right_clutch   : X axis  — right clutch paddle (0-65535)
- *   virtual_clutch : Y axis  — virtual clutch engine output (0-65535)
+ * HID gamepad report generated from USB_HID_AXES. Axes are reachable by
+ * name (report.right_clutch) or by index (report.axes[USB_HID_AXIS_*]).
  */
+#define USB_HID_AXIS_FIELD(field, id, usage) uint16_t field;
 typedef struct {
-    uint16_t right_clutch;    ///< X axis: right clutch paddle
-    uint16_t virtual_clutch;  ///< Y axis: virtual clutch engine
+    union {
+        struct __attribute__((packed)) {
+            USB_HID_AXES(USB_HID_AXIS_FIELD)
+        };
+        uint16_t axes[USB_HID_AXIS_COUNT];
+    };
+    usb_hid_buttons_t buttons;              ///< Buttons 1-USB_HID_BUTTON_COUNT
 } __attribute__((packed)) usb_hid_gamepad_report_t;
+#undef USB_HID_AXIS_FIELD
+
+_Static_assert(sizeof(usb_hid_gamepad_report_t) ==
+               USB_HID_AXIS_COUNT * sizeof(uint16_t) + sizeof(usb_hid_buttons_t),
+               "report struct must match the layout table");
+/* Full-speed interrupt endpoints carry at most 64 bytes per transaction */
+_Static_assert(sizeof(usb_hid_gamepad_report_t) <= 64,
+               "report must fit one full-speed transaction");
+
+/**
+ * Host commands carried in the vendor Feature report (SET_REPORT to send,
+ * GET_REPORT to read the receiver's current value for the last command).
+ */
+typedef enum {
+    USB_HID_CMD_NONE       = 0,
+    USB_HID_CMD_RADIO_MODE = 1,     ///< value: radio_mode_t
+    USB_HID_CMD_PAIRING    = 2,     ///< set: window in s, 0 closes; get: 1 while open
+    USB_HID_CMD_UNPAIR_ALL = 3,     ///< set: forget every pairing; get: paired count
+    USB_HID_CMD_CAPTURE    = 4,     ///< value: capture_state_t (set 0 stops)
+    USB_HID_CMD_CAPTURE_DUMP = 5,   ///< set: send the capture over telemetry; get: 1 while sending
+} usb_hid_command_t;
+
+/** Vendor Feature report, the host-side control channel */
+typedef struct __attribute__((packed)) {
+    uint8_t command;                ///< usb_hid_command_t
+    uint8_t value;
+} usb_hid_feature_report_t;
+
+/**
+ * Feature report handlers, called from the TinyUSB task; must not block.
+ * get fills report->value for report->command (preset to the last
+ * command set, or USB_HID_CMD_NONE).
+ */
+typedef void (*usb_feature_set_cb_t)(const usb_hid_feature_report_t *report);
+typedef void (*usb_feature_get_cb_t)(usb_hid_feature_report_t *report);
+
+/** Install the Feature report handlers. Either may be NULL. */
+void usb_comm_set_feature_handler(usb_feature_set_cb_t set_cb,
+                                  usb_feature_get_cb_t get_cb);
 
 /** Initialize TinyUSB HID device. Call once before spawning tasks. */
 esp_err_t usb_comm_init(void);
 
+/**
+ * Set the HID endpoint polling interval (bInterval) in ms, 1 ms = 1 kHz.
+ * Must be called before usb_comm_init(); defaults to
+ * CONFIG_CLUTCH_HID_POLL_INTERVAL_MS.
+ */
+esp_err_t usb_comm_set_poll_interval_ms(uint8_t interval_ms);
+
+/** Returns the HID endpoint polling interval in ms. */
+uint8_t usb_comm_get_poll_interval_ms(void);
+
 /** Returns true when the USB HID device is mounted (PC connected). */
 bool usb_comm_is_connected(void);
 
 /**
- * FreeRTOS task: reads g_right_clutch_value and g_virtual_clutch_value
- * every 10 ms and sends a HID report.
+ * Wake the HID reporter because an axis value changed.
+ * Cheap and non-blocking; safe to call from any task. No-op in SOF mode,
+ * where reports are scheduled by the USB frame instead.
+ */
+void usb_comm_notify_report(void);
+
+/**
+ * FreeRTOS task: sends a HID report merged from all registered senders
+ * (sender_registry_merge) plus g_virtual_clutch_value, read once per
+ * report; it can lag the merged snapshots by one clutch engine cycle.
+ *   Event mode: as soon as usb_comm_notify_report() is called and the
+ *               endpoint is free, plus a keep-alive when nothing changes.
+ *   SOF mode:   once per USB frame, CONFIG_CLUTCH_HID_SOF_OFFSET_US
+ *               after start-of-frame, when the report changed or the
+ *               keep-alive is due.
+ *   Poll mode:  once per polling interval.
  * Pin to core 1, priority 8, stack 4096.
  */
 void task_hid_reporter(void *arg);
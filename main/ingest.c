@@ -0,0 +1,176 @@
+/**
+ * @file ingest.c
+ * @brief Lock-free SPSC ingest ring implementation
+ *
+ * Producer: WiFi task (espnow_recv_cb -> ingest_push)
+ * Consumer: ingest task (task_ingest -> handler)
+ *
+ * head and tail are free-running counters; the slot index is the counter
+ * masked by the ring size. Only the producer writes head, only the consumer
+ * writes tail, so no lock is needed. tail moves past a slot only once the
+ * handler has returned, so a depth of 0 means every frame is processed.
+ */
+
+#include "ingest.h"
+#include "hot_path.h"
+#include "espnow_handler.h"
+#include "power.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_now.h"
+
+static const char *TAG = "INGEST";
+
+_Static_assert((INGEST_RING_SLOTS & (INGEST_RING_SLOTS - 1)) == 0,
+               "CONFIG_CLUTCH_INGEST_RING_SLOTS must be a power of two");
+
+#define INGEST_RING_MASK (INGEST_RING_SLOTS - 1)
+
+typedef struct {
+    int64_t  rx_time_us;
+    uint8_t  mac[ESP_NOW_ETH_ALEN];
+    int8_t   rssi;
+    uint16_t len;
+    uint8_t  data[ESPNOW_MAX_DATA_LEN];
+} ingest_slot_t;
+
+static ingest_slot_t s_slots[INGEST_RING_SLOTS];
+static atomic_uint s_head = 0;      // written by producer only
+static atomic_uint s_tail = 0;      // written by consumer only
+
+static ingest_handler_t s_handler = NULL;
+static TaskHandle_t s_task = NULL;
+
+/* Producer-owned counters */
+static uint32_t s_queued = 0;
+static uint32_t s_overflows = 0;
+static uint32_t s_oversize = 0;
+static uint32_t s_high_water = 0;
+
+esp_err_t ingest_init(ingest_handler_t handler)
+{
+    if (handler == NULL) {
+        ESP_LOGE(TAG, "Invalid handler");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_store(&s_head, 0);
+    atomic_store(&s_tail, 0);
+    s_queued = 0;
+    s_overflows = 0;
+    s_oversize = 0;
+    s_high_water = 0;
+    s_handler = handler;
+
+    ESP_LOGI(TAG, "Ingest ring ready (%d slots, %u bytes)",
+             INGEST_RING_SLOTS, (unsigned)sizeof(s_slots));
+    return ESP_OK;
+}
+
+HOT_PATH_FN bool ingest_push(const uint8_t *mac_addr, const uint8_t *data, int len,
+                             int8_t rssi, int64_t rx_time_us)
+{
+    if (len > ESPNOW_MAX_DATA_LEN) {
+        s_oversize++;
+        return false;
+    }
+
+    unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+
+    if (head - tail >= INGEST_RING_SLOTS) {
+        s_overflows++;
+        return false;
+    }
+
+    ingest_slot_t *slot = &s_slots[head & INGEST_RING_MASK];
+    slot->rx_time_us = rx_time_us;
+    memcpy(slot->mac, mac_addr, ESP_NOW_ETH_ALEN);
+    slot->rssi = rssi;
+    slot->len = (uint16_t)len;
+    memcpy(slot->data, data, len);
+
+    atomic_store_explicit(&s_head, head + 1, memory_order_release);
+
+    uint32_t depth = head + 1 - tail;
+    if (depth > s_high_water) {
+        s_high_water = depth;
+    }
+    s_queued++;
+
+    if (s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+    return true;
+}
+
+void ingest_get_stats(ingest_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+
+    stats->queued     = s_queued;
+    stats->overflows  = s_overflows;
+    stats->oversize   = s_oversize;
+    stats->depth      = head - tail;
+    stats->high_water = s_high_water;
+    stats->capacity   = INGEST_RING_SLOTS;
+}
+
+void ingest_sync(void)
+{
+    if (s_task == NULL) {
+        return;
+    }
+
+    unsigned tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+    if (tail == atomic_load_explicit(&s_head, memory_order_acquire)) {
+        return;
+    }
+
+    // tail only moves once the handler for that frame has returned
+    while (atomic_load_explicit(&s_tail, memory_order_acquire) == tail) {
+        vTaskDelay(1);
+    }
+}
+
+HOT_PATH_FN void task_ingest(void *arg)
+{
+    (void)arg;
+
+    s_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        unsigned tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+
+        // Full clock before the first frame is looked at (power.h)
+        if (tail != head) {
+            power_ingest_begin(s_slots[tail & INGEST_RING_MASK].rx_time_us);
+        }
+
+        while (tail != head) {
+            const ingest_slot_t *slot = &s_slots[tail & INGEST_RING_MASK];
+            s_handler(slot->mac, slot->data, slot->len, slot->rssi, slot->rx_time_us);
+
+            tail++;
+            atomic_store_explicit(&s_tail, tail, memory_order_release);
+
+            if (tail == head) {
+                /* Pick up anything queued while we were processing */
+                head = atomic_load_explicit(&s_head, memory_order_acquire);
+            }
+        }
+
+        power_ingest_end();
+    }
+}
@@ -0,0 +1,191 @@
+/**
+ * @file latency_stats.c
+ * @brief Fixed-bucket latency histogram implementation
+ */
+
+#include "latency_stats.h"
+#include "hot_path.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+
+/* Bucket upper bounds in microseconds; one extra bucket catches the rest.
+ * Read on every sample, so kept out of flash in the low-jitter profile. */
+static const HOT_PATH_DATA uint32_t s_bucket_limit_us[] = {
+    10, 20, 30, 50, 100, 150, 200, 300,
+    400, 500, 750, 1000, 1250, 1500, 2000, 2500,
+    3000, 4000, 5000, 7500, 10000, 15000, 20000, 50000,
+    100000,
+};
+
+#define LATENCY_BUCKET_COUNT \
+    (sizeof(s_bucket_limit_us) / sizeof(s_bucket_limit_us[0]) + 1)
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+    uint32_t max_us;
+} latency_histogram_t;
+
+static latency_histogram_t s_hist[LATENCY_STAGE_COUNT];
+
+/* Newest processed packet waiting for a report: rx (high) | processed (low),
+ * both truncated to 32-bit microseconds. 0 = nothing pending. */
+static _Atomic uint64_t s_pending = 0;
+
+static const char *s_stage_names[LATENCY_STAGE_COUNT] = {
+    [LATENCY_STAGE_RX_TO_PROCESSED]     = "rx_to_processed",
+    [LATENCY_STAGE_PROCESSED_TO_REPORT] = "processed_to_report",
+    [LATENCY_STAGE_RX_TO_REPORT]        = "rx_to_report",
+    [LATENCY_STAGE_FILTER_DELAY]        = "filter_delay",
+    [LATENCY_STAGE_SAMPLE_AGE]          = "sample_age",
+    [LATENCY_STAGE_PING_RTT]            = "ping_rtt",
+    [LATENCY_STAGE_CLOCK_WAKE]          = "clock_wake",
+    [LATENCY_STAGE_REPORT_JITTER]       = "report_jitter",
+};
+
+static HOT_PATH_FN uint32_t bucket_index(uint32_t latency_us)
+{
+    uint32_t lo = 0;
+    uint32_t hi = LATENCY_BUCKET_COUNT - 1;
+
+    /* First bucket whose upper bound is >= latency */
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (latency_us <= s_bucket_limit_us[mid]) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+HOT_PATH_FN void latency_stats_record(latency_stage_t stage, uint32_t latency_us)
+{
+    if (stage >= LATENCY_STAGE_COUNT) {
+        return;
+    }
+
+    latency_histogram_t *h = &s_hist[stage];
+    h->buckets[bucket_index(latency_us)]++;
+    if (latency_us > h->max_us) {
+        h->max_us = latency_us;
+    }
+}
+
+HOT_PATH_FN void latency_stats_mark_processed(int64_t rx_time_us)
+{
+    uint32_t rx = (uint32_t)rx_time_us;
+    uint32_t processed = (uint32_t)esp_timer_get_time();
+
+    latency_stats_record(LATENCY_STAGE_RX_TO_PROCESSED, processed - rx);
+
+    uint64_t stamp = ((uint64_t)rx << 32) | processed;
+    atomic_store_explicit(&s_pending, stamp ? stamp : 1, memory_order_release);
+}
+
+HOT_PATH_FN void latency_stats_mark_reported(bool new_data)
+{
+    uint64_t stamp = atomic_exchange_explicit(&s_pending, 0, memory_order_acquire);
+    if (stamp == 0 || !new_data) {
+        return;
+    }
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t rx = (uint32_t)(stamp >> 32);
+    uint32_t processed = (uint32_t)stamp;
+
+    latency_stats_record(LATENCY_STAGE_PROCESSED_TO_REPORT, now - processed);
+    latency_stats_record(LATENCY_STAGE_RX_TO_REPORT, now - rx);
+}
+
+static uint32_t percentile_us(const latency_histogram_t *h, uint32_t count,
+                              uint32_t permille)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t target = ((uint64_t)count * permille + 999) / 1000;
+    uint64_t cumulative = 0;
+
+    for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        cumulative += h->buckets[i];
+        if (cumulative >= target) {
+            if (i == LATENCY_BUCKET_COUNT - 1 || s_bucket_limit_us[i] > h->max_us) {
+                return h->max_us;
+            }
+            return s_bucket_limit_us[i];
+        }
+    }
+    return h->max_us;
+}
+
+esp_err_t latency_stats_get(latency_stage_t stage, latency_summary_t *summary)
+{
+    if (stage >= LATENCY_STAGE_COUNT || summary == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Snapshot first: the writer task keeps updating the live histogram */
+    latency_histogram_t h;
+    memcpy(&h, &s_hist[stage], sizeof(h));
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        count += h.buckets[i];
+    }
+
+    summary->count  = count;
+    summary->p50_us = percentile_us(&h, count, 500);
+    summary->p99_us = percentile_us(&h, count, 990);
+    summary->max_us = h.max_us;
+    return ESP_OK;
+}
+
+const char *latency_stats_stage_name(latency_stage_t stage)
+{
+    if (stage >= LATENCY_STAGE_COUNT) {
+        return "unknown";
+    }
+    return s_stage_names[stage];
+}
+
+int latency_stats_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    int n = snprintf(buf, len, "{");
+    pos = (n > 0) ? (size_t)n : 0;
+
+    for (int i = 0; i < LATENCY_STAGE_COUNT && pos < len; i++) {
+        latency_summary_t s;
+        latency_stats_get((latency_stage_t)i, &s);
+        n = snprintf(buf + pos, len - pos,
+                     "%s\"%s\":{\"count\":%lu,\"p50_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}",
+                     i ? "," : "", s_stage_names[i],
+                     (unsigned long)s.count, (unsigned long)s.p50_us,
+                     (unsigned long)s.p99_us, (unsigned long)s.max_us);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "}");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
+
+void latency_stats_reset(void)
+{
+    atomic_store(&s_pending, 0);
+    memset(s_hist, 0, sizeof(s_hist));
+}
@@ -0,0 +1,293 @@
+/**
+ * @file link_quality.c
+ * @brief Per-sender link quality tracking implementation
+ *
+ * All averages are integer EWMAs:
+ *   rssi      : alpha 1/8, kept in Q4 for sub-dB resolution
+ *   interval  : alpha 1/16
+ *   jitter    : J += (|D| - J) / 16, D = arrival interval - average interval
+ *
+ * Without sequence numbers, loss is estimated from gaps: an arrival gap
+ * longer than 1.5x the average interval counts round(gap / interval) - 1
+ * missing packets. Gaps are not fed into the interval average.
+ *
+ * With sequence numbers, d = (int16)(seq - last_seq):
+ *   d == 0                      duplicate, discarded
+ *   -LINK_SEQ_STALE_WINDOW <= d < 0   stale (late retry / reorder), discarded,
+ *                               unless d < -LINK_SEQ_RESTART_JUMP after
+ *                               LINK_SEQ_RESTART_GAP_US of silence, which
+ *                               is a sender restart: resync and accept
+ *   0 < d <= LINK_SEQ_MAX_GAP   accepted, d - 1 frames lost
+ *   anything else               sender restarted, resync and accept
+ * A retry or reordered frame is only a few frames old and arrives right
+ * behind the frame that overtook it; a sender that rebooted restarts its
+ * count after at least its boot time without frames.
+ * Jitter then uses the transit-time difference (rx delta - tx delta) of
+ * consecutive frames, which removes the sender's own timing variance.
+ */
+
+#include "link_quality.h"
+#include "hot_path.h"
+#include "sender_registry.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    link_quality_entry_t pub;
+    int16_t rssi_q4;
+    bool in_use;
+} link_slot_t;
+
+#define LINK_SEQ_STALE_WINDOW   256
+#define LINK_SEQ_MAX_GAP        1024
+#define LINK_SEQ_RESTART_JUMP   4           // frames back
+#define LINK_SEQ_RESTART_GAP_US 100000      // since the last accepted frame
+
+/* Indexed by sender registry slot, so the packet path needs no MAC search */
+static link_slot_t s_slots[SENDER_REGISTRY_CAPACITY];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Set by link_quality_restart_sequences(), applied by the ingest task */
+static atomic_bool s_restart_pending = false;
+
+static HOT_PATH_FN link_slot_t *claim_slot(int sender, const uint8_t *mac, int8_t rssi)
+{
+    link_slot_t *slot = &s_slots[sender];
+
+    if (!slot->in_use) {
+        memset(slot, 0, sizeof(*slot));
+        memcpy(slot->pub.mac, mac, 6);
+        slot->rssi_q4 = (int16_t)(rssi * 16);
+        slot->in_use = true;
+    }
+    return slot;
+}
+
+static HOT_PATH_FN void update_rssi(link_slot_t *slot, int8_t rssi)
+{
+    slot->rssi_q4 += (int16_t)((rssi * 16 - slot->rssi_q4) / 8);
+    slot->pub.rssi_last = rssi;
+    slot->pub.rssi_avg = (int8_t)(slot->rssi_q4 / 16);
+}
+
+static HOT_PATH_FN void update_jitter(link_quality_entry_t *e, int32_t d)
+{
+    uint32_t abs_d = (uint32_t)(d < 0 ? -d : d);
+    e->jitter_us = (uint32_t)((int32_t)e->jitter_us +
+                              ((int32_t)abs_d - (int32_t)e->jitter_us) / 16);
+}
+
+static HOT_PATH_FN void update_interval(link_quality_entry_t *e, uint32_t delta)
+{
+    if (e->interval_us == 0) {
+        e->interval_us = delta;
+    } else {
+        e->interval_us = (uint32_t)((int32_t)e->interval_us +
+                                    ((int32_t)delta - (int32_t)e->interval_us) / 16);
+    }
+}
+
+HOT_PATH_FN void link_quality_update(int sender, const uint8_t *mac, int8_t rssi, int64_t rx_time_us)
+{
+    portENTER_CRITICAL(&s_lock);
+
+    link_slot_t *slot = claim_slot(sender, mac, rssi);
+    link_quality_entry_t *e = &slot->pub;
+    e->sequenced = false;
+
+    if (e->packets > 0) {
+        uint32_t delta = (uint32_t)(rx_time_us - e->last_rx_us);
+
+        if (e->interval_us == 0) {
+            e->interval_us = delta;
+        } else if (delta > e->interval_us + e->interval_us / 2) {
+            e->lost += (delta + e->interval_us / 2) / e->interval_us - 1;
+        } else {
+            update_jitter(e, (int32_t)delta - (int32_t)e->interval_us);
+            update_interval(e, delta);
+        }
+    }
+
+    update_rssi(slot, rssi);
+    e->last_rx_us = rx_time_us;
+    e->packets++;
+
+    portEXIT_CRITICAL(&s_lock);
+}
+
+HOT_PATH_FN link_seq_verdict_t link_quality_update_seq(int sender, const uint8_t *mac, int8_t rssi,
+                                                       int64_t rx_time_us, uint16_t seq,
+                                                       uint16_t tx_delta_us)
+{
+    link_seq_verdict_t verdict = LINK_SEQ_ACCEPT;
+
+    portENTER_CRITICAL(&s_lock);
+
+    if (atomic_load_explicit(&s_restart_pending, memory_order_relaxed) &&
+        atomic_exchange(&s_restart_pending, false)) {
+        for (int i = 0; i < SENDER_REGISTRY_CAPACITY; i++) {
+            s_slots[i].pub.sequenced = false;
+        }
+    }
+
+    link_slot_t *slot = claim_slot(sender, mac, rssi);
+    link_quality_entry_t *e = &slot->pub;
+    update_rssi(slot, rssi);
+
+    if (!e->sequenced || e->packets == 0) {
+        /* First sequenced frame from this sender: nothing to compare against */
+        e->sequenced = true;
+    } else {
+        int16_t d = (int16_t)(seq - e->last_seq);
+        uint32_t rx_delta = (uint32_t)(rx_time_us - e->last_rx_us);
+
+        if (d == 0) {
+            e->duplicates++;
+            verdict = LINK_SEQ_DUPLICATE;
+        } else if (d < 0 && d >= -LINK_SEQ_STALE_WINDOW &&
+                   (d >= -LINK_SEQ_RESTART_JUMP ||
+                    rx_time_us - e->last_rx_us < LINK_SEQ_RESTART_GAP_US)) {
+            e->stale++;
+            verdict = LINK_SEQ_STALE;
+        } else if (d > 0 && d <= LINK_SEQ_MAX_GAP) {
+            e->lost += (uint32_t)(d - 1);
+            if (d == 1 && tx_delta_us != UINT16_MAX) {
+                update_jitter(e, (int32_t)rx_delta - (int32_t)tx_delta_us);
+                update_interval(e, rx_delta);
+            }
+        } else {
+            e->resyncs++;
+        }
+    }
+
+    if (verdict == LINK_SEQ_ACCEPT) {
+        e->last_seq = seq;
+        e->last_rx_us = rx_time_us;
+        e->packets++;
+    }
+
+    portEXIT_CRITICAL(&s_lock);
+    return verdict;
+}
+
+/* Derived fields are computed on the reader side, off the packet path */
+static HOT_PATH_FN void finish_entry(link_quality_entry_t *e)
+{
+    uint64_t total = (uint64_t)e->packets + e->lost;
+    e->loss_permille = total ? (uint16_t)(((uint64_t)e->lost * 1000) / total) : 0;
+}
+
+size_t link_quality_count(void)
+{
+    size_t count = 0;
+    for (int i = 0; i < SENDER_REGISTRY_CAPACITY; i++) {
+        if (s_slots[i].in_use) {
+            count++;
+        }
+    }
+    return count;
+}
+
+esp_err_t link_quality_get(size_t index, link_quality_entry_t *entry)
+{
+    if (entry == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    size_t n = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < SENDER_REGISTRY_CAPACITY; i++) {
+        if (!s_slots[i].in_use) continue;
+        if (n++ == index) {
+            *entry = s_slots[i].pub;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK) {
+        finish_entry(entry);
+    }
+    return ret;
+}
+
+esp_err_t link_quality_find(const uint8_t *mac, link_quality_entry_t *entry)
+{
+    if (mac == NULL || entry == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    int sender = sender_registry_lookup(mac);
+    if (sender < 0) {
+        return ret;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_slots[sender].in_use) {
+        *entry = s_slots[sender].pub;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK) {
+        finish_entry(entry);
+    }
+    return ret;
+}
+
+void link_quality_restart_sequences(void)
+{
+    atomic_store(&s_restart_pending, true);
+}
+
+void link_quality_forget(int sender)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_slots[sender].in_use = false;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+int link_quality_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    int n = snprintf(buf, len, "[");
+    pos = (n > 0) ? (size_t)n : 0;
+
+    link_quality_entry_t e;
+    for (size_t i = 0; pos < len && link_quality_get(i, &e) == ESP_OK; i++) {
+        n = snprintf(buf + pos, len - pos,
+                     "%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"rssi\":%d,"
+                     "\"rssi_avg\":%d,\"packets\":%lu,\"lost\":%lu,"
+                     "\"loss_permille\":%u,\"duplicates\":%lu,\"stale\":%lu,"
+                     "\"sequenced\":%s,\"interval_us\":%lu,\"jitter_us\":%lu}",
+                     i ? "," : "",
+                     e.mac[0], e.mac[1], e.mac[2], e.mac[3], e.mac[4], e.mac[5],
+                     e.rssi_last, e.rssi_avg,
+                     (unsigned long)e.packets, (unsigned long)e.lost,
+                     e.loss_permille,
+                     (unsigned long)e.duplicates, (unsigned long)e.stale,
+                     e.sequenced ? "true" : "false",
+                     (unsigned long)e.interval_us, (unsigned long)e.jitter_us);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "]");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
@@ -3,13 +3,35 @@
  * @brief Main application entry point — ESP32-S3 Virtual Clutch HID
  *
  * Initialization order (critical):
- *  1. espnow_handler_init()   — NVS flash + WiFi (APSTA mode) + ESP-NOW
- *  2. config_manager_init()   — NVS namespace ready
- *  3. config_manager_load()   — populate g_config
- *  4. usb_comm_init()         — TinyUSB HID device
+ *  0. nvs_init(), dlog_init() — NVS flash, deferred logger for the hot paths
+ *     radio_mode_init()       — config or race mode (radio_mode.h)
+ *     power_init()            — frequency scaling, max clock held (power.h)
+ *  1. espnow_handler_init()   — WiFi (APSTA, STA only in race mode) + ESP-NOW
+ *     task_channel_manager    — channel survey and hopping (channel_manager.h)
+ *     task_rate_control       — transmit rate feedback to senders (rate_control.h)
+ *  2. sender_registry_init()  — sender table merged into the HID report
+ *     data_processor_init()   — packet consumer
+ *     ingest_init()           — RX ring between WiFi task and ingest task
+ *     capture_init()          — optional capture / replay ring (capture.h)
+ *     calib_store_load()      — restore calibration so packet #1 is normalized
+ *     pairing_init()          — paired senders as encrypted peers (pairing.h)
+ *  3. config_manager_init()   — NVS namespace ready
+ *     config_manager_load()   — populate g_config
+ *  4. telemetry_init()        — optional CDC telemetry stream (telemetry.h)
+ *     usb_comm_init()         — TinyUSB HID device (+ CDC with telemetry)
  *  5. clutch_engine_init()    — state machine
- *  6. web_config_init()       — WiFi AP config + HTTP server
- *  7. xTaskCreatePinnedToCore — spawn three tasks
+ *  6. web_config_init()       — WiFi AP config + HTTP server, config mode only
+ *  7. xTaskCreatePinnedToCore — spawn the tasks
+ *  8. register ESP-NOW callback
+ *
+ * CONFIG_CLUTCH_LOW_JITTER puts the packet path in IRAM (hot_path.h) and
+ * fixes the core layout below: ingest, clutch and HID on the core opposite
+ * the WiFi task, housekeeping on the WiFi core.
+ *
+ * With CONFIG_CLUTCH_BOOT_USB_FIRST, steps 1, pairing_init, 6 and 8 move to
+ * radio_bringup_task, created last, so USB enumerates while the radio
+ * starts. Each phase end is recorded with boot_trace_mark() and the table
+ * is logged by the first status report.
  */
 
 #include <string.h>
@@ -18,6 +40,7 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_mac.h"
+#include "nvs_flash.h"
 
 #include "espnow_handler.h"
 #include "usb_comm.h"
@@ -25,76 +48,389 @@
 #include "config_manager.h"
 #include "clutch_engine.h"
 #include "web_config.h"
+#include "ingest.h"
+#include "latency_stats.h"
+#include "deferred_log.h"
+#include "link_quality.h"
+#include "sender_registry.h"
+#include "calib_store.h"
+#include "boot_trace.h"
+#include "radio_mode.h"
+#include "channel_manager.h"
+#include "rate_control.h"
+#include "pairing.h"
+#include "capture.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "power.h"
+#include "hot_path.h"
 
 static const char *TAG = "MAIN";
 
+/* Core layout. The low-jitter profile keeps the whole packet path on the
+ * core opposite the WiFi task and moves everything else onto the WiFi
+ * core; otherwise only the hot tasks are pinned. */
+#if CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define WIFI_CORE           1
+#else
+#define WIFI_CORE           0
+#endif
+
+#if CONFIG_CLUTCH_LOW_JITTER
+#define INGEST_CORE         (1 - WIFI_CORE)
+#define CLUTCH_CORE         (1 - WIFI_CORE)
+#define HID_CORE            (1 - WIFI_CORE)
+#define HOUSEKEEPING_CORE   WIFI_CORE
+#else
+#define INGEST_CORE         CONFIG_CLUTCH_INGEST_TASK_CORE
+#define CLUTCH_CORE         0
+#define HID_CORE            1
+#define HOUSEKEEPING_CORE   tskNO_AFFINITY
+#endif
+
 /* Live config — shared pointer handed to web_config and clutch_engine */
 static clutch_config_t g_config;
 
-/* ESP-NOW data callback (called from WiFi task context) */
-static void on_espnow_data_received(const uint8_t *mac_addr,
-                                    const uint8_t *data, int len)
+/* ESP-NOW data callback (called from WiFi task context) — copy only.
+ * Unknown senders are refused before the ring; capture_rx() records the
+ * frame if a capture runs. Drops are counted by the ingest ring and
+ * reported by status_task. */
+static HOT_PATH_FN void on_espnow_data_received(const uint8_t *mac_addr,
+                                                const uint8_t *data, int len,
+                                                int8_t rssi, int64_t rx_time_us)
+{
+    if (!pairing_admit(mac_addr, data, len)) {
+        return;
+    }
+    capture_rx(mac_addr, data, len, rssi, rx_time_us);
+}
+
+/* Ingest ring handler (called from ingest task context) */
+static HOT_PATH_FN void on_ingest_packet(const uint8_t *mac_addr, const uint8_t *data,
+                                         int len, int8_t rssi, int64_t rx_time_us)
 {
-    esp_err_t ret = data_processor_process_espnow_data(mac_addr, data, len);
+    if (pairing_is_request(data, len)) {
+        pairing_handle_request(mac_addr, data, len, rssi);
+        return;
+    }
+
+    esp_err_t ret = data_processor_process_espnow_data(mac_addr, data, len,
+                                                       rssi, rx_time_us);
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "data_processor error: %s", esp_err_to_name(ret));
+        DLOGW(DLOG_TAG_INGEST, "data_processor error: 0x%x", ret);
+        return;
     }
+    latency_stats_mark_processed(rx_time_us);
 }
 
 /* Periodic status log task */
 static void status_task(void *arg)
 {
-    uint32_t total_packets, total_bytes;
+    uint64_t total_packets, total_bytes;
+    metrics_health_t health;
+    ingest_stats_t ring;
+    bool boot_logged = false;
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(10000));
+        if (!boot_logged) {
+            boot_trace_log();
+            boot_logged = true;
+        }
         data_processor_get_stats(&total_packets, &total_bytes);
-        ESP_LOGI(TAG, "=== Status === ESP-NOW:%s HID:%s pkts:%lu bytes:%lu heap:%lu",
+        ingest_get_stats(&ring);
+        metrics_get_health(&health);
+        ESP_LOGI(TAG, "=== Status === ESP-NOW:%s ch:%u HID:%s mode:%s clock:%s pkts:%llu "
+                 "bytes:%llu heap:%lu min:%lu",
                  espnow_handler_is_initialized() ? "UP" : "DOWN",
+                 espnow_handler_get_channel(),
                  usb_comm_is_connected()         ? "UP" : "DOWN",
-                 total_packets, total_bytes,
-                 esp_get_free_heap_size());
+                 radio_mode_name(radio_mode_get()),
+                 power_is_pinned() ? "pinned" : power_is_active() ? "max" : "idle",
+                 (unsigned long long)total_packets, (unsigned long long)total_bytes,
+                 esp_get_free_heap_size(), health.heap_min);
+        for (int i = 0; i < METRICS_TASK_COUNT; i++) {
+            const metrics_task_t *t = &health.tasks[i];
+            if (!t->found) continue;
+            if (t->cpu_permille == METRICS_CPU_UNKNOWN) {
+                ESP_LOGI(TAG, "    task %-6s stack_free:%lu",
+                         metrics_task_name((metrics_task_id_t)i), t->stack_free_min);
+            } else {
+                ESP_LOGI(TAG, "    task %-6s stack_free:%lu cpu:%u.%u%%",
+                         metrics_task_name((metrics_task_id_t)i), t->stack_free_min,
+                         t->cpu_permille / 10, t->cpu_permille % 10);
+            }
+        }
+        ESP_LOGI(TAG, "    ring: depth:%lu/%lu hwm:%lu overflow:%lu oversize:%lu "
+                 "discarded:%lu rejected:%lu refused:%lu hid_busy:%llu",
+                 ring.depth, ring.capacity, ring.high_water,
+                 ring.overflows, ring.oversize,
+                 data_processor_get_discarded_count(),
+                 data_processor_get_rejected_count(),
+                 pairing_get_refused_count(),
+                 (unsigned long long)metrics_get(METRIC_HID_BUSY));
+        capture_stats_t cap;
+        capture_get_stats(&cap);
+        if (cap.capacity != 0) {
+            ESP_LOGI(TAG, "    capture: state:%d records:%lu bytes:%lu/%lu overwritten:%lu "
+                     "replayed:%lu late_max:%luus",
+                     cap.state, cap.records, cap.bytes, cap.capacity, cap.overwritten,
+                     cap.replayed, cap.replay_late_max_us);
+        }
+        for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+            latency_summary_t lat;
+            latency_stats_get((latency_stage_t)i, &lat);
+            ESP_LOGI(TAG, "    %-19s n:%lu p50:%luus p99:%luus max:%luus",
+                     latency_stats_stage_name((latency_stage_t)i),
+                     lat.count, lat.p50_us, lat.p99_us, lat.max_us);
+        }
+        link_quality_entry_t link;
+        for (size_t i = 0; link_quality_get(i, &link) == ESP_OK; i++) {
+            int sender = sender_registry_lookup(link.mac);
+            ESP_LOGI(TAG, "    " MACSTR " map:0x%02lx rssi:%d/%d pkts:%lu lost:%lu (%u.%u%%) "
+                     "dup:%lu stale:%lu interval:%luus jitter:%luus%s",
+                     MAC2STR(link.mac),
+                     sender >= 0 ? sender_registry_field_mask(sender) : 0,
+                     link.rssi_last, link.rssi_avg,
+                     link.packets, link.lost,
+                     link.loss_permille / 10, link.loss_permille % 10,
+                     link.duplicates, link.stale,
+                     link.interval_us, link.jitter_us,
+                     link.sequenced ? "" : " (legacy)");
+        }
+    }
+}
+
+/* NVS is shared by the WiFi driver, calib_store and config_manager */
+static void nvs_init(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+}
+
+/* Host control over the vendor Feature report (TinyUSB task) */
+static void on_hid_feature_set(const usb_hid_feature_report_t *report)
+{
+    switch (report->command) {
+        case USB_HID_CMD_RADIO_MODE:
+            radio_mode_request((radio_mode_t)report->value);
+            break;
+        case USB_HID_CMD_PAIRING:
+            if (report->value != 0) {
+                pairing_open(report->value);
+            } else {
+                pairing_close();
+            }
+            break;
+        case USB_HID_CMD_UNPAIR_ALL:
+            pairing_request_forget();
+            break;
+        case USB_HID_CMD_CAPTURE:
+            // Carried out by task_capture: stopping waits for the radio path
+            capture_request(report->value == CAPTURE_RECORDING ||
+                            report->value == CAPTURE_REPLAYING ?
+                            (capture_state_t)report->value : CAPTURE_IDLE);
+            break;
+        case USB_HID_CMD_CAPTURE_DUMP:
+            // Sent by task_telemetry as CAPTURE frames (telemetry.h)
+            telemetry_request_capture_dump();
+            break;
+        default:
+            break;
+    }
+}
+
+static void on_hid_feature_get(usb_hid_feature_report_t *report)
+{
+    switch (report->command) {
+        case USB_HID_CMD_RADIO_MODE:
+            report->value = (uint8_t)radio_mode_get();
+            break;
+        case USB_HID_CMD_PAIRING:
+            report->value = pairing_is_open() ? 1 : 0;
+            break;
+        case USB_HID_CMD_UNPAIR_ALL:
+            report->value = (uint8_t)pairing_count();
+            break;
+        case USB_HID_CMD_CAPTURE:
+            report->value = (uint8_t)capture_get_state();
+            break;
+        case USB_HID_CMD_CAPTURE_DUMP:
+            report->value = telemetry_capture_dump_active() ? 1 : 0;
+            break;
+        default:
+            break;
+    }
+}
+
+/* The HTTP server only runs in config mode; race mode never allocates it */
+static void start_web_config(void)
+{
+    if (radio_mode_get() == RADIO_MODE_CONFIG) {
+        ESP_ERROR_CHECK(web_config_init(&g_config));
+        boot_trace_mark("web");
+    }
+}
+
+static void log_radio_ready(void)
+{
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    ESP_LOGI(TAG, "STA MAC: %02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    if (radio_mode_get() == RADIO_MODE_CONFIG) {
+        ESP_LOGI(TAG, "WiFi AP: SSID=VirtualClutch  IP=192.168.4.1");
+    } else {
+        ESP_LOGI(TAG, "Race mode: no AP, long-press the mode button for config mode");
     }
+    ESP_LOGI(TAG, "Ready — waiting for ESP-NOW data");
 }
 
+/* Paired peers and their keys; needs ESP-NOW and the sender registry */
+static void start_pairing(void)
+{
+    ESP_ERROR_CHECK(pairing_init());
+    xTaskCreatePinnedToCore(task_pairing, "pairing", 3072,
+                            NULL, 2, NULL, HOUSEKEEPING_CORE);
+}
+
+#if CONFIG_CLUTCH_BOOT_USB_FIRST
+/* Radio bring-up, in parallel with USB enumeration. Everything the receive
+ * callback feeds is ready before this task is created. */
+static void radio_bringup_task(void *arg)
+{
+    (void)arg;
+
+    ESP_ERROR_CHECK(espnow_handler_init(radio_mode_get() == RADIO_MODE_CONFIG));
+    boot_trace_mark("espnow");
+    start_pairing();
+    xTaskCreatePinnedToCore(task_channel_manager, "channel", 3072,
+                            NULL, 4, NULL, WIFI_CORE);
+#if CONFIG_CLUTCH_RATE_CONTROL
+    xTaskCreatePinnedToCore(task_rate_control, "rate_ctrl", 3072,
+                            NULL, 3, NULL, WIFI_CORE);
+#endif
+
+    /* Open the gate before the HTTP server so the clutch works first */
+    ESP_ERROR_CHECK(espnow_handler_register_recv_callback(on_espnow_data_received));
+
+    start_web_config();
+
+    log_radio_ready();
+    vTaskDelete(NULL);
+}
+#endif
+
 void app_main(void)
 {
+    boot_trace_mark("app_main");
     ESP_LOGI(TAG, "=== ESP32-S3 Virtual Clutch HID ===");
     ESP_LOGI(TAG, "Build: %s %s", __DATE__, __TIME__);
 
-    /* 1. WiFi (APSTA mode) + ESP-NOW init — callback NOT registered yet */
-    ESP_ERROR_CHECK(espnow_handler_init());
+    /* 0. NVS + deferred logger — the RX/HID hot paths log through it */
+    nvs_init();
+    boot_trace_mark("nvs");
+    ESP_ERROR_CHECK(dlog_init());
+    radio_mode_init();
+    if (power_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Power management unavailable, running at full clock");
+    }
+
+#if !CONFIG_CLUTCH_BOOT_USB_FIRST
+    /* 1. WiFi (APSTA, or STA in race mode) + ESP-NOW — callback NOT registered yet */
+    ESP_ERROR_CHECK(espnow_handler_init(radio_mode_get() == RADIO_MODE_CONFIG));
+    boot_trace_mark("espnow");
+    xTaskCreatePinnedToCore(task_channel_manager, "channel", 3072,
+                            NULL, 4, NULL, WIFI_CORE);
+#if CONFIG_CLUTCH_RATE_CONTROL
+    xTaskCreatePinnedToCore(task_rate_control, "rate_ctrl", 3072,
+                            NULL, 3, NULL, WIFI_CORE);
+#endif
+#endif
 
     /* 2. All consumers must be ready before the first packet can arrive */
+    ESP_ERROR_CHECK(sender_registry_init());
     ESP_ERROR_CHECK(data_processor_init());
+    ESP_ERROR_CHECK(ingest_init(on_ingest_packet));
+    capture_init();
 
-    /* 3. Config (NVS already initialized by espnow_handler_init) */
+    /* Stored calibration, shaping and filter */
+    calib_store_load();
+
+#if !CONFIG_CLUTCH_BOOT_USB_FIRST
+    /* Paired senders, before the receive callback is registered */
+    start_pairing();
+#endif
+
+    /* 3. Config */
     ESP_ERROR_CHECK(config_manager_init());
     config_manager_load(&g_config);
+    boot_trace_mark("data_path");
 
-    /* 4. USB HID */
+    /* 4. USB HID — enumerates with neutral axes until packets arrive */
+    usb_comm_set_feature_handler(on_hid_feature_set, on_hid_feature_get);
+    ESP_ERROR_CHECK(telemetry_init());
     ESP_ERROR_CHECK(usb_comm_init());
+    boot_trace_mark("usb_installed");
 
     /* 5. Virtual clutch state machine */
     clutch_engine_init(&g_config);
 
-    /* 6. WiFi AP + HTTP server */
-    ESP_ERROR_CHECK(web_config_init(&g_config));
+#if CONFIG_CLUTCH_BENCHMARKS
+    if (data_processor_run_benchmark() != ESP_OK) {
+        ESP_LOGW(TAG, "Benchmark: processing output differs from reference");
+    }
+#endif
+
+#if !CONFIG_CLUTCH_BOOT_USB_FIRST
+    /* 6. WiFi AP + HTTP server (config mode only) */
+    start_web_config();
+#endif
 
     /* 7. FreeRTOS tasks */
+    xTaskCreatePinnedToCore(task_ingest,        "ingest", 4096,
+                            NULL, CONFIG_CLUTCH_INGEST_TASK_PRIORITY, NULL,
+                            INGEST_CORE);
     xTaskCreatePinnedToCore(task_clutch_engine, "clutch", 4096,
-                            NULL, 10, NULL, 0);
+                            NULL, 10, NULL, CLUTCH_CORE);
     xTaskCreatePinnedToCore(task_hid_reporter,  "hid",    4096,
-                            NULL,  8, NULL, 1);
-    xTaskCreate(status_task, "status", 3072, NULL, 3, NULL);
+                            NULL,  8, NULL, HID_CORE);
+    xTaskCreatePinnedToCore(status_task,      "status",      3072,
+                            NULL, 3, NULL, HOUSEKEEPING_CORE);
+    xTaskCreatePinnedToCore(task_dlog,        "dlog",        3072,
+                            NULL, 2, NULL, HOUSEKEEPING_CORE);
+    xTaskCreatePinnedToCore(task_calibration, "calibration", 3072,
+                            NULL, 2, NULL, HOUSEKEEPING_CORE);
+    xTaskCreatePinnedToCore(task_calib_store, "calib_store", 3072,
+                            NULL, 1, NULL, HOUSEKEEPING_CORE);
+    xTaskCreatePinnedToCore(task_radio_mode,  "radio_mode",  3072,
+                            NULL, 2, NULL, HOUSEKEEPING_CORE);
+    xTaskCreatePinnedToCore(task_metrics,     "metrics",     3072,
+                            NULL, 1, NULL, HOUSEKEEPING_CORE);
+#if CONFIG_CLUTCH_CAPTURE
+    xTaskCreatePinnedToCore(task_capture,     "capture",     3072,
+                            NULL, 2, NULL, HOUSEKEEPING_CORE);
+#endif
+#if CONFIG_CLUTCH_POWER_MANAGEMENT
+    xTaskCreatePinnedToCore(task_power,       "power",       2048,
+                            NULL, 1, NULL, HOUSEKEEPING_CORE);
+#endif
+#if CONFIG_CLUTCH_USB_TELEMETRY
+    xTaskCreatePinnedToCore(task_telemetry,   "telemetry",   3072,
+                            NULL, 2, NULL, WIFI_CORE);
+#endif
+    boot_trace_mark("tasks");
 
+#if CONFIG_CLUTCH_BOOT_USB_FIRST
+    /* 8. Radio, ESP-NOW gate and HTTP server come up in parallel */
+    xTaskCreatePinnedToCore(radio_bringup_task, "radio_up", 4096,
+                            NULL, 5, NULL, WIFI_CORE);
+#else
     /* 8. Open the gate — register ESP-NOW callback last, once everything is ready */
     ESP_ERROR_CHECK(espnow_handler_register_recv_callback(on_espnow_data_received));
-
-    /* Print MAC for reference */
-    uint8_t mac[6];
-    esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    ESP_LOGI(TAG, "STA MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    ESP_LOGI(TAG, "WiFi AP: SSID=VirtualClutch  IP=192.168.4.1");
-    ESP_LOGI(TAG, "Ready — waiting for ESP-NOW data");
+    log_radio_ready();
+#endif
 }
@@ -0,0 +1,265 @@
+/**
+ * @file metrics.c
+ * @brief Runtime health metrics implementation
+ *
+ * 64-bit atomics on the ESP32-S3 go through the toolchain's lock-based
+ * __atomic helpers: a few tens of cycles, fine at packet rate. Gauges are
+ * written by task_metrics only and copied out under s_lock.
+ */
+
+#include "metrics.h"
+#include "hot_path.h"
+#include "ingest.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#define MAX_TASKS       32      // uxTaskGetSystemState snapshot size
+
+_Static_assert(METRICS_TASK_COUNT == TELEMETRY_HEALTH_TASKS,
+               "telemetry_health_t must carry every sampled task");
+
+static _Atomic uint64_t s_counters[METRIC_COUNT];
+
+static const char *s_counter_names[METRIC_COUNT] = {
+    [METRIC_RX_PACKETS]   = "rx_packets",
+    [METRIC_RX_BYTES]     = "rx_bytes",
+    [METRIC_RX_DISCARDED] = "rx_discarded",
+    [METRIC_RX_REJECTED]  = "rx_rejected",
+    [METRIC_HID_REPORTS]  = "hid_reports",
+    [METRIC_HID_BUSY]     = "hid_busy",
+};
+
+/* FreeRTOS task names; "wifi" is created by the WiFi driver, IDLEn by
+ * the scheduler */
+static const char *s_task_names[METRICS_TASK_COUNT] = {
+    [METRICS_TASK_INGEST] = "ingest",
+    [METRICS_TASK_CLUTCH] = "clutch",
+    [METRICS_TASK_HID]    = "hid",
+    [METRICS_TASK_WIFI]   = "wifi",
+    [METRICS_TASK_IDLE0]  = "IDLE0",
+    [METRICS_TASK_IDLE1]  = "IDLE1",
+};
+
+static metrics_health_t s_health;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static TaskStatus_t s_status[MAX_TASKS];
+static uint32_t s_prev_runtime[METRICS_TASK_COUNT];
+static uint32_t s_prev_total = 0;
+#endif
+
+HOT_PATH_FN void metrics_add(metric_id_t id, uint64_t n)
+{
+    if ((unsigned)id < METRIC_COUNT) {
+        atomic_fetch_add_explicit(&s_counters[id], n, memory_order_relaxed);
+    }
+}
+
+uint64_t metrics_get(metric_id_t id)
+{
+    if ((unsigned)id >= METRIC_COUNT) {
+        return 0;
+    }
+    return atomic_load_explicit(&s_counters[id], memory_order_relaxed);
+}
+
+void metrics_set(metric_id_t id, uint64_t value)
+{
+    if ((unsigned)id < METRIC_COUNT) {
+        atomic_store_explicit(&s_counters[id], value, memory_order_relaxed);
+    }
+}
+
+const char *metrics_name(metric_id_t id)
+{
+    return (unsigned)id < METRIC_COUNT ? s_counter_names[id] : "unknown";
+}
+
+const char *metrics_task_name(metrics_task_id_t id)
+{
+    return (unsigned)id < METRICS_TASK_COUNT ? s_task_names[id] : "unknown";
+}
+
+void metrics_get_health(metrics_health_t *health)
+{
+    if (health == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *health = s_health;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+/* Stacks and CPU share from one system state snapshot */
+static void sample_tasks(metrics_task_t *tasks)
+{
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_status, MAX_TASKS, &total);
+    uint32_t window = total - s_prev_total;
+
+    for (int t = 0; t < METRICS_TASK_COUNT; t++) {
+        tasks[t] = (metrics_task_t){ .cpu_permille = METRICS_CPU_UNKNOWN };
+        for (UBaseType_t i = 0; i < count; i++) {
+            if (strcmp(s_status[i].pcTaskName, s_task_names[t]) != 0) {
+                continue;
+            }
+            uint32_t runtime = (uint32_t)s_status[i].ulRunTimeCounter;
+            tasks[t].found = true;
+            tasks[t].stack_free_min = s_status[i].usStackHighWaterMark;
+            if (s_prev_total != 0 && window != 0) {
+                uint64_t share = (uint64_t)(runtime - s_prev_runtime[t]) * 1000 / window;
+                tasks[t].cpu_permille = (uint16_t)(share > 1000 ? 1000 : share);
+            }
+            s_prev_runtime[t] = runtime;
+            break;
+        }
+    }
+    if (count != 0) {
+        s_prev_total = total;
+    }
+}
+
+#else
+
+/* Stacks only; CPU share needs the run-time counters */
+static void sample_tasks(metrics_task_t *tasks)
+{
+    for (int t = 0; t < METRICS_TASK_COUNT; t++) {
+        TaskHandle_t task = xTaskGetHandle(s_task_names[t]);
+        tasks[t] = (metrics_task_t){
+            .found = task != NULL,
+            .stack_free_min = task != NULL ? uxTaskGetStackHighWaterMark(task) : 0,
+            .cpu_permille = METRICS_CPU_UNKNOWN,
+        };
+    }
+}
+
+#endif /* CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
+
+static void emit_telemetry(const metrics_health_t *health)
+{
+    if (!telemetry_is_active()) {
+        return;
+    }
+
+    telemetry_health_t frame = {
+        .t_us = (uint32_t)health->sampled_us,
+        .heap_free = health->heap_free,
+        .heap_min = health->heap_min,
+        .ingest_depth = (uint16_t)health->ingest_depth,
+        .ingest_high_water = (uint16_t)health->ingest_high_water,
+        .hid_reports = metrics_get(METRIC_HID_REPORTS),
+        .hid_busy = metrics_get(METRIC_HID_BUSY),
+    };
+    for (int t = 0; t < METRICS_TASK_COUNT; t++) {
+        uint32_t stack = health->tasks[t].stack_free_min;
+        frame.tasks[t].stack_free_min = stack > UINT16_MAX ? UINT16_MAX : (uint16_t)stack;
+        frame.tasks[t].cpu_permille = health->tasks[t].cpu_permille;
+    }
+    telemetry_emit(TELEMETRY_FRAME_HEALTH, &frame, sizeof(frame));
+}
+
+int metrics_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    metrics_health_t h;
+    metrics_get_health(&h);
+
+    size_t pos = 0;
+    int n = snprintf(buf, len, "{\"counters\":{");
+    pos = (n > 0) ? (size_t)n : 0;
+
+    for (int i = 0; i < METRIC_COUNT && pos < len; i++) {
+        n = snprintf(buf + pos, len - pos, "%s\"%s\":%llu",
+                     i ? "," : "", s_counter_names[i],
+                     (unsigned long long)metrics_get((metric_id_t)i));
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos,
+                     "},\"heap\":{\"free\":%lu,\"min\":%lu},"
+                     "\"ingest\":{\"depth\":%lu,\"high_water\":%lu,\"capacity\":%lu},"
+                     "\"tasks\":{",
+                     (unsigned long)h.heap_free, (unsigned long)h.heap_min,
+                     (unsigned long)h.ingest_depth, (unsigned long)h.ingest_high_water,
+                     (unsigned long)h.ingest_capacity);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    bool first = true;
+    for (int t = 0; t < METRICS_TASK_COUNT && pos < len; t++) {
+        if (!h.tasks[t].found) {
+            continue;
+        }
+        if (h.tasks[t].cpu_permille == METRICS_CPU_UNKNOWN) {
+            n = snprintf(buf + pos, len - pos, "%s\"%s\":{\"stack_free\":%lu}",
+                         first ? "" : ",", s_task_names[t],
+                         (unsigned long)h.tasks[t].stack_free_min);
+        } else {
+            n = snprintf(buf + pos, len - pos,
+                         "%s\"%s\":{\"stack_free\":%lu,\"cpu_permille\":%u}",
+                         first ? "" : ",", s_task_names[t],
+                         (unsigned long)h.tasks[t].stack_free_min,
+                         h.tasks[t].cpu_permille);
+        }
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+        first = false;
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "}}");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
+
+void task_metrics(void *arg)
+{
+    (void)arg;
+
+    metrics_health_t health;
+    ingest_stats_t ring;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_CLUTCH_METRICS_SAMPLE_MS));
+
+        memset(&health, 0, sizeof(health));
+        sample_tasks(health.tasks);
+        ingest_get_stats(&ring);
+        health.ingest_depth = ring.depth;
+        health.ingest_high_water = ring.high_water;
+        health.ingest_capacity = ring.capacity;
+        health.heap_free = esp_get_free_heap_size();
+        health.heap_min = esp_get_minimum_free_heap_size();
+        health.sampled_us = esp_timer_get_time();
+
+        portENTER_CRITICAL(&s_lock);
+        s_health = health;
+        portEXIT_CRITICAL(&s_lock);
+
+        emit_telemetry(&health);
+    }
+}
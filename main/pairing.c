@@ -0,0 +1,452 @@
+/**
+ * @file pairing.c
+ * @brief Sender pairing and RTT probe implementation
+ *
+ * The paired set is one versioned, CRC-protected NVS blob like the
+ * calibration record. Only the pairing task writes it; the WiFi task
+ * admits frames through the lock-free sender registry, where every
+ * paired sender is registered at boot and when it pairs.
+ */
+
+#include "pairing.h"
+#include "hot_path.h"
+#include "espnow_handler.h"
+#include "espnow_wire.h"
+#include "link_quality.h"
+#include "latency_stats.h"
+#include "sender_registry.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_now.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "mbedtls/md.h"
+#include "nvs.h"
+
+static const char *TAG = "PAIRING";
+
+#define PAIRING_NVS_NAMESPACE   "pairing"
+#define PAIRING_NVS_KEY         "peers"
+#define PAIRING_RECORD_MAGIC    0x5050      // "PP"
+#define PAIRING_RECORD_VERSION  1
+
+#define LOOP_MS                 100
+#define PING_QUIET_MS           3000        // no pings to senders that went quiet
+
+typedef struct __attribute__((packed)) {
+    uint8_t  mac[6];
+    uint8_t  lmk[ESP_NOW_KEY_LEN];
+    uint32_t field_mask;
+} pairing_peer_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  count;
+    pairing_peer_record_t peers[PAIRING_MAX_PEERS];
+    uint32_t crc;               // esp_rom_crc32_le over all preceding bytes
+} pairing_record_t;
+
+static pairing_record_t s_record;
+static TaskHandle_t s_task = NULL;
+
+/* Window end in ms (esp_timer time), 0 = closed */
+static _Atomic uint32_t s_window_end_ms = 0;
+static _Atomic uint32_t s_refused = 0;
+static atomic_bool s_forget_requested = false;
+
+/* One request in flight from the ingest task to the pairing task */
+static atomic_bool s_request_ready = false;
+static uint8_t s_request_mac[6];
+static uint32_t s_request_fields;
+
+static uint32_t record_crc(const pairing_record_t *rec)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(pairing_record_t, crc));
+}
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+#if CONFIG_CLUTCH_ESPNOW_ENCRYPT
+_Static_assert(sizeof(CONFIG_CLUTCH_ESPNOW_PMK) - 1 == ESP_NOW_KEY_LEN,
+               "CONFIG_CLUTCH_ESPNOW_PMK must be set: exactly 16 characters");
+
+/* lmk = HMAC-SHA256(PMK, sender MAC || receiver MAC)[0..15] */
+static esp_err_t derive_lmk(const uint8_t *mac, uint8_t *lmk)
+{
+    uint8_t msg[12];
+    uint8_t digest[32];
+
+    memcpy(msg, mac, 6);
+    esp_read_mac(msg + 6, ESP_MAC_WIFI_STA);
+
+    int ret = mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                              (const uint8_t *)CONFIG_CLUTCH_ESPNOW_PMK, ESP_NOW_KEY_LEN,
+                              msg, sizeof(msg), digest);
+    if (ret != 0) {
+        return ESP_FAIL;
+    }
+    memcpy(lmk, digest, ESP_NOW_KEY_LEN);
+    return ESP_OK;
+}
+
+static esp_err_t add_peer(const pairing_peer_record_t *peer)
+{
+    return espnow_handler_add_encrypted_peer(peer->mac, peer->lmk);
+}
+#else
+static esp_err_t derive_lmk(const uint8_t *mac, uint8_t *lmk)
+{
+    (void)mac;
+    memset(lmk, 0, ESP_NOW_KEY_LEN);
+    return ESP_OK;
+}
+
+static esp_err_t add_peer(const pairing_peer_record_t *peer)
+{
+    return espnow_handler_add_peer(peer->mac);
+}
+#endif
+
+static esp_err_t save(void)
+{
+    s_record.magic = PAIRING_RECORD_MAGIC;
+    s_record.version = PAIRING_RECORD_VERSION;
+    s_record.crc = record_crc(&s_record);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(PAIRING_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed: 0x%x", ret);
+        return ret;
+    }
+
+    ret = nvs_set_blob(handle, PAIRING_NVS_KEY, &s_record, sizeof(s_record));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save pairings: 0x%x", ret);
+    }
+    return ret;
+}
+
+static esp_err_t load(void)
+{
+    nvs_handle_t handle;
+    size_t len = sizeof(s_record);
+
+    esp_err_t ret = nvs_open(PAIRING_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, PAIRING_NVS_KEY, &s_record, &len);
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        memset(&s_record, 0, sizeof(s_record));
+        return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+    }
+
+    if (len != sizeof(s_record) || s_record.magic != PAIRING_RECORD_MAGIC ||
+        s_record.version != PAIRING_RECORD_VERSION ||
+        s_record.crc != record_crc(&s_record) || s_record.count > PAIRING_MAX_PEERS) {
+        ESP_LOGW(TAG, "Stored pairings rejected (%u bytes)", (unsigned)len);
+        memset(&s_record, 0, sizeof(s_record));
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+static int find_peer(const uint8_t *mac)
+{
+    for (int i = 0; i < s_record.count; i++) {
+        if (memcmp(s_record.peers[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t pairing_init(void)
+{
+#if CONFIG_CLUTCH_ESPNOW_ENCRYPT
+    esp_err_t ret = espnow_handler_set_pmk((const uint8_t *)CONFIG_CLUTCH_ESPNOW_PMK);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set PMK: 0x%x", ret);
+        return ret;
+    }
+#endif
+
+    load();
+    for (int i = 0; i < s_record.count; i++) {
+        const pairing_peer_record_t *peer = &s_record.peers[i];
+        if (add_peer(peer) != ESP_OK ||
+            sender_registry_register(peer->mac, peer->field_mask) != ESP_OK) {
+            ESP_LOGW(TAG, "Paired sender " MACSTR " not restored", MAC2STR(peer->mac));
+        }
+    }
+
+    ESP_LOGI(TAG, "%u paired sender(s), %s", s_record.count,
+#if CONFIG_CLUTCH_ESPNOW_ENCRYPT
+             "encrypted"
+#else
+             "unencrypted"
+#endif
+             );
+
+#if CONFIG_CLUTCH_PAIRING_OPEN_AT_BOOT
+    if (s_record.count == 0) {
+        pairing_open(0);
+    }
+#endif
+    return ESP_OK;
+}
+
+HOT_PATH_FN bool pairing_is_request(const uint8_t *data, int len)
+{
+    return len >= (int)(sizeof(espnow_wire_header_t) + sizeof(espnow_wire_pair_request_t)) &&
+           data[0] == ESPNOW_WIRE_MAGIC &&
+           ((const espnow_wire_header_t *)data)->type == ESPNOW_WIRE_TYPE_PAIR_REQUEST;
+}
+
+HOT_PATH_FN bool pairing_admit(const uint8_t *mac_addr, const uint8_t *data, int len)
+{
+#if CONFIG_CLUTCH_SENDER_AUTO_REGISTER
+    (void)mac_addr;
+    (void)data;
+    (void)len;
+    return true;
+#else
+    if (sender_registry_lookup(mac_addr) >= 0 ||
+        (pairing_is_request(data, len) && pairing_is_open())) {
+        return true;
+    }
+    atomic_fetch_add_explicit(&s_refused, 1, memory_order_relaxed);
+    return false;
+#endif
+}
+
+void pairing_handle_request(const uint8_t *mac_addr, const uint8_t *data, int len,
+                            int8_t rssi)
+{
+    if (!pairing_is_open() || rssi < CONFIG_CLUTCH_PAIRING_MIN_RSSI) {
+        return;
+    }
+    if (atomic_load_explicit(&s_request_ready, memory_order_acquire)) {
+        return;     // busy; the sender repeats its request
+    }
+
+    espnow_wire_pair_request_t req;
+    memcpy(&req, data + sizeof(espnow_wire_header_t), sizeof(req));
+
+    memcpy(s_request_mac, mac_addr, 6);
+    s_request_fields = req.field_mask & SENDER_FIELDS_ALL;
+    atomic_store_explicit(&s_request_ready, true, memory_order_release);
+
+    TaskHandle_t task = s_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void pairing_open(uint32_t window_s)
+{
+    if (window_s == 0) {
+        window_s = CONFIG_CLUTCH_PAIRING_WINDOW_S;
+    }
+    uint32_t end = now_ms() + window_s * 1000;
+    atomic_store(&s_window_end_ms, end != 0 ? end : 1);
+    ESP_LOGI(TAG, "Pairing window open for %lu s", (unsigned long)window_s);
+}
+
+void pairing_close(void)
+{
+    if (atomic_exchange(&s_window_end_ms, 0) != 0) {
+        ESP_LOGI(TAG, "Pairing window closed");
+    }
+}
+
+bool pairing_is_open(void)
+{
+    uint32_t end = atomic_load_explicit(&s_window_end_ms, memory_order_relaxed);
+    return end != 0 && (int32_t)(end - now_ms()) > 0;
+}
+
+void pairing_request_forget(void)
+{
+    atomic_store(&s_forget_requested, true);
+    TaskHandle_t task = s_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+size_t pairing_count(void)
+{
+    return s_record.count;
+}
+
+uint32_t pairing_get_refused_count(void)
+{
+    return atomic_load_explicit(&s_refused, memory_order_relaxed);
+}
+
+static void send_accept(const pairing_peer_record_t *peer)
+{
+    const espnow_wire_pair_accept_t body = {
+        .field_mask = peer->field_mask,
+        .channel = espnow_handler_get_channel(),
+        .rendezvous = CONFIG_CLUTCH_RENDEZVOUS_CHANNEL,
+    };
+    esp_err_t ret = espnow_handler_send_wire(peer->mac, ESPNOW_WIRE_TYPE_PAIR_ACCEPT,
+                                             &body, sizeof(body));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Pair accept to " MACSTR " failed: 0x%x", MAC2STR(peer->mac), ret);
+    }
+}
+
+static void pair(const uint8_t *mac, uint32_t field_mask)
+{
+    int i = find_peer(mac);
+    if (i >= 0) {
+        send_accept(&s_record.peers[i]);    // our last accept was lost
+        return;
+    }
+    if (s_record.count >= PAIRING_MAX_PEERS) {
+        ESP_LOGW(TAG, "Pairing " MACSTR " refused: %d senders already paired",
+                 MAC2STR(mac), PAIRING_MAX_PEERS);
+        return;
+    }
+
+    pairing_peer_record_t *peer = &s_record.peers[s_record.count];
+    memcpy(peer->mac, mac, 6);
+    peer->field_mask = field_mask != 0 ? field_mask : SENDER_FIELDS_ALL;
+    if (derive_lmk(mac, peer->lmk) != ESP_OK || add_peer(peer) != ESP_OK) {
+        ESP_LOGE(TAG, "Pairing " MACSTR " failed: no key", MAC2STR(mac));
+        return;
+    }
+    if (sender_registry_register(mac, peer->field_mask) != ESP_OK) {
+        ESP_LOGE(TAG, "Pairing " MACSTR " failed: sender table full", MAC2STR(mac));
+        espnow_handler_remove_peer(mac);
+        return;
+    }
+
+    s_record.count++;
+    save();
+    send_accept(peer);
+    ESP_LOGI(TAG, "Paired " MACSTR " (fields 0x%02lx)", MAC2STR(mac),
+             (unsigned long)peer->field_mask);
+}
+
+static void forget_all(void)
+{
+    for (int i = 0; i < s_record.count; i++) {
+        espnow_handler_remove_peer(s_record.peers[i].mac);
+        sender_registry_unregister(s_record.peers[i].mac);
+    }
+    ESP_LOGI(TAG, "Forgot %u paired sender(s)", s_record.count);
+    memset(&s_record, 0, sizeof(s_record));
+    save();
+}
+
+#if CONFIG_CLUTCH_PING_INTERVAL_MS > 0
+static void send_pings(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    const espnow_wire_ping_t body = { .t_us = (uint32_t)now_us };
+    link_quality_entry_t link;
+
+    for (size_t i = 0; link_quality_get(i, &link) == ESP_OK; i++) {
+        if (!link.sequenced || now_us - link.last_rx_us > PING_QUIET_MS * 1000LL) {
+            continue;
+        }
+        if (espnow_handler_add_peer(link.mac) == ESP_OK) {
+            espnow_handler_send_wire(link.mac, ESPNOW_WIRE_TYPE_PING, &body, sizeof(body));
+        }
+    }
+}
+#endif
+
+int pairing_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    int n = snprintf(buf, len,
+                     "{\"open\":%s,\"encrypted\":%s,\"refused\":%lu,\"peers\":[",
+                     pairing_is_open() ? "true" : "false",
+#if CONFIG_CLUTCH_ESPNOW_ENCRYPT
+                     "true",
+#else
+                     "false",
+#endif
+                     (unsigned long)pairing_get_refused_count());
+    pos = (n > 0) ? (size_t)n : 0;
+
+    for (int i = 0; pos < len && i < s_record.count; i++) {
+        const pairing_peer_record_t *peer = &s_record.peers[i];
+        n = snprintf(buf + pos, len - pos,
+                     "%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"fields\":%lu}",
+                     i ? "," : "",
+                     peer->mac[0], peer->mac[1], peer->mac[2],
+                     peer->mac[3], peer->mac[4], peer->mac[5],
+                     (unsigned long)peer->field_mask);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "]}");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
+
+void task_pairing(void *arg)
+{
+    (void)arg;
+
+    s_task = xTaskGetCurrentTaskHandle();
+#if CONFIG_CLUTCH_PING_INTERVAL_MS > 0
+    uint32_t next_ping_ms = now_ms();
+#endif
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_MS));
+
+        if (atomic_exchange(&s_forget_requested, false)) {
+            forget_all();
+        }
+
+        if (atomic_load_explicit(&s_request_ready, memory_order_acquire)) {
+            pair(s_request_mac, s_request_fields);
+            atomic_store_explicit(&s_request_ready, false, memory_order_release);
+        }
+
+        uint32_t end = atomic_load(&s_window_end_ms);
+        if (end != 0 && (int32_t)(end - now_ms()) <= 0) {
+            pairing_close();
+        }
+
+#if CONFIG_CLUTCH_PING_INTERVAL_MS > 0
+        if ((int32_t)(now_ms() - next_ping_ms) >= 0) {
+            send_pings();
+            next_ping_ms = now_ms() + CONFIG_CLUTCH_PING_INTERVAL_MS;
+        }
+#endif
+    }
+}
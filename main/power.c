@@ -0,0 +1,193 @@
+/**
+ * @file power.c
+ * @brief Power/latency governor implementation
+ *
+ * s_held mirrors whether this module owns one reference of s_cpu_lock
+ * (esp_pm locks are counted). The data path takes it with an atomic
+ * exchange, so only the transition pays for esp_pm_lock_acquire(). The
+ * governor gives it back after the hold time; activity that races with
+ * the release re-takes it at once. The ingest task's batch hold is a
+ * second, separate reference, so either side can release its own.
+ */
+
+#include "power.h"
+#include "hot_path.h"
+#include "sdkconfig.h"
+
+#if CONFIG_CLUTCH_POWER_MANAGEMENT
+
+#include "latency_stats.h"
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+
+static const char *TAG = "POWER";
+
+#define GOVERNOR_PERIOD_MS      100
+
+static esp_pm_lock_handle_t s_cpu_lock = NULL;
+static atomic_bool s_held = false;
+static atomic_bool s_pinned = false;
+static atomic_uint s_strikes = 0;
+static _Atomic uint32_t s_last_activity_ms = 0;
+static bool s_batch_held = false;       // ingest task only
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+esp_err_t power_init(void)
+{
+    esp_err_t ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "clutch_active", &s_cpu_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create PM lock: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Hold the clock before scaling is enabled so boot never dips
+    atomic_store(&s_held, true);
+    atomic_store(&s_last_activity_ms, now_ms());
+    esp_pm_lock_acquire(s_cpu_lock);
+
+    const esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_CLUTCH_POWER_IDLE_FREQ_MHZ,
+        .light_sleep_enable = false,
+    };
+    ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Frequency scaling %d-%d MHz, idle after %d ms, wake budget %d us",
+             CONFIG_CLUTCH_POWER_IDLE_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             CONFIG_CLUTCH_POWER_ACTIVE_HOLD_MS, CONFIG_CLUTCH_POWER_WAKE_BUDGET_US);
+    return ESP_OK;
+}
+
+HOT_PATH_FN void power_note_activity(void)
+{
+    if (s_cpu_lock == NULL) {
+        return;
+    }
+
+    atomic_store_explicit(&s_last_activity_ms, now_ms(), memory_order_relaxed);
+    if (atomic_load_explicit(&s_held, memory_order_relaxed) ||
+        atomic_exchange(&s_held, true)) {
+        return;
+    }
+    esp_pm_lock_acquire(s_cpu_lock);
+}
+
+HOT_PATH_FN void power_ingest_begin(int64_t rx_time_us)
+{
+    if (s_cpu_lock == NULL || s_batch_held ||
+        atomic_load_explicit(&s_held, memory_order_relaxed)) {
+        return;
+    }
+    esp_pm_lock_acquire(s_cpu_lock);
+    s_batch_held = true;
+
+    int64_t wake_us = esp_timer_get_time() - rx_time_us;
+    uint32_t wake = wake_us < 0 ? 0 : wake_us > UINT32_MAX ? UINT32_MAX : (uint32_t)wake_us;
+    latency_stats_record(LATENCY_STAGE_CLOCK_WAKE, wake);
+    if (wake > CONFIG_CLUTCH_POWER_WAKE_BUDGET_US &&
+        atomic_fetch_add(&s_strikes, 1) + 1 >= CONFIG_CLUTCH_POWER_WAKE_STRIKES) {
+        atomic_store(&s_pinned, true);
+    }
+}
+
+HOT_PATH_FN void power_ingest_end(void)
+{
+    if (s_batch_held) {
+        s_batch_held = false;
+        esp_pm_lock_release(s_cpu_lock);
+    }
+}
+
+bool power_is_active(void)
+{
+    return atomic_load_explicit(&s_held, memory_order_relaxed);
+}
+
+bool power_is_pinned(void)
+{
+    return atomic_load_explicit(&s_pinned, memory_order_relaxed);
+}
+
+void task_power(void *arg)
+{
+    (void)arg;
+
+    bool pinned_logged = false;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(GOVERNOR_PERIOD_MS));
+
+        if (s_cpu_lock == NULL || !power_is_active()) {
+            continue;
+        }
+        if (power_is_pinned()) {
+            if (!pinned_logged) {
+                ESP_LOGW(TAG, "%u wakes over %d us: holding %d MHz until restart",
+                         atomic_load(&s_strikes), CONFIG_CLUTCH_POWER_WAKE_BUDGET_US,
+                         CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+                pinned_logged = true;
+            }
+            continue;
+        }
+
+        uint32_t idle_ms = now_ms() - atomic_load_explicit(&s_last_activity_ms,
+                                                           memory_order_relaxed);
+        if (idle_ms < CONFIG_CLUTCH_POWER_ACTIVE_HOLD_MS) {
+            continue;
+        }
+
+        atomic_store(&s_held, false);
+        esp_pm_lock_release(s_cpu_lock);
+
+        // Activity that saw the lock still held just before the release
+        idle_ms = now_ms() - atomic_load_explicit(&s_last_activity_ms, memory_order_relaxed);
+        if (idle_ms < CONFIG_CLUTCH_POWER_ACTIVE_HOLD_MS) {
+            power_note_activity();
+        }
+    }
+}
+
+#else /* !CONFIG_CLUTCH_POWER_MANAGEMENT */
+
+esp_err_t power_init(void)
+{
+    return ESP_OK;
+}
+
+HOT_PATH_FN void power_note_activity(void)
+{
+}
+
+HOT_PATH_FN void power_ingest_begin(int64_t rx_time_us)
+{
+    (void)rx_time_us;
+}
+
+HOT_PATH_FN void power_ingest_end(void)
+{
+}
+
+bool power_is_active(void)
+{
+    return true;
+}
+
+bool power_is_pinned(void)
+{
+    return false;
+}
+
+#endif /* CONFIG_CLUTCH_POWER_MANAGEMENT */
@@ -0,0 +1,141 @@
+/**
+ * @file radio_mode.c
+ * @brief Config / race mode persistence and switching
+ */
+
+#include "radio_mode.h"
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "RADIO_MODE";
+
+#define RADIO_NVS_NAMESPACE     "radio"
+#define RADIO_NVS_KEY           "mode"
+#define BUTTON_POLL_MS          50
+#define RESTART_DELAY_MS        200     // let the log and USB drain
+
+static radio_mode_t s_mode = RADIO_MODE_CONFIG;
+static atomic_int s_requested = -1;     // radio_mode_t, -1 if none
+static TaskHandle_t s_task = NULL;
+
+static const char *const s_mode_names[RADIO_MODE_COUNT] = {
+    [RADIO_MODE_CONFIG] = "config",
+    [RADIO_MODE_RACE]   = "race",
+};
+
+esp_err_t radio_mode_init(void)
+{
+    nvs_handle_t handle;
+    uint8_t stored = RADIO_MODE_CONFIG;
+
+    esp_err_t ret = nvs_open(RADIO_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_u8(handle, RADIO_NVS_KEY, &stored);
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to read stored mode: 0x%x", ret);
+    }
+
+    s_mode = stored < RADIO_MODE_COUNT ? (radio_mode_t)stored : RADIO_MODE_CONFIG;
+    ESP_LOGI(TAG, "Booting in %s mode", radio_mode_name(s_mode));
+    return ESP_OK;
+}
+
+radio_mode_t radio_mode_get(void)
+{
+    return s_mode;
+}
+
+const char *radio_mode_name(radio_mode_t mode)
+{
+    return mode < RADIO_MODE_COUNT ? s_mode_names[mode] : "?";
+}
+
+esp_err_t radio_mode_request(radio_mode_t mode)
+{
+    if (mode >= RADIO_MODE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode == s_mode) {
+        return ESP_OK;
+    }
+
+    atomic_store(&s_requested, (int)mode);
+    TaskHandle_t task = s_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+    return ESP_OK;
+}
+
+static void switch_mode(radio_mode_t mode)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(RADIO_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_u8(handle, RADIO_NVS_KEY, (uint8_t)mode);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save %s mode: 0x%x", radio_mode_name(mode), ret);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Switching to %s mode, restarting", radio_mode_name(mode));
+    vTaskDelay(pdMS_TO_TICKS(RESTART_DELAY_MS));
+    esp_restart();
+}
+
+void task_radio_mode(void *arg)
+{
+    (void)arg;
+
+    s_task = xTaskGetCurrentTaskHandle();
+
+#if CONFIG_CLUTCH_MODE_BUTTON_GPIO >= 0
+    const gpio_num_t button = (gpio_num_t)CONFIG_CLUTCH_MODE_BUTTON_GPIO;
+    const gpio_config_t io = {
+        .pin_bit_mask = 1ULL << button,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io));
+
+    uint32_t held_ms = 0;
+    const TickType_t wait_ticks = pdMS_TO_TICKS(BUTTON_POLL_MS);
+#else
+    const TickType_t wait_ticks = portMAX_DELAY;
+#endif
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait_ticks);
+
+        int requested = atomic_exchange(&s_requested, -1);
+        if (requested >= 0 && requested != (int)s_mode) {
+            switch_mode((radio_mode_t)requested);
+        }
+
+#if CONFIG_CLUTCH_MODE_BUTTON_GPIO >= 0
+        // Active low; a long press toggles, fires once per press
+        if (gpio_get_level(button) == 0) {
+            held_ms += BUTTON_POLL_MS;
+            if (held_ms >= CONFIG_CLUTCH_MODE_BUTTON_HOLD_MS &&
+                held_ms - BUTTON_POLL_MS < CONFIG_CLUTCH_MODE_BUTTON_HOLD_MS) {
+                switch_mode(s_mode == RADIO_MODE_RACE ? RADIO_MODE_CONFIG : RADIO_MODE_RACE);
+            }
+        } else {
+            held_ms = 0;
+        }
+#endif
+    }
+}
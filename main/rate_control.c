@@ -0,0 +1,209 @@
+/**
+ * @file rate_control.c
+ * @brief Adaptive transmit rate feedback implementation
+ *
+ * Loss per window comes from the link_quality counters of each sender.
+ * Windows with fewer than MIN_WINDOW_FRAMES frames (idle heartbeats) are
+ * too small to judge and leave the cap unchanged.
+ */
+
+#include "rate_control.h"
+#include "hot_path.h"
+#include "espnow_handler.h"
+#include "espnow_wire.h"
+#include "link_quality.h"
+#include "sender_registry.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "RATE_CTRL";
+
+#define WINDOW_MS               100
+#define MIN_WINDOW_FRAMES       10
+#define SENDER_TIMEOUT_MS       3000    // no feedback to senders that went quiet
+
+/* Per-sender state, rate task only */
+typedef struct {
+    uint32_t packets;       // link counters at the start of the window
+    uint32_t lost;
+    uint16_t cap_hz;        // congestion cap while active
+    uint16_t sent_hz;       // rate_hz of the last feedback, 0 = none yet
+    int64_t  sent_us;       // time of the last feedback
+    bool     peer_added;
+} rate_slot_t;
+
+static rate_slot_t s_slots[SENDER_REGISTRY_CAPACITY];
+
+/* Last output change per slot in ms (esp_timer time), written by ingest */
+static _Atomic uint32_t s_last_change_ms[SENDER_REGISTRY_CAPACITY];
+
+HOT_PATH_FN void rate_control_note_change(int sender, int64_t rx_time_us)
+{
+    if (sender < 0 || sender >= SENDER_REGISTRY_CAPACITY) {
+        return;
+    }
+    atomic_store_explicit(&s_last_change_ms[sender], (uint32_t)(rx_time_us / 1000),
+                          memory_order_relaxed);
+}
+
+#if CONFIG_CLUTCH_RATE_CONTROL
+
+_Static_assert(CONFIG_CLUTCH_RATE_IDLE_HZ < CONFIG_CLUTCH_RATE_ACTIVE_HZ,
+               "CONFIG_CLUTCH_RATE_IDLE_HZ must be below CONFIG_CLUTCH_RATE_ACTIVE_HZ");
+
+/* Halve on a lossy window, grow by a quarter on a clean one */
+static void update_cap(rate_slot_t *slot, uint32_t loss_permille)
+{
+    uint32_t cap = slot->cap_hz;
+
+    if (loss_permille > CONFIG_CLUTCH_RATE_BACKOFF_LOSS_PERMILLE) {
+        cap /= 2;
+    } else if (loss_permille <= CONFIG_CLUTCH_RATE_BACKOFF_LOSS_PERMILLE / 4) {
+        cap += cap / 4 + 1;
+    }
+
+    if (cap < CONFIG_CLUTCH_RATE_IDLE_HZ) cap = CONFIG_CLUTCH_RATE_IDLE_HZ;
+    if (cap > CONFIG_CLUTCH_RATE_ACTIVE_HZ) cap = CONFIG_CLUTCH_RATE_ACTIVE_HZ;
+    slot->cap_hz = (uint16_t)cap;
+}
+
+static void evaluate(int sender, const link_quality_entry_t *link, int64_t now_us)
+{
+    rate_slot_t *slot = &s_slots[sender];
+    uint32_t now_ms = (uint32_t)(now_us / 1000);
+
+    uint32_t packets = link->packets - slot->packets;
+    uint32_t lost = link->lost - slot->lost;
+    slot->packets = link->packets;
+    slot->lost = link->lost;
+
+    uint32_t loss_permille = link->loss_permille;
+    if (packets + lost >= MIN_WINDOW_FRAMES) {
+        loss_permille = lost * 1000 / (packets + lost);
+        update_cap(slot, loss_permille);
+    }
+
+    // Quiet senders are off or on another channel; do not spend airtime on them
+    if (!link->sequenced || now_us - link->last_rx_us > SENDER_TIMEOUT_MS * 1000LL) {
+        return;
+    }
+
+    uint32_t since_change = now_ms -
+        atomic_load_explicit(&s_last_change_ms[sender], memory_order_relaxed);
+    uint16_t rate_hz = since_change < CONFIG_CLUTCH_RATE_IDLE_AFTER_MS
+                       ? slot->cap_hz : CONFIG_CLUTCH_RATE_IDLE_HZ;
+
+    if (rate_hz == slot->sent_hz &&
+        now_us - slot->sent_us < CONFIG_CLUTCH_RATE_REFRESH_MS * 1000LL) {
+        return;
+    }
+
+    if (!slot->peer_added) {
+        esp_err_t ret = espnow_handler_add_peer(link->mac);
+        if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST) {
+            return;
+        }
+        slot->peer_added = true;
+    }
+
+    const espnow_wire_rate_t body = {
+        .rate_hz = rate_hz,
+        .burst_hz = slot->cap_hz,
+        .loss_permille = (uint16_t)(loss_permille > 1000 ? 1000 : loss_permille),
+        .rssi_dbm = link->rssi_avg,
+    };
+    esp_err_t ret = espnow_handler_send_wire(link->mac, ESPNOW_WIRE_TYPE_RATE,
+                                             &body, sizeof(body));
+    if (ret != ESP_OK) {
+        return;     // retried next window
+    }
+
+    if (rate_hz != slot->sent_hz) {
+        ESP_LOGD(TAG, "..:%02x:%02x:%02x -> %u Hz (cap %u, loss %lu permille)",
+                 link->mac[3], link->mac[4], link->mac[5], rate_hz, slot->cap_hz,
+                 (unsigned long)loss_permille);
+    }
+    slot->sent_hz = rate_hz;
+    slot->sent_us = now_us;
+}
+
+int rate_control_format_json(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    int n = snprintf(buf, len, "[");
+    pos = (n > 0) ? (size_t)n : 0;
+
+    sender_info_t info;
+    bool first = true;
+    for (size_t i = 0; pos < len && sender_registry_get(i, &info) == ESP_OK; i++) {
+        int sender = sender_registry_lookup(info.mac);
+        if (sender < 0) {
+            continue;
+        }
+        const rate_slot_t *slot = &s_slots[sender];
+        n = snprintf(buf + pos, len - pos,
+                     "%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"rate_hz\":%u,"
+                     "\"cap_hz\":%u}",
+                     first ? "" : ",",
+                     info.mac[0], info.mac[1], info.mac[2],
+                     info.mac[3], info.mac[4], info.mac[5],
+                     slot->sent_hz, slot->cap_hz);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+        first = false;
+    }
+
+    if (pos < len) {
+        n = snprintf(buf + pos, len - pos, "]");
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    return (int)(pos < len ? pos : len - 1);
+}
+
+void task_rate_control(void *arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < SENDER_REGISTRY_CAPACITY; i++) {
+        s_slots[i].cap_hz = CONFIG_CLUTCH_RATE_ACTIVE_HZ;
+    }
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(WINDOW_MS));
+
+        int64_t now_us = esp_timer_get_time();
+        sender_info_t info;
+        link_quality_entry_t link;
+        for (size_t i = 0; sender_registry_get(i, &info) == ESP_OK; i++) {
+            int sender = sender_registry_lookup(info.mac);
+            if (sender >= 0 && link_quality_find(info.mac, &link) == ESP_OK) {
+                evaluate(sender, &link, now_us);
+            }
+        }
+    }
+}
+
+#else /* !CONFIG_CLUTCH_RATE_CONTROL */
+
+int rate_control_format_json(char *buf, size_t len)
+{
+    return (buf != NULL && len > 1) ? snprintf(buf, len, "[]") : 0;
+}
+
+#endif /* CONFIG_CLUTCH_RATE_CONTROL */
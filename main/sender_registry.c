@@ -0,0 +1,439 @@
+/**
+ * @file sender_registry.c
+ * @brief Open-addressed sender registry implementation
+ *
+ * Linear probing on an FNV-1a hash of the MAC. At most 3/4 of the slots
+ * hold a sender, so the expected probe count stays constant. A bitmap of
+ * registered slots keeps the per-report merge proportional to the number
+ * of senders instead of the table size.
+ *
+ * Sender state is handed to the HID reporter through a triple buffer per
+ * slot: the ingest task fills its back buffer and swaps it with the
+ * middle one, the reporter swaps middle and front when the middle holds a
+ * newer snapshot. Each side owns its buffer between swaps, so a report
+ * never mixes fields of two packets and neither side ever waits.
+ *
+ * Unregistering leaves the slot in the probe chains as a tombstone, so
+ * the chains through it stay intact. Once the remove hook has cleared the
+ * state kept per slot elsewhere, the registry publishes an empty state and
+ * the tombstone goes to the next sender inserted along a chain through
+ * it: the same MAC, or a new one. A tombstone right before an empty slot
+ * ends every chain through it and becomes empty again. A MAC is written
+ * under a sequence count (odd while it changes), so lock-free probes never
+ * match a MAC half written. Slot buffers are never reinitialized after
+ * boot: a free slot still holds the empty state published on unregister.
+ */
+
+#include "sender_registry.h"
+#include "hot_path.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+static const char *TAG = "SENDER_REGISTRY";
+
+_Static_assert((SENDER_REGISTRY_CAPACITY & (SENDER_REGISTRY_CAPACITY - 1)) == 0,
+               "CONFIG_CLUTCH_SENDER_REGISTRY_CAPACITY must be a power of two");
+
+#define SENDER_REGISTRY_MASK    (SENDER_REGISTRY_CAPACITY - 1)
+#define SENDER_REGISTRY_MAX_USED (SENDER_REGISTRY_CAPACITY * 3 / 4)
+#define LIVE_WORDS              ((SENDER_REGISTRY_CAPACITY + 31) / 32)
+
+#define SNAPSHOT_INDEX  0x03
+#define SNAPSHOT_FRESH  0x04            // middle holds an unread snapshot
+
+typedef struct {
+    uint8_t mac[6];
+    _Atomic uint32_t mac_seq;           // odd while mac and removed change together
+    atomic_bool in_use;                 // published last on insert
+    atomic_bool removed;                // unregistered, kept as a tombstone
+    atomic_bool retiring;               // remove hook still running
+    bool auto_added;
+    _Atomic uint32_t field_mask;
+    sender_state_t work;                // ingest task's working copy
+    sender_state_t snapshots[3];
+    _Atomic uint8_t middle;             // SNAPSHOT_INDEX | SNAPSHOT_FRESH
+    uint8_t back;                       // owned by the ingest task
+    uint8_t front;                      // owned by the HID reporter
+} sender_slot_t;
+
+static sender_slot_t s_slots[SENDER_REGISTRY_CAPACITY];
+static atomic_uint s_live[LIVE_WORDS];  // one bit per registered slot
+static portMUX_TYPE s_insert_lock = portMUX_INITIALIZER_UNLOCKED;
+static sender_registry_remove_hook_t s_remove_hook = NULL;
+
+static inline uint32_t mac_hash(const uint8_t *mac)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Whether a used slot holds mac, and its removed flag read with it */
+static HOT_PATH_FN bool slot_holds(const sender_slot_t *slot, const uint8_t *mac, bool *removed)
+{
+    uint32_t seq;
+    bool match;
+
+    do {
+        seq = atomic_load_explicit(&slot->mac_seq, memory_order_acquire);
+        match = memcmp(slot->mac, mac, 6) == 0;
+        *removed = atomic_load_explicit(&slot->removed, memory_order_acquire);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&slot->mac_seq, memory_order_relaxed));
+
+    return match;
+}
+
+/* Returns the slot holding mac, or the empty slot where it would go. With
+ * tombstone set, also the first tombstone passed that can take a new MAC. */
+static HOT_PATH_FN int probe(const uint8_t *mac, bool *found, bool *removed, int *tombstone)
+{
+    uint32_t i = mac_hash(mac) & SENDER_REGISTRY_MASK;
+
+    for (int n = 0; n < SENDER_REGISTRY_CAPACITY; n++) {
+        sender_slot_t *slot = &s_slots[i];
+        if (!atomic_load_explicit(&slot->in_use, memory_order_acquire)) {
+            *found = false;
+            return (int)i;
+        }
+        if (slot_holds(slot, mac, removed)) {
+            *found = true;
+            return (int)i;
+        }
+        if (tombstone != NULL && *tombstone < 0 && *removed &&
+            !atomic_load(&slot->retiring)) {
+            *tombstone = (int)i;
+        }
+        i = (i + 1) & SENDER_REGISTRY_MASK;
+    }
+
+    *found = false;
+    return -1;
+}
+
+static unsigned count_live(void)
+{
+    unsigned count = 0;
+    for (int w = 0; w < LIVE_WORDS; w++) {
+        count += (unsigned)__builtin_popcount(atomic_load(&s_live[w]));
+    }
+    return count;
+}
+
+static inline void set_live(int i, bool live)
+{
+    uint32_t bit = 1u << (i % 32);
+    if (live) {
+        atomic_fetch_or_explicit(&s_live[i / 32], bit, memory_order_release);
+    } else {
+        atomic_fetch_and_explicit(&s_live[i / 32], ~bit, memory_order_release);
+    }
+}
+
+/* Give a tombstone or free slot to mac; its state is already empty */
+static void claim(sender_slot_t *slot, const uint8_t *mac, uint32_t field_mask, bool auto_added)
+{
+    uint32_t seq = atomic_load(&slot->mac_seq);
+    atomic_store_explicit(&slot->mac_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(slot->mac, mac, 6);
+    slot->auto_added = auto_added;
+    atomic_store(&slot->field_mask, field_mask);
+    atomic_store(&slot->retiring, false);
+    atomic_store(&slot->removed, false);
+    atomic_store_explicit(&slot->mac_seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&slot->in_use, true, memory_order_release);
+    set_live((int)(slot - s_slots), true);
+}
+
+static int insert(const uint8_t *mac, uint32_t field_mask, bool auto_added)
+{
+    int index = -1;
+
+    portENTER_CRITICAL(&s_insert_lock);
+
+    bool found, removed;
+    int tombstone = -1;
+    int i = probe(mac, &found, &removed, &tombstone);
+    if (found && !removed) {
+        atomic_store(&s_slots[i].field_mask, field_mask);
+        if (!auto_added) {
+            s_slots[i].auto_added = false;
+        }
+        index = i;
+    } else if (count_live() >= SENDER_REGISTRY_MAX_USED) {
+        // Full
+    } else if (found && atomic_load(&s_slots[i].retiring)) {
+        // Revived only once the remove hook has let go of the slot
+    } else if (found) {
+        atomic_store(&s_slots[i].field_mask, field_mask);
+        s_slots[i].auto_added = auto_added;
+        atomic_store_explicit(&s_slots[i].removed, false, memory_order_release);
+        set_live(i, true);
+        index = i;
+    } else if (tombstone >= 0 || i >= 0) {
+        // A tombstone on the chain keeps it short. Without one the chain
+        // ends at an empty slot; a chain with no empty slot spans the
+        // table, so it passes a tombstone (fewer than 3/4 are registered)
+        index = tombstone >= 0 ? tombstone : i;
+        claim(&s_slots[index], mac, field_mask, auto_added);
+    }
+
+    portEXIT_CRITICAL(&s_insert_lock);
+    return index;
+}
+
+/* Free the tombstones ending a chain, walking back from slot i */
+static void free_chain_end(int i)
+{
+    for (int n = 0; n < SENDER_REGISTRY_CAPACITY; n++) {
+        const sender_slot_t *slot = &s_slots[i];
+        const sender_slot_t *next = &s_slots[(i + 1) & SENDER_REGISTRY_MASK];
+        if (!atomic_load(&slot->in_use) || !atomic_load(&slot->removed) ||
+            atomic_load(&slot->retiring) || atomic_load(&next->in_use)) {
+            return;
+        }
+        atomic_store_explicit(&s_slots[i].in_use, false, memory_order_release);
+        i = (i - 1) & SENDER_REGISTRY_MASK;
+    }
+}
+
+esp_err_t sender_registry_init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+    for (int i = 0; i < SENDER_REGISTRY_CAPACITY; i++) {
+        s_slots[i].back = 0;
+        atomic_store(&s_slots[i].middle, 1);
+        s_slots[i].front = 2;
+    }
+    for (int w = 0; w < LIVE_WORDS; w++) {
+        atomic_store(&s_live[w], 0);
+    }
+
+    ESP_LOGI(TAG, "Sender registry ready (%d senders max)", SENDER_REGISTRY_MAX_USED);
+    return ESP_OK;
+}
+
+esp_err_t sender_registry_register(const uint8_t *mac, uint32_t field_mask)
+{
+    if (mac == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (insert(mac, field_mask & SENDER_FIELDS_ALL, false) < 0) {
+        ESP_LOGE(TAG, "Registry full or sender being removed, cannot add sender");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sender_registry_unregister(const uint8_t *mac)
+{
+    if (mac == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_insert_lock);
+    bool found, removed;
+    int i = probe(mac, &found, &removed, NULL);
+    if (found && !removed) {
+        atomic_store(&s_slots[i].retiring, true);
+        atomic_store(&s_slots[i].field_mask, 0);
+        atomic_store_explicit(&s_slots[i].removed, true, memory_order_release);
+        set_live(i, false);
+    } else {
+        i = -1;
+    }
+    portEXIT_CRITICAL(&s_insert_lock);
+
+    if (i < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Lookups no longer find the slot; let its per-slot state go
+    if (s_remove_hook != NULL) {
+        s_remove_hook(i);
+    }
+
+    // The ingest task is done with the slot: start whoever gets it next
+    // from an empty state, handed to the reporter like any other snapshot
+    sender_state_t *st = &s_slots[i].work;
+    uint32_t version = st->version;
+    memset(st, 0, sizeof(*st));
+    st->version = version;
+    sender_registry_publish(i);
+
+    portENTER_CRITICAL(&s_insert_lock);
+    atomic_store_explicit(&s_slots[i].retiring, false, memory_order_release);
+    free_chain_end(i);
+    portEXIT_CRITICAL(&s_insert_lock);
+    return ESP_OK;
+}
+
+void sender_registry_set_remove_hook(sender_registry_remove_hook_t hook)
+{
+    s_remove_hook = hook;
+}
+
+HOT_PATH_FN int sender_registry_lookup(const uint8_t *mac)
+{
+    bool found, removed;
+    int i = probe(mac, &found, &removed, NULL);
+    if (!found || removed) {
+        return -1;
+    }
+    return i;
+}
+
+HOT_PATH_FN int sender_registry_acquire(const uint8_t *mac)
+{
+    int i = sender_registry_lookup(mac);
+    if (i >= 0) {
+        return i;
+    }
+
+#if CONFIG_CLUTCH_SENDER_AUTO_REGISTER
+    return insert(mac, SENDER_FIELDS_ALL, true);
+#else
+    return -1;
+#endif
+}
+
+HOT_PATH_FN uint32_t sender_registry_field_mask(int slot)
+{
+    return atomic_load_explicit(&s_slots[slot].field_mask, memory_order_relaxed);
+}
+
+HOT_PATH_FN sender_state_t *sender_registry_state(int slot)
+{
+    return &s_slots[slot].work;
+}
+
+HOT_PATH_FN void sender_registry_publish(int slot)
+{
+    sender_slot_t *s = &s_slots[slot];
+
+    s->work.version++;
+    s->snapshots[s->back] = s->work;
+    uint8_t prev = atomic_exchange_explicit(&s->middle, s->back | SNAPSHOT_FRESH,
+                                            memory_order_acq_rel);
+    s->back = prev & SNAPSHOT_INDEX;
+}
+
+/* Newest published state of a slot (HID reporter only) */
+static HOT_PATH_FN const sender_state_t *snapshot(sender_slot_t *s)
+{
+    if (atomic_load_explicit(&s->middle, memory_order_relaxed) & SNAPSHOT_FRESH) {
+        uint8_t prev = atomic_exchange_explicit(&s->middle, s->front, memory_order_acq_rel);
+        s->front = prev & SNAPSHOT_INDEX;
+    }
+    return &s->snapshots[s->front];
+}
+
+#if CONFIG_CLUTCH_AXIS_PREDICTOR
+static HOT_PATH_FN uint16_t predict_right(const sender_state_t *st, int64_t now_us)
+{
+    int64_t age = now_us - st->rx_time_us;
+    if (age <= 0) {
+        return st->right_clutch;
+    }
+    return axis_predictor_extrapolate(st->right_clutch, st->right_motion,
+                                      age > UINT32_MAX ? UINT32_MAX : (uint32_t)age,
+                                      CONFIG_CLUTCH_PREDICT_HORIZON_MS * 1000,
+                                      CONFIG_CLUTCH_PREDICT_TIMEOUT_MS * 1000);
+}
+#endif
+
+HOT_PATH_FN void sender_registry_merge(sender_state_t *merged, int64_t now_us)
+{
+    memset(merged, 0, sizeof(*merged));
+
+    for (int w = 0; w < LIVE_WORDS; w++) {
+        uint32_t live = atomic_load_explicit(&s_live[w], memory_order_acquire);
+        while (live != 0) {
+            sender_slot_t *slot = &s_slots[w * 32 + __builtin_ctz(live)];
+            live &= live - 1;
+
+            const sender_state_t *st = snapshot(slot);
+            uint32_t mask = atomic_load_explicit(&slot->field_mask, memory_order_relaxed);
+
+            if ((mask & SENDER_FIELD_LEFT_CLUTCH) && st->left_pressed) {
+                merged->left_pressed = true;
+            }
+            if (mask & SENDER_FIELD_RIGHT_CLUTCH) {
+#if CONFIG_CLUTCH_AXIS_PREDICTOR
+                uint16_t right = predict_right(st, now_us);
+#else
+                uint16_t right = st->right_clutch;
+#endif
+                if (right > merged->right_clutch) {
+                    merged->right_clutch = right;
+                }
+            }
+            for (int a = 0; a < USB_HID_AUX_AXIS_COUNT; a++) {
+                if ((mask & SENDER_FIELD_AUX(a)) && st->aux[a] > merged->aux[a]) {
+                    merged->aux[a] = st->aux[a];
+                }
+            }
+            if (mask & SENDER_FIELD_BUTTONS) {
+                merged->buttons |= st->buttons;
+            }
+            if (st->rx_time_us > merged->rx_time_us) {
+                merged->rx_time_us = st->rx_time_us;
+            }
+            merged->version += st->version;
+        }
+    }
+}
+
+HOT_PATH_FN uint16_t sender_registry_max_right_clutch(void)
+{
+    uint16_t right = 0;
+
+    for (int w = 0; w < LIVE_WORDS; w++) {
+        uint32_t live = atomic_load_explicit(&s_live[w], memory_order_acquire);
+        while (live != 0) {
+            const sender_slot_t *slot = &s_slots[w * 32 + __builtin_ctz(live)];
+            live &= live - 1;
+
+            uint32_t mask = atomic_load_explicit(&slot->field_mask, memory_order_relaxed);
+            if ((mask & SENDER_FIELD_RIGHT_CLUTCH) && slot->work.right_clutch > right) {
+                right = slot->work.right_clutch;
+            }
+        }
+    }
+    return right;
+}
+
+size_t sender_registry_count(void)
+{
+    return count_live();
+}
+
+esp_err_t sender_registry_get(size_t index, sender_info_t *info)
+{
+    if (info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int w = 0; w < LIVE_WORDS; w++) {
+        uint32_t live = atomic_load_explicit(&s_live[w], memory_order_acquire);
+        while (live != 0) {
+            const sender_slot_t *slot = &s_slots[w * 32 + __builtin_ctz(live)];
+            live &= live - 1;
+            if (index-- != 0) {
+                continue;
+            }
+            memcpy(info->mac, slot->mac, 6);
+            info->field_mask = atomic_load(&slot->field_mask);
+            info->auto_added = slot->auto_added;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file telemetry.c
+ * @brief Binary telemetry stream implementation
+ *
+ * Producers: ingest task (samples), HID reporter (reports), telemetry
+ * task (link/status). The ring is a byte buffer with free-running
+ * head/tail offsets under a spinlock held for one frame copy; frames are
+ * never split across a drop, so the stream stays decodable.
+ *
+ * The telemetry task tracks the host's DTR: frames are only queued while
+ * the port is open, and the ring is emptied when it closes so a new
+ * session starts at a frame boundary. A capture dump is cut short then.
+ */
+
+#include "telemetry.h"
+#include "hot_path.h"
+#include "sdkconfig.h"
+
+#if CONFIG_CLUTCH_USB_TELEMETRY
+
+#include "capture.h"
+#include "data_processor.h"
+#include "ingest.h"
+#include "link_quality.h"
+#include "sender_registry.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "tusb.h"
+
+static const char *TAG = "TELEMETRY";
+
+#define TELEMETRY_CDC_ITF       0
+#define FLUSH_MS                2
+#define PERIODIC_MS             1000
+#define DRAIN_CHUNK             256
+#define FRAME_OVERHEAD          5       // sync, type, len, seq, checksum
+
+// The offsets wrap at 2^32, which only lands on a ring boundary if the
+// ring size divides it
+_Static_assert((CONFIG_CLUTCH_TELEMETRY_BUFFER_SIZE & (CONFIG_CLUTCH_TELEMETRY_BUFFER_SIZE - 1)) == 0,
+               "CONFIG_CLUTCH_TELEMETRY_BUFFER_SIZE must be a power of two");
+
+static uint8_t s_ring[CONFIG_CLUTCH_TELEMETRY_BUFFER_SIZE];
+static uint32_t s_head = 0;             // free-running byte offsets, under s_lock
+static uint32_t s_tail = 0;
+static uint8_t s_seq = 0;
+static uint32_t s_dropped = 0;          // under s_lock
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static atomic_bool s_active = false;
+
+/* Capture dump: requested from any task, run by the telemetry task */
+static atomic_bool s_dump_requested = false;
+static atomic_bool s_dump_active = false;
+static uint32_t s_dump_offset = 0;
+
+static HOT_PATH_FN void ring_write(uint32_t offset, const void *src, uint32_t len)
+{
+    uint32_t at = offset % sizeof(s_ring);
+    uint32_t first = len < sizeof(s_ring) - at ? len : sizeof(s_ring) - at;
+    memcpy(s_ring + at, src, first);
+    memcpy(s_ring, (const uint8_t *)src + first, len - first);
+}
+
+esp_err_t telemetry_init(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_head = 0;
+    s_tail = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Telemetry on CDC interface (%u-byte ring)",
+             (unsigned)sizeof(s_ring));
+    return ESP_OK;
+}
+
+HOT_PATH_FN bool telemetry_is_active(void)
+{
+    return atomic_load_explicit(&s_active, memory_order_relaxed);
+}
+
+HOT_PATH_FN void telemetry_emit(telemetry_frame_type_t type, const void *payload, uint8_t len)
+{
+    if (!telemetry_is_active()) {
+        return;
+    }
+
+    // Build outside the lock; only seq is filled in under it
+    uint8_t frame[FRAME_OVERHEAD + UINT8_MAX];
+    frame[0] = TELEMETRY_SYNC;
+    frame[1] = (uint8_t)type;
+    frame[2] = len;
+    memcpy(&frame[4], payload, len);
+    uint8_t checksum = frame[1] ^ frame[2];
+    for (uint32_t i = 0; i < len; i++) {
+        checksum ^= frame[4 + i];
+    }
+    uint32_t total = FRAME_OVERHEAD + len;
+
+    portENTER_CRITICAL(&s_lock);
+    if (sizeof(s_ring) - (s_head - s_tail) < total) {
+        s_dropped++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    frame[3] = s_seq++;
+    frame[total - 1] = checksum ^ frame[3];
+    ring_write(s_head, frame, total);
+    s_head += total;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t telemetry_get_dropped_count(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t dropped = s_dropped;
+    portEXIT_CRITICAL(&s_lock);
+    return dropped;
+}
+
+/* Move as much of the ring as the CDC FIFO takes */
+static void drain(void)
+{
+    uint8_t chunk[DRAIN_CHUNK];
+    bool wrote = false;
+
+    while (1) {
+        uint32_t room = tud_cdc_n_write_available(TELEMETRY_CDC_ITF);
+        if (room > sizeof(chunk)) room = sizeof(chunk);
+
+        portENTER_CRITICAL(&s_lock);
+        uint32_t used = s_head - s_tail;
+        uint32_t n = used < room ? used : room;
+        uint32_t at = s_tail % sizeof(s_ring);
+        uint32_t first = n < sizeof(s_ring) - at ? n : sizeof(s_ring) - at;
+        memcpy(chunk, s_ring + at, first);
+        memcpy(chunk + first, s_ring, n - first);
+        s_tail += n;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (n == 0) break;
+        tud_cdc_n_write(TELEMETRY_CDC_ITF, chunk, n);
+        wrote = true;
+    }
+
+    if (wrote) {
+        tud_cdc_n_write_flush(TELEMETRY_CDC_ITF);
+    }
+}
+
+esp_err_t telemetry_request_capture_dump(void)
+{
+    capture_stats_t cap;
+    capture_get_stats(&cap);
+    if (cap.capacity == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    atomic_store(&s_dump_requested, true);
+    return ESP_OK;
+}
+
+bool telemetry_capture_dump_active(void)
+{
+    return atomic_load(&s_dump_requested) || atomic_load(&s_dump_active);
+}
+
+/* Next CAPTURE frames of a dump, only into the free half of the ring */
+static void dump_capture(void)
+{
+    if (atomic_exchange(&s_dump_requested, false)) {
+        s_dump_offset = 0;
+        atomic_store(&s_dump_active, true);
+        ESP_LOGI(TAG, "Sending the capture");
+    }
+    if (!atomic_load(&s_dump_active)) {
+        return;
+    }
+
+    telemetry_capture_t chunk;
+    while (1) {
+        portENTER_CRITICAL(&s_lock);
+        uint32_t used = s_head - s_tail;
+        portEXIT_CRITICAL(&s_lock);
+        if (used + FRAME_OVERHEAD + sizeof(chunk) > sizeof(s_ring) / 2) {
+            return;
+        }
+
+        size_t n = capture_read(s_dump_offset, chunk.data, sizeof(chunk.data));
+        chunk.offset = s_dump_offset;
+        telemetry_emit(TELEMETRY_FRAME_CAPTURE, &chunk,
+                       (uint8_t)(offsetof(telemetry_capture_t, data) + n));
+        s_dump_offset += n;
+        if (n == 0) {
+            atomic_store(&s_dump_active, false);
+            ESP_LOGI(TAG, "Capture sent (%lu bytes)", (unsigned long)s_dump_offset);
+            return;
+        }
+    }
+}
+
+static void emit_periodic(void)
+{
+    sender_info_t info;
+    link_quality_entry_t link;
+    for (size_t i = 0; sender_registry_get(i, &info) == ESP_OK; i++) {
+        if (link_quality_find(info.mac, &link) != ESP_OK) {
+            continue;
+        }
+        telemetry_link_t body = {
+            .rssi_avg = link.rssi_avg,
+            .packets = link.packets,
+            .lost = link.lost,
+            .interval_us = link.interval_us,
+            .jitter_us = link.jitter_us,
+            .loss_permille = link.loss_permille,
+        };
+        memcpy(body.mac, link.mac, sizeof(body.mac));
+        telemetry_emit(TELEMETRY_FRAME_LINK, &body, sizeof(body));
+    }
+
+    ingest_stats_t ring;
+    ingest_get_stats(&ring);
+    const telemetry_status_t status = {
+        .t_us = (uint32_t)esp_timer_get_time(),
+        .dropped = telemetry_get_dropped_count(),
+        .ingest_overflows = ring.overflows,
+        .discarded = data_processor_get_discarded_count(),
+        .free_heap = esp_get_free_heap_size(),
+    };
+    telemetry_emit(TELEMETRY_FRAME_STATUS, &status, sizeof(status));
+}
+
+void task_telemetry(void *arg)
+{
+    (void)arg;
+
+    TickType_t last_periodic = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(FLUSH_MS));
+
+        bool open = tud_cdc_n_connected(TELEMETRY_CDC_ITF);
+        if (open != telemetry_is_active()) {
+            atomic_store(&s_active, open);
+            if (!open) {
+                portENTER_CRITICAL(&s_lock);
+                s_tail = s_head;
+                portEXIT_CRITICAL(&s_lock);
+                atomic_store(&s_dump_active, false);
+            }
+            ESP_LOGI(TAG, "Host %s the telemetry port", open ? "opened" : "closed");
+        }
+        if (!open) {
+            continue;
+        }
+
+        if (xTaskGetTickCount() - last_periodic >= pdMS_TO_TICKS(PERIODIC_MS)) {
+            last_periodic = xTaskGetTickCount();
+            emit_periodic();
+        }
+        dump_capture();
+        drain();
+    }
+}
+
+#else /* !CONFIG_CLUTCH_USB_TELEMETRY */
+
+esp_err_t telemetry_init(void)
+{
+    return ESP_OK;
+}
+
+HOT_PATH_FN bool telemetry_is_active(void)
+{
+    return false;
+}
+
+HOT_PATH_FN void telemetry_emit(telemetry_frame_type_t type, const void *payload, uint8_t len)
+{
+    (void)type;
+    (void)payload;
+    (void)len;
+}
+
+uint32_t telemetry_get_dropped_count(void)
+{
+    return 0;
+}
+
+esp_err_t telemetry_request_capture_dump(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool telemetry_capture_dump_active(void)
+{
+    return false;
+}
+
+#endif /* CONFIG_CLUTCH_USB_TELEMETRY */
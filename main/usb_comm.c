@@ -1,9 +1,18 @@
 #include "usb_comm.h"
+#include "hot_path.h"
 #include "shared_state.h"
+#include "latency_stats.h"
+#include "sender_registry.h"
+#include "boot_trace.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "power.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "tinyusb.h"
 #include "class/hid/hid_device.h"
 #include "tusb.h"
@@ -11,62 +20,140 @@
 static const char *TAG = "USB_HID";
 
 static bool s_is_mounted = false;
+static bool s_mount_traced = false;     // boot_trace marks the first mount only
 static usb_hid_gamepad_report_t s_report = {0};
 
-/* g_right_clutch_value: written by data_processor, read by this task */
+/* Reporter task handle — target of usb_comm_notify_report() */
+static TaskHandle_t s_reporter_task = NULL;
+/* Set while a report is waiting for the IN endpoint to become free */
+static volatile bool s_report_pending = false;
+
+/* Feature report handlers and the last command received */
+static usb_feature_set_cb_t s_feature_set_cb = NULL;
+static usb_feature_get_cb_t s_feature_get_cb = NULL;
+static uint8_t s_feature_command = USB_HID_CMD_NONE;
+
+/* HID endpoint polling interval (bInterval), fixed once the driver is installed */
+static uint8_t s_poll_interval_ms = CONFIG_CLUTCH_HID_POLL_INTERVAL_MS;
+static bool s_is_installed = false;
+
+/* Previous changed report, for the report_jitter stage (reporter task only) */
+static int64_t s_last_report_us = 0;
+#define JITTER_STREAM_INTERVALS 4
+
+/* g_right_clutch_value: written by data_processor for the clutch engine,
+ * the largest right clutch of all senders mapped to it;
+ * the report itself is merged from the sender registry */
 volatile uint16_t g_right_clutch_value = 0;
 
+#if CONFIG_CLUTCH_USB_TELEMETRY
+#define TUSB_DESC_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_CDC_DESC_LEN)
+#else
 #define TUSB_DESC_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
+#endif
 
 enum {
     ITF_NUM_HID = 0,
+#if CONFIG_CLUTCH_USB_TELEMETRY
+    ITF_NUM_CDC,            // telemetry (telemetry.h): control + data interfaces
+    ITF_NUM_CDC_DATA,
+#endif
     ITF_NUM_TOTAL
 };
 
+/* HID IN is 0x81; the telemetry CDC uses endpoints 2 and 3 */
+#define EPNUM_CDC_NOTIF     0x82
+#define EPNUM_CDC_OUT       0x03
+#define EPNUM_CDC_IN        0x83
+#define CDC_EP_SIZE         64
+
 /*
- * HID Report Descriptor — Gamepad with 2 analog axes (no buttons):
- *   Usage X  (0x30) : right clutch paddle  (0-65535, 16-bit)
- *   Usage Y  (0x31) : virtual clutch axis  (0-65535, 16-bit)
+ * HID Report Descriptor — Gamepad generated from USB_HID_AXES:
+ *   one Input item covering every 16-bit axis (usages in table order),
+ *   then USB_HID_BUTTON_COUNT 1-bit buttons and constant padding up to
+ *   the size of usb_hid_buttons_t.
  */
+#define HID_AXIS_USAGE(field, id, usage) 0x09, usage,
+#define HID_BUTTON_PAD_BITS (USB_HID_BUTTON_BITS - USB_HID_BUTTON_COUNT)
+
 static const uint8_t hid_report_descriptor[] = {
     0x05, 0x01,             // Usage Page (Generic Desktop)
     0x09, 0x05,             // Usage (Game Pad)
     0xA1, 0x01,             // Collection (Application)
 
-    /* X axis — right clutch paddle */
-    0x09, 0x30,             //   Usage (X)
+    /* Axes */
+    USB_HID_AXES(HID_AXIS_USAGE)
     0x15, 0x00,             //   Logical Minimum (0)
     0x27, 0xFF, 0xFF, 0x00, 0x00,  // Logical Maximum (65535)
     0x75, 0x10,             //   Report Size (16 bits)
-    0x95, 0x01,             //   Report Count (1)
+    0x95, USB_HID_AXIS_COUNT,      // Report Count
     0x81, 0x02,             //   Input (Data, Variable, Absolute)
 
-    /* Y axis — virtual clutch engine */
-    0x09, 0x31,             //   Usage (Y)
+    /* Buttons */
+    0x05, 0x09,             //   Usage Page (Button)
+    0x19, 0x01,             //   Usage Minimum (1)
+    0x29, USB_HID_BUTTON_COUNT,    // Usage Maximum
     0x15, 0x00,             //   Logical Minimum (0)
-    0x27, 0xFF, 0xFF, 0x00, 0x00,  // Logical Maximum (65535)
-    0x75, 0x10,             //   Report Size (16 bits)
-    0x95, 0x01,             //   Report Count (1)
+    0x25, 0x01,             //   Logical Maximum (1)
+    0x75, 0x01,             //   Report Size (1 bit)
+    0x95, USB_HID_BUTTON_COUNT,    // Report Count
     0x81, 0x02,             //   Input (Data, Variable, Absolute)
+#if HID_BUTTON_PAD_BITS > 0
+    0x75, 0x01,             //   Report Size (1 bit)
+    0x95, HID_BUTTON_PAD_BITS,     // Report Count (padding)
+    0x81, 0x01,             //   Input (Constant)
+#endif
+
+    /* Vendor control channel: usb_hid_feature_report_t */
+    0x06, 0x00, 0xFF,       //   Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x01,             //   Usage (Vendor 1)
+    0x15, 0x00,             //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,       //   Logical Maximum (255)
+    0x75, 0x08,             //   Report Size (8 bits)
+    0x95, sizeof(usb_hid_feature_report_t),  // Report Count
+    0xB1, 0x02,             //   Feature (Data, Variable, Absolute)
 
     0xC0                    // End Collection
 };
+#undef HID_AXIS_USAGE
 
-static const uint8_t hid_configuration_descriptor[] = {
+/*
+ * Endpoint packet size matches the report so every report is a single
+ * transaction. bInterval is patched in usb_comm_init() from
+ * s_poll_interval_ms, so the descriptor lives in RAM. With telemetry the
+ * CDC function follows the HID interface (composite device; esp_tinyusb's
+ * default device descriptor then announces the interface association).
+ */
+static uint8_t hid_configuration_descriptor[] = {
     TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, TUSB_DESC_TOTAL_LEN,
                           TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
     TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE,
-                       sizeof(hid_report_descriptor), 0x81, 16, 10)
+                       sizeof(hid_report_descriptor), 0x81,
+                       sizeof(usb_hid_gamepad_report_t),
+                       CONFIG_CLUTCH_HID_POLL_INTERVAL_MS),
+#if CONFIG_CLUTCH_USB_TELEMETRY
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 0, EPNUM_CDC_NOTIF, 8,
+                       EPNUM_CDC_OUT, EPNUM_CDC_IN, CDC_EP_SIZE),
+#endif
 };
 
+/* bInterval is the last byte of the HID endpoint descriptor */
+#define HID_EP_BINTERVAL_OFFSET (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN - 1)
+
 /* ------------------------------------------------------------------ */
 /* TinyUSB callbacks                                                   */
 /* ------------------------------------------------------------------ */
 
 void tud_mount_cb(void)
 {
+    if (!s_mount_traced) {
+        boot_trace_mark("usb_mounted");
+        s_mount_traced = true;
+    }
+
     s_is_mounted = true;
-    ESP_LOGI(TAG, "USB mounted — gamepad ready (X=right clutch, Y=virtual clutch)");
+    ESP_LOGI(TAG, "USB mounted — gamepad ready (X=right clutch, Y=virtual clutch, Z-Rz=aux, %d buttons)",
+             USB_HID_BUTTON_COUNT);
 }
 
 void tud_umount_cb(void)       { s_is_mounted = false; }
@@ -77,7 +164,16 @@ uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
                                 hid_report_type_t report_type,
                                 uint8_t *buffer, uint16_t reqlen)
 {
-    (void)instance; (void)report_id; (void)report_type;
+    (void)instance; (void)report_id;
+    if (report_type == HID_REPORT_TYPE_FEATURE) {
+        usb_hid_feature_report_t feature = { .command = s_feature_command };
+        if (reqlen < sizeof(feature)) return 0;
+        if (s_feature_get_cb != NULL) {
+            s_feature_get_cb(&feature);
+        }
+        memcpy(buffer, &feature, sizeof(feature));
+        return sizeof(feature);
+    }
     if (reqlen < sizeof(s_report)) return 0;
     memcpy(buffer, &s_report, sizeof(s_report));
     return sizeof(s_report);
@@ -87,8 +183,18 @@ void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id,
                             hid_report_type_t report_type,
                             const uint8_t *buffer, uint16_t bufsize)
 {
-    (void)instance; (void)report_id; (void)report_type;
-    (void)buffer;   (void)bufsize;
+    (void)instance; (void)report_id;
+    if (report_type != HID_REPORT_TYPE_FEATURE ||
+        bufsize < sizeof(usb_hid_feature_report_t)) {
+        return;
+    }
+
+    usb_hid_feature_report_t feature;
+    memcpy(&feature, buffer, sizeof(feature));
+    s_feature_command = feature.command;
+    if (s_feature_set_cb != NULL) {
+        s_feature_set_cb(&feature);
+    }
 }
 
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
@@ -97,13 +203,52 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
     return hid_report_descriptor;
 }
 
+HOT_PATH_FN void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report,
+                                            uint16_t len)
+{
+    (void)instance; (void)report; (void)len;
+    /* Endpoint free again — push the report that was held back */
+    if (s_report_pending) {
+        usb_comm_notify_report();
+    }
+}
+
 /* ------------------------------------------------------------------ */
 /* Public API                                                          */
 /* ------------------------------------------------------------------ */
 
+esp_err_t usb_comm_set_poll_interval_ms(uint8_t interval_ms)
+{
+    if (interval_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_is_installed) {
+        ESP_LOGW(TAG, "Poll interval can only be changed before usb_comm_init()");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_poll_interval_ms = interval_ms;
+    return ESP_OK;
+}
+
+void usb_comm_set_feature_handler(usb_feature_set_cb_t set_cb,
+                                  usb_feature_get_cb_t get_cb)
+{
+    s_feature_set_cb = set_cb;
+    s_feature_get_cb = get_cb;
+}
+
+uint8_t usb_comm_get_poll_interval_ms(void)
+{
+    return s_poll_interval_ms;
+}
+
 esp_err_t usb_comm_init(void)
 {
-    ESP_LOGI(TAG, "Initializing USB HID (2-axis gamepad)...");
+    ESP_LOGI(TAG, "Initializing USB HID (%d-axis, %d-button gamepad)...",
+             USB_HID_AXIS_COUNT, USB_HID_BUTTON_COUNT);
+
+    hid_configuration_descriptor[HID_EP_BINTERVAL_OFFSET] = s_poll_interval_ms;
 
     const tinyusb_config_t tusb_cfg = {
         .device_descriptor      = NULL,
@@ -113,8 +258,10 @@ esp_err_t usb_comm_init(void)
     };
     ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
     memset(&s_report, 0, sizeof(s_report));
+    s_is_installed = true;
 
-    ESP_LOGI(TAG, "USB HID ready");
+    ESP_LOGI(TAG, "USB HID ready (bInterval %u ms, %u-byte reports)",
+             s_poll_interval_ms, (unsigned)sizeof(s_report));
     return ESP_OK;
 }
 
@@ -123,20 +270,254 @@ bool usb_comm_is_connected(void)
     return s_is_mounted;
 }
 
-void task_hid_reporter(void *arg)
+HOT_PATH_FN void usb_comm_notify_report(void)
+{
+#if CONFIG_CLUTCH_HID_REPORT_MODE_SOF
+    // The next frame slot picks the change up
+#else
+    TaskHandle_t task = s_reporter_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+#endif
+}
+
+/* Origin of the data in a report, for the sample-age stage */
+typedef struct {
+    uint32_t version;       // sum of sender snapshot versions
+    int64_t  rx_time_us;    // newest sample
+} report_source_t;
+
+/* Merge every sender into one report, once per USB frame at most */
+static HOT_PATH_FN void build_report(usb_hid_gamepad_report_t *report, report_source_t *src)
+{
+    // Read once per report. The clutch engine stores it without ordering
+    // against the snapshots, so it may lag the merge below by an engine cycle
+    uint16_t virtual_clutch = g_virtual_clutch_value;
+
+    sender_state_t merged;
+    sender_registry_merge(&merged, esp_timer_get_time());
+
+    report->right_clutch   = merged.right_clutch;
+    report->virtual_clutch = virtual_clutch;
+    memcpy(&report->axes[USB_HID_AUX_AXIS_FIRST], merged.aux, sizeof(merged.aux));
+    report->buttons        = (usb_hid_buttons_t)merged.buttons;
+
+    src->version = merged.version;
+    src->rx_time_us = merged.rx_time_us;
+}
+
+/* Age of the newest sample at send time, once per new snapshot; the
+ * report is traced on the telemetry stream at the same point */
+static HOT_PATH_FN void record_sample_age(const usb_hid_gamepad_report_t *report,
+                                          const report_source_t *src, uint32_t *last_version)
+{
+    if (src->version == *last_version || src->rx_time_us == 0) {
+        return;
+    }
+    *last_version = src->version;
+
+    int64_t now = esp_timer_get_time();
+    int64_t age = now - src->rx_time_us;
+    latency_stats_record(LATENCY_STAGE_SAMPLE_AGE,
+                         age < 0 ? 0 : age > UINT32_MAX ? UINT32_MAX : (uint32_t)age);
+
+    if (telemetry_is_active()) {
+        const telemetry_report_t trace = {
+            .t_us = (uint32_t)now,
+            .sample_rx_us = (uint32_t)src->rx_time_us,
+            .right_clutch = report->right_clutch,
+            .virtual_clutch = report->virtual_clutch,
+            .buttons = report->buttons,
+        };
+        telemetry_emit(TELEMETRY_FRAME_REPORT, &trace, sizeof(trace));
+    }
+}
+
+/*
+ * Phase of back-to-back changed reports against the bInterval grid: 0
+ * when every report of a stream leaves at the same point of its frame.
+ * Keep-alives, and gaps longer than JITTER_STREAM_INTERVALS intervals,
+ * are not a stream and only restart the measurement.
+ */
+static HOT_PATH_FN void record_report_jitter(bool changed)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t last = s_last_report_us;
+    s_last_report_us = changed ? now : 0;
+    if (!changed || last == 0) {
+        return;
+    }
+
+    uint32_t period = s_poll_interval_ms * 1000u;
+    int64_t interval = now - last;
+    if (interval > (int64_t)period * JITTER_STREAM_INTERVALS) {
+        return;
+    }
+    uint32_t phase = (uint32_t)interval % period;
+    latency_stats_record(LATENCY_STAGE_REPORT_JITTER,
+                         phase < period - phase ? phase : period - phase);
+}
+
+/* Bookkeeping for a report accepted by tud_hid_report() */
+static HOT_PATH_FN void report_sent(bool changed, const report_source_t *src, uint32_t *last_version)
+{
+    metrics_add(METRIC_HID_REPORTS, 1);
+    if (changed) power_note_activity();
+    latency_stats_mark_reported(changed);
+    record_sample_age(&s_report, src, last_version);
+    record_report_jitter(changed);
+}
+
+#if CONFIG_CLUTCH_HID_REPORT_MODE_EVENT
+
+HOT_PATH_FN void task_hid_reporter(void *arg)
+{
+    (void)arg;
+
+    /* Writers that do not notify (e.g. the clutch engine) are picked up
+     * by comparing against the last sent report once per bInterval. */
+    const TickType_t poll_ticks = pdMS_TO_TICKS(s_poll_interval_ms);
+    const TickType_t keepalive_ticks = pdMS_TO_TICKS(CONFIG_CLUTCH_HID_KEEPALIVE_MS);
+    usb_hid_gamepad_report_t last_sent = {0};
+    TickType_t last_sent_tick = xTaskGetTickCount();
+    report_source_t src;
+    uint32_t last_version = 0;
+
+    s_reporter_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        bool notified = ulTaskNotifyTake(pdTRUE, poll_ticks) > 0;
+
+        if (!s_is_mounted) continue;
+
+        build_report(&s_report, &src);
+
+        bool changed = memcmp(&s_report, &last_sent, sizeof(s_report)) != 0;
+        bool keepalive_due = (xTaskGetTickCount() - last_sent_tick) >= keepalive_ticks;
+        if (!notified && !changed && !keepalive_due && !s_report_pending) continue;
+
+        /* Flag first, then re-check: if the endpoint freed up in between,
+         * send now; otherwise tud_hid_report_complete_cb wakes us. */
+        s_report_pending = true;
+        if (!tud_hid_ready()) {
+            metrics_add(METRIC_HID_BUSY, 1);
+            continue;
+        }
+        s_report_pending = false;
+
+        if (tud_hid_report(0, &s_report, sizeof(s_report))) {
+            report_sent(changed, &src, &last_version);
+            last_sent = s_report;
+            last_sent_tick = xTaskGetTickCount();
+        }
+    }
+}
+
+#elif CONFIG_CLUTCH_HID_REPORT_MODE_SOF
+
+/*
+ * Start-of-frame scheduling: every SOF starts a one-shot timer, and the
+ * report is built from the newest snapshots and armed
+ * CONFIG_CLUTCH_HID_SOF_OFFSET_US into the frame, so it waits in the
+ * endpoint only for the rest of the frame before the host's next IN
+ * token. Packet arrival does not wake the reporter; it only changes what
+ * the next slot sends.
+ */
+static esp_timer_handle_t s_sof_timer = NULL;
+
+HOT_PATH_FN void tud_sof_cb(uint32_t frame_count)
+{
+    (void)frame_count;
+    if (s_sof_timer != NULL) {
+        esp_timer_stop(s_sof_timer);    // a late slot gives way to the new frame
+        esp_timer_start_once(s_sof_timer, CONFIG_CLUTCH_HID_SOF_OFFSET_US);
+    }
+}
+
+static HOT_PATH_FN void sof_timer_cb(void *arg)
+{
+    (void)arg;
+    TaskHandle_t task = s_reporter_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+HOT_PATH_FN void task_hid_reporter(void *arg)
+{
+    (void)arg;
+
+    const TickType_t keepalive_ticks = pdMS_TO_TICKS(CONFIG_CLUTCH_HID_KEEPALIVE_MS);
+    usb_hid_gamepad_report_t last_sent = {0};
+    TickType_t last_sent_tick = xTaskGetTickCount();
+    report_source_t src;
+    uint32_t last_version = 0;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sof_timer_cb,
+        .name = "hid_sof",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_sof_timer));
+
+    s_reporter_task = xTaskGetCurrentTaskHandle();
+    tud_sof_cb_enable(true);
+
+    while (1) {
+        // No SOF while suspended or unplugged
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (!s_is_mounted) continue;
+        if (!tud_hid_ready()) {
+            metrics_add(METRIC_HID_BUSY, 1);
+            continue;
+        }
+
+        build_report(&s_report, &src);
+
+        bool changed = memcmp(&s_report, &last_sent, sizeof(s_report)) != 0;
+        bool keepalive_due = (xTaskGetTickCount() - last_sent_tick) >= keepalive_ticks;
+        if (!changed && !keepalive_due) continue;
+
+        if (tud_hid_report(0, &s_report, sizeof(s_report))) {
+            report_sent(changed, &src, &last_version);
+            last_sent = s_report;
+            last_sent_tick = xTaskGetTickCount();
+        }
+    }
+}
+
+#else /* CONFIG_CLUTCH_HID_REPORT_MODE_POLL */
+
+HOT_PATH_FN void task_hid_reporter(void *arg)
 {
     (void)arg;
 
+    const TickType_t period_ticks = pdMS_TO_TICKS(s_poll_interval_ms);
+    TickType_t last_wake = xTaskGetTickCount();
+    usb_hid_gamepad_report_t last_sent = {0};
+    report_source_t src;
+    uint32_t last_version = 0;
+
+    s_reporter_task = xTaskGetCurrentTaskHandle();
+
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(10));
+        xTaskDelayUntil(&last_wake, period_ticks);
 
         if (!s_is_mounted) continue;
 
-        s_report.right_clutch   = g_right_clutch_value;
-        s_report.virtual_clutch = g_virtual_clutch_value;
+        build_report(&s_report, &src);
 
-        if (tud_hid_ready()) {
-            tud_hid_report(0, &s_report, sizeof(s_report));
+        if (!tud_hid_ready()) {
+            metrics_add(METRIC_HID_BUSY, 1);
+            continue;
+        }
+        if (tud_hid_report(0, &s_report, sizeof(s_report))) {
+            report_sent(memcmp(&s_report, &last_sent, sizeof(s_report)) != 0,
+                        &src, &last_version);
+            last_sent = s_report;
         }
     }
 }
+
+#endif